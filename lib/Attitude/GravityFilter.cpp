@@ -0,0 +1,183 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "GravityFilter.hpp"
+
+// dps·µs → rad, Q40
+static constexpr int64_t DPS_US_TO_RAD_Q40 =
+    static_cast<int64_t>(3.14159265358979 / 180e6 * (1LL << 40) + 0.5);
+
+static constexpr int64_t ACC_TRUST_LO = static_cast<int64_t>(
+    (1.0f - GRAVITY_FILTER_ACC_TOL) * (1.0f - GRAVITY_FILTER_ACC_TOL) * 65536);
+static constexpr int64_t ACC_TRUST_HI = static_cast<int64_t>(
+    (1.0f + GRAVITY_FILTER_ACC_TOL) * (1.0f + GRAVITY_FILTER_ACC_TOL) * 65536);
+
+// |v|², Q16 g²
+static int64_t norm2(const int32_t* v) {
+  return (static_cast<int64_t>(v[0]) * v[0] +
+          static_cast<int64_t>(v[1]) * v[1] +
+          static_cast<int64_t>(v[2]) * v[2]) >>
+         16;
+}
+
+void GravityFilter::begin(ImuSource* source) {
+  m_source = source;
+  m_valid = false;
+  m_gyroFresh = false;
+  memset(m_lin, 0, sizeof(m_lin));
+}
+
+// ------------------ filter step ------------------
+
+bool GravityFilter::update() {
+  int32_t a[3];
+  if (!m_source || !m_source->readAccelerometerQ16(&a[0], &a[1], &a[2]))
+    return false;
+  m_gyroFresh = m_source->readGyroscopeQ16(&m_w[0], &m_w[1], &m_w[2]);
+
+  const uint32_t now = micros();
+  const uint32_t dt = now - m_lastUs;
+  m_lastUs = now;
+
+  if (!m_valid || dt > GRAVITY_FILTER_MAX_DT_MS * 1000u) {
+    // first sample, or the filter has not run for a while
+    memcpy(m_g, a, sizeof(m_g));
+    for (int i = 0; i < 4; i++)
+      normalize();
+    m_valid = true;
+    m_incUs = now;
+    m_incGap = false;
+  } else {
+    if (m_useRotationIncrement)
+      propagateIncrement(now);
+    else if (m_gyroFresh)
+      propagateGyro(m_w, dt);
+    correct(a, dt);
+    normalize();
+  }
+
+  for (int i = 0; i < 3; i++)
+    m_lin[i] = a[i] - m_g[i];
+  return true;
+}
+
+void GravityFilter::propagateIncrement(uint32_t now) {
+  // one increment per AE period: a later one means samples were overwritten
+  // unread, none for that long means the engine stalled
+  int16_t dq[4];
+  const bool fresh = m_source->readRotationIncrement(dq);
+  const uint32_t since = now - m_incUs;
+  if (m_incGap || since > m_incPeriodUs + m_incPeriodUs / 2) {
+    // the gyro covers everything since the last applied increment, step by
+    // step until a new one arrives; that one lies inside the covered span
+    // and is dropped, the next one is applied again
+    if (m_gyroFresh)
+      propagateGyro(m_w, since);
+    m_incUs = now;
+    m_incGap = !fresh;
+  } else if (fresh) {
+    propagateQuaternion(dq);
+    m_incUs = now;
+  }
+  // otherwise nothing new yet: the next increment carries this rotation
+}
+
+void GravityFilter::propagateGyro(const int32_t* w, uint32_t dt_us) {
+  // θ = ω·dt in Q16 rad; a vector fixed in the world turns by −θ in the
+  // sensor frame: g' = g + g × θ
+  int32_t t[3];
+  for (int i = 0; i < 3; i++)
+    t[i] = static_cast<int32_t>((static_cast<int64_t>(w[i]) * dt_us *
+                                 DPS_US_TO_RAD_Q40) >>
+                                40);
+
+  const int64_t gx = m_g[0], gy = m_g[1], gz = m_g[2];
+  m_g[0] += static_cast<int32_t>((gy * t[2] - gz * t[1]) >> 16);
+  m_g[1] += static_cast<int32_t>((gz * t[0] - gx * t[2]) >> 16);
+  m_g[2] += static_cast<int32_t>((gx * t[1] - gy * t[0]) >> 16);
+}
+
+void GravityFilter::propagateQuaternion(const int16_t* dq) {
+  // rotate g by the inverse increment (w, −u):
+  //   t = 2·(−u × g),  g' = g + w·t + (−u) × t
+  const int64_t w = dq[0], ux = -dq[1], uy = -dq[2], uz = -dq[3];
+  const int64_t gx = m_g[0], gy = m_g[1], gz = m_g[2];
+
+  const int64_t tx = (uy * gz - uz * gy) >> 13;
+  const int64_t ty = (uz * gx - ux * gz) >> 13;
+  const int64_t tz = (ux * gy - uy * gx) >> 13;
+
+  m_g[0] += static_cast<int32_t>((w * tx + uy * tz - uz * ty) >> 14);
+  m_g[1] += static_cast<int32_t>((w * ty + uz * tx - ux * tz) >> 14);
+  m_g[2] += static_cast<int32_t>((w * tz + ux * ty - uy * tx) >> 14);
+}
+
+void GravityFilter::correct(const int32_t* a, uint32_t dt_us) {
+  // shaking or linear acceleration: |a| is not gravity alone
+  const int64_t n2 = norm2(a);
+  if (n2 < ACC_TRUST_LO || n2 > ACC_TRUST_HI)
+    return;
+
+  int64_t alpha = (static_cast<int64_t>(dt_us) << 16) /
+                  (GRAVITY_FILTER_TAU_MS * 1000);
+  if (alpha > 65536)
+    alpha = 65536;
+  for (int i = 0; i < 3; i++)
+    m_g[i] += static_cast<int32_t>(((a[i] - m_g[i]) * alpha) >> 16);
+}
+
+void GravityFilter::normalize() {
+  // one Newton step towards |g| = 1: g · (3 − |g|²) / 2
+  const int64_t n2 = norm2(m_g);
+  if (n2 < 65536 / 4 || n2 > 65536 * 2)
+    return;  // too far off (free fall at the first sample)
+  const int64_t s = (3 * 65536 - n2) / 2;
+  for (int i = 0; i < 3; i++)
+    m_g[i] = static_cast<int32_t>((m_g[i] * s) >> 16);
+}
+
+// ------------------ ImuSource ------------------
+
+bool GravityFilter::readAccelerometerQ16(int32_t* ax, int32_t* ay, int32_t* az) {
+  if (!update())
+    return false;
+
+  *ax = m_g[0];
+  *ay = m_g[1];
+  *az = m_g[2];
+  return true;
+}
+
+bool GravityFilter::readAccelerometer(float* ax, float* ay, float* az) {
+  int32_t g[3];
+  if (!readAccelerometerQ16(&g[0], &g[1], &g[2]))
+    return false;
+
+  *ax = g[0] / 65536.0f;
+  *ay = g[1] / 65536.0f;
+  *az = g[2] / 65536.0f;
+  return true;
+}
+
+bool GravityFilter::readGyroscopeQ16(int32_t* gx, int32_t* gy, int32_t* gz) {
+  // the sample of the last filter step, otherwise a read of its own
+  if (!m_gyroFresh)
+    return m_source && m_source->readGyroscopeQ16(gx, gy, gz);
+
+  m_gyroFresh = false;
+  *gx = m_w[0];
+  *gy = m_w[1];
+  *gz = m_w[2];
+  return true;
+}
+
+bool GravityFilter::readGyroscope(float* gx, float* gy, float* gz) {
+  int32_t w[3];
+  if (!readGyroscopeQ16(&w[0], &w[1], &w[2]))
+    return false;
+
+  *gx = w[0] / 65536.0f;
+  *gy = w[1] / 65536.0f;
+  *gz = w[2] / 65536.0f;
+  return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "imu_source.hpp"
+
+/*
+ * Integer complementary filter for the gravity direction.
+ *
+ * The gravity estimate g (sensor frame, Q16.16 g) is propagated with the
+ * gyroscope every update:
+ *
+ *   g ← g + g × θ          θ = ω·dt in Q16 rad (small angle)
+ *
+ * or, if enabled and available, with the source's quaternion increments
+ * (QMI8658C AttitudeEngine). Each new increment is applied once; steps
+ * without one wait for the next. When increments were missed (more than
+ * 1.5 AE periods since the last one) or stop coming, the gyroscope covers
+ * the time since the last applied increment and every step after it, until
+ * the next increment arrives. It is then pulled
+ * towards the accelerometer
+ * with the time constant GRAVITY_FILTER_TAU_MS, but only while |a| is close
+ * to 1 g, so shaking and linear acceleration do not leak into gravity.
+ * A first-order renormalisation keeps |g| at 1 g without a square root.
+ *
+ * Linear acceleration is what is left: a − g.
+ */
+
+#define GRAVITY_FILTER_TAU_MS 400     // accelerometer correction time constant
+#define GRAVITY_FILTER_ACC_TOL 0.15f  // trust acc only while ||a| - 1 g| < tol
+#define GRAVITY_FILTER_MAX_DT_MS 100  // larger gaps restart from the acc
+
+/**
+ * Pass-through `ImuSource` that returns the filtered gravity instead of the
+ * raw accelerometer. Every accelerometer read runs one filter step on a
+ * fresh acc + gyro sample of the wrapped source; gyroscope reads return
+ * that sample, so a frame costs a single read of each sensor.
+ */
+class GravityFilter : public ImuSource {
+ private:
+  ImuSource* m_source = nullptr;
+  bool m_useRotationIncrement = false;
+  uint32_t m_incPeriodUs = 0;  // AE sample period
+  uint32_t m_incUs = 0;        // rotation is applied up to this time
+  bool m_incGap = false;       // increments missing, propagating the gyro
+
+  bool m_valid = false;
+  uint32_t m_lastUs = 0;
+  int32_t m_g[3] = {};    // gravity, Q16 g
+  int32_t m_lin[3] = {};  // linear acceleration, Q16 g
+  int32_t m_w[3] = {};    // last gyroscope sample, Q16 dps
+  bool m_gyroFresh = false;
+
+  void propagateGyro(const int32_t* w, uint32_t dt_us);
+  void propagateIncrement(uint32_t now);
+  void propagateQuaternion(const int16_t* dq);
+  void correct(const int32_t* a, uint32_t dt_us);
+  void normalize();
+
+ public:
+  void begin(ImuSource* source);
+  /// @brief propagate with `readRotationIncrement()` (on-chip fusion)
+  /// instead of integrating the gyroscope, where the source provides it
+  /// @param period_us the source's increment period; update() has to run
+  /// more than twice per period to see every increment
+  void setUseRotationIncrement(bool use, uint32_t period_us) {
+    m_useRotationIncrement = use;
+    m_incPeriodUs = period_us;
+  }
+  /// @brief forgets the estimate; the next update starts from the acc
+  void reset() { m_valid = false; }
+
+  /// @brief runs one filter step
+  /// @return `false` if the accelerometer read failed
+  bool update();
+
+  /// @brief gravity in the sensor frame, Q16.16 g
+  const int32_t* gravityQ16() const { return m_g; }
+  /// @brief accelerometer minus gravity, Q16.16 g
+  const int32_t* linearAccelerationQ16() const { return m_lin; }
+
+  bool readAccelerometer(float* ax, float* ay, float* az) override;
+  bool readAccelerometerQ16(int32_t* ax, int32_t* ay, int32_t* az) override;
+  bool readGyroscope(float* gx, float* gy, float* gz) override;
+  bool readGyroscopeQ16(int32_t* gx, int32_t* gy, int32_t* gz) override;
+};
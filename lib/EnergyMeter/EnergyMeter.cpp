@@ -0,0 +1,229 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "EnergyMeter.hpp"
+
+// µA·µs → µAh
+static constexpr float UA_US_PER_UAH = 3.6e9f;
+
+void EnergyMeter::begin(const EnergyStateModel* states, int state_count,
+                        const char* const* stage_names, int stage_count,
+                        uint64_t now_us, int state, uint32_t khz) {
+  m_model = states;
+  m_stateCount = state_count < ENERGY_STATES_MAX ? state_count
+                                                 : ENERGY_STATES_MAX;
+  m_stageNames = stage_names;
+  m_stageCount = stage_count < ENERGY_STAGES_MAX ? stage_count
+                                                 : ENERGY_STAGES_MAX;
+  m_state = state;
+  m_khz = khz;
+  reset(now_us);
+}
+
+void EnergyMeter::reset(uint64_t now_us) {
+  for (int i = 0; i < ENERGY_STATES_MAX; i++)
+    m_states[i] = Slot();
+  for (int i = 0; i < ENERGY_POINTS_MAX; i++)
+    m_points[i] = Slot();
+  memset(m_pointKhz, 0, sizeof(m_pointKhz));
+  memset(m_stageUs, 0, sizeof(m_stageUs));
+  memset(m_stageCycles, 0, sizeof(m_stageCycles));
+  m_pointCount = 0;
+  m_hasBattery = false;
+
+  m_beginUs = m_openUs = now_us;
+  m_openBusyUs = 0;
+  m_states[m_state].entries++;
+  int p = pointIndex(m_khz);
+  if (p >= 0)
+    m_points[p].entries++;
+}
+
+// ------------------ ledger ------------------
+
+int EnergyMeter::pointIndex(uint32_t khz) {
+  if (khz == 0)
+    return -1;
+  for (int i = 0; i < m_pointCount; i++)
+    if (m_pointKhz[i] == khz)
+      return i;
+  if (m_pointCount == ENERGY_POINTS_MAX)
+    return -1;  // table full: still accounted per state
+  m_pointKhz[m_pointCount] = khz;
+  return m_pointCount++;
+}
+
+const EnergyMeter::Slot* EnergyMeter::pointSlot(uint32_t khz) const {
+  for (int i = 0; i < m_pointCount; i++)
+    if (m_pointKhz[i] == khz)
+      return &m_points[i];
+  return nullptr;
+}
+
+void EnergyMeter::close(uint64_t now_us) {
+  const uint64_t us = now_us > m_openUs ? now_us - m_openUs : 0;
+  const EnergyStateModel& model = m_model[m_state];
+
+  uint64_t busy_cycles = 0, idle_cycles = 0;
+  if (model.core_on) {
+    const uint64_t busy_us = m_openBusyUs < us ? m_openBusyUs : us;
+    busy_cycles = busy_us * m_khz / 1000;
+    idle_cycles = (us - busy_us) * m_khz / 1000;
+  }
+  const uint64_t base = static_cast<uint64_t>(model.base_ua) * us;
+
+  Slot* slots[2] = {&m_states[m_state], nullptr};
+  const int p = model.core_on ? pointIndex(m_khz) : -1;
+  if (p >= 0)
+    slots[1] = &m_points[p];
+  for (Slot* s : slots) {
+    if (!s)
+      continue;
+    s->us += us;
+    s->busy_cycles += busy_cycles;
+    s->idle_cycles += idle_cycles;
+    s->base_ua_us += base;
+  }
+
+  m_openUs = now_us;
+  m_openBusyUs = 0;
+}
+
+void EnergyMeter::setState(int state, uint64_t now_us) {
+  if (state < 0 || state >= m_stateCount || state == m_state)
+    return;
+  close(now_us);
+  m_state = state;
+  m_states[state].entries++;
+  // the timer stops with the core clock: a battery drop across this state
+  // would be divided by awake time only
+  if (!m_model[state].core_on)
+    m_hasBattery = false;
+}
+
+void EnergyMeter::setClock(uint32_t khz, uint64_t now_us) {
+  if (khz == m_khz)
+    return;
+  close(now_us);
+  m_khz = khz;
+  const int p = pointIndex(khz);
+  if (p >= 0)
+    m_points[p].entries++;
+}
+
+void EnergyMeter::addStage(int stage, uint32_t us) {
+  if (stage < 0 || stage >= m_stageCount)
+    return;
+  m_stageUs[stage] += us;
+  m_stageCycles[stage] += static_cast<uint64_t>(us) * m_khz / 1000;
+}
+
+void EnergyMeter::setBattery(uint16_t mv, uint8_t percent, uint64_t now_us) {
+  m_batteryLast = {now_us, mv, percent};
+  if (!m_hasBattery) {
+    m_batteryFirst = m_batteryLast;
+    m_hasBattery = true;
+  }
+}
+
+// ------------------ pricing ------------------
+
+float EnergyMeter::slotMicroAh(const Slot& s) const {
+  const float ua_us = static_cast<float>(s.base_ua_us) +
+                      static_cast<float>(s.busy_cycles) * m_busyUaPerMhz +
+                      static_cast<float>(s.idle_cycles) * m_idleUaPerMhz;
+  return ua_us / UA_US_PER_UAH;
+}
+
+float EnergyMeter::chargeMicroAh(uint64_t now_us) {
+  close(now_us);
+  float uah = 0.0f;
+  for (int i = 0; i < m_stateCount; i++)
+    uah += slotMicroAh(m_states[i]);
+  return uah;
+}
+
+float EnergyMeter::averageMilliamps(uint64_t now_us) {
+  const float uah = chargeMicroAh(now_us);
+  const uint64_t us = now_us - m_beginUs;
+  return us ? uah * 3.6e6f / us : 0.0f;
+}
+
+float EnergyMeter::modelMilliamps(int state, uint32_t khz, float load) const {
+  if (state < 0 || state >= m_stateCount)
+    return 0.0f;
+  const EnergyStateModel& model = m_model[state];
+  float ua = model.base_ua;
+  if (model.core_on) {
+    load = constrain(load, 0.0f, 1.0f);
+    ua += khz / 1000.0f *
+          (m_busyUaPerMhz * load + m_idleUaPerMhz * (1.0f - load));
+  }
+  return ua / 1000.0f;
+}
+
+// ------------------ report ------------------
+
+void EnergyMeter::report(Print& out, uint64_t now_us) {
+  const float total_uah = chargeMicroAh(now_us);
+  const float total_s = (now_us - m_beginUs) / 1e6f;
+  const float hours = total_s / 3600.0f;
+  const float total = total_uah > 0.0f ? total_uah : 1.0f;
+
+  out.printf("energy: %.1f s, %.1f uAh modelled, %.2f mAh per hour of use\r\n",
+             total_s, total_uah, hours > 0.0f ? total_uah / 1000.0f / hours
+                                              : 0.0f);
+
+  out.printf("  %-10s %9s %7s %5s %8s %6s\r\n", "state", "time s", "entries",
+             "load", "uAh", "share");
+  for (int i = 0; i < m_stateCount; i++) {
+    const Slot& s = m_states[i];
+    const uint64_t cycles = s.busy_cycles + s.idle_cycles;
+    const float uah = slotMicroAh(s);
+    out.printf("  %-10s %9.1f %7lu %4d%% %8.1f %5d%%\r\n", m_model[i].name,
+               s.us / 1e6f, (unsigned long)s.entries,
+               cycles ? int(s.busy_cycles * 100 / cycles) : 0, uah,
+               int(uah * 100 / total));
+  }
+  for (int i = 0; i < m_stateCount; i++)
+    if (!m_model[i].core_on && m_states[i].entries)
+      out.printf("  %s: timer stops, its time is not counted; drain is from "
+                 "the last wake on\r\n",
+                 m_model[i].name);
+
+  out.printf("  %-10s %9s %7s %5s %8s %6s\r\n", "MHz", "time s", "entries",
+             "load", "uAh", "share");
+  for (int i = 0; i < m_pointCount; i++) {
+    const Slot& s = m_points[i];
+    const uint64_t cycles = s.busy_cycles + s.idle_cycles;
+    const float uah = slotMicroAh(s);
+    out.printf("  %-10lu %9.1f %7lu %4d%% %8.1f %5d%%\r\n",
+               (unsigned long)(m_pointKhz[i] / 1000), s.us / 1e6f,
+               (unsigned long)s.entries,
+               cycles ? int(s.busy_cycles * 100 / cycles) : 0, uah,
+               int(uah * 100 / total));
+  }
+
+  // stages: core current while busy only, the base current is the state's
+  out.printf("  %-10s %9s %7s %5s %8s %6s\r\n", "stage", "busy s", "", "",
+             "uAh", "share");
+  for (int i = 0; i < m_stageCount; i++) {
+    const float uah = m_stageCycles[i] * static_cast<float>(m_busyUaPerMhz) /
+                      UA_US_PER_UAH;
+    out.printf("  %-10s %9.2f %7s %5s %8.2f %5d%%\r\n", m_stageNames[i],
+               m_stageUs[i] / 1e6f, "", "", uah, int(uah * 100 / total));
+  }
+
+  // measured side: state-of-charge drop over the same time
+  if (m_hasBattery && m_batteryLast.us > m_batteryFirst.us) {
+    const float h = (m_batteryLast.us - m_batteryFirst.us) / 3.6e9f;
+    const int dpct = int(m_batteryFirst.percent) - m_batteryLast.percent;
+    out.printf("  battery %u -> %u mV, %u -> %u%%", m_batteryFirst.mv,
+               m_batteryLast.mv, m_batteryFirst.percent,
+               m_batteryLast.percent);
+    if (m_capacityMah)
+      out.printf(", %.2f mAh per hour measured",
+                 m_capacityMah * dpct / 100.0f / h);
+    out.printf("\r\n");
+  }
+}
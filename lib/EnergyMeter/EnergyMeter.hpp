@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Arduino.h>
+
+/*
+ * Energy accounting by time and cycles.
+ *
+ * The meter keeps a ledger of where time goes:
+ *
+ *   - per application state (running, dormant, ...)
+ *   - per clock operating point
+ *   - per sim/render stage
+ *
+ * and prices it with a current model instead of a shunt:
+ *
+ *   I = state base current                     (display, IMU, regulator)
+ *     + f_MHz · (busy µA/MHz · busy share      (core computing)
+ *                + idle µA/MHz · idle share)   (core waiting in WFI)
+ *
+ * Busy and idle time are kept as cycles at the clock they ran at, so
+ * 1 cycle · 1 µA/MHz = 1 µA·µs and the charge is computed exactly when a
+ * report is asked for. Stages are busy time by definition.
+ *
+ * All timestamps are passed in by the caller (µs, 64 bit): on the device
+ * that is time_us_64(), a host simulation advances its own clock. Note that
+ * the RP2040 timer stops in dormant, so on the device a dormant interval
+ * shows up as (almost) no time; its entries are still counted. For the same
+ * reason entering a state without core clock drops the battery reference:
+ * the measured drain only covers the time since the last wake.
+ */
+
+#define ENERGY_STATES_MAX 4
+#define ENERGY_POINTS_MAX 8
+#define ENERGY_STAGES_MAX 10
+
+/// RP2040 core + SRAM, measured at 1.1 V; scale with the operating point
+#define ENERGY_BUSY_UA_PER_MHZ 90  // computing
+#define ENERGY_IDLE_UA_PER_MHZ 25  // WFI (sleep_us) until the frame deadline
+
+/// Current model of one application state
+struct EnergyStateModel {
+  const char* name;
+  uint32_t base_ua;  // everything but the core
+  bool core_on;      // core clocked in this state (not dormant)
+};
+
+/// Battery sample for the measured side of the report
+struct EnergyBatterySample {
+  uint64_t us;
+  uint16_t mv;
+  uint8_t percent;
+};
+
+/**
+ * Ledger of time, cycles and charge per state, operating point and stage.
+ *
+ * Per frame the caller adds its busy time with `addBusy()` and, optionally,
+ * the stage split with `addStage()`; the rest of the wall time until the next
+ * state or clock change counts as idle. `setBattery()` samples give the
+ * measured drain to compare the model with.
+ */
+class EnergyMeter {
+ public:
+  struct Slot {
+    uint64_t us = 0;           // wall time
+    uint64_t busy_cycles = 0;  // core cycles spent computing
+    uint64_t idle_cycles = 0;  // core cycles spent waiting
+    uint64_t base_ua_us = 0;   // base current × time
+    uint32_t entries = 0;
+  };
+
+  /// @param states model per state, indexed like the caller's state enum
+  /// @param stage_names names for the stage indices of `addStage()`
+  void begin(const EnergyStateModel* states, int state_count,
+             const char* const* stage_names, int stage_count, uint64_t now_us,
+             int state = 0, uint32_t khz = 0);
+  /// forgets everything that was accounted so far
+  void reset(uint64_t now_us);
+
+  void setCoreModel(uint16_t busy_ua_per_mhz, uint16_t idle_ua_per_mhz) {
+    m_busyUaPerMhz = busy_ua_per_mhz;
+    m_idleUaPerMhz = idle_ua_per_mhz;
+  }
+  void setCapacity(uint16_t mah) { m_capacityMah = mah; }
+
+  /// closes the current interval and continues in `state`
+  void setState(int state, uint64_t now_us);
+  /// closes the current interval and continues at `khz`
+  void setClock(uint32_t khz, uint64_t now_us);
+  /// busy time inside the current interval (the rest of it is idle)
+  void addBusy(uint32_t us) { m_openBusyUs += us; }
+  /// busy time of one stage, priced at the current clock
+  void addStage(int stage, uint32_t us);
+  /// battery reading; the first one (since begin/reset or since the last
+  /// state without core clock) is the reference for the drain
+  void setBattery(uint16_t mv, uint8_t percent, uint64_t now_us);
+
+  /// modelled charge in µAh, everything accounted up to `now_us`
+  float chargeMicroAh(uint64_t now_us);
+  /// modelled average draw in mA since begin()/reset(), over the time the
+  /// timer saw (on the device: without dormant time)
+  float averageMilliamps(uint64_t now_us);
+  /// modelled draw of `state` at `khz` with `load` (busy share, 0..1)
+  float modelMilliamps(int state, uint32_t khz, float load) const;
+
+  /// ledger tables and mAh per hour of use, modelled and from the battery
+  void report(Print& out, uint64_t now_us);
+
+  const Slot& stateSlot(int state) const { return m_states[state]; }
+  /// nullptr if the meter never saw `khz`
+  const Slot* pointSlot(uint32_t khz) const;
+
+ private:
+  const EnergyStateModel* m_model = nullptr;
+  int m_stateCount = 0;
+  const char* const* m_stageNames = nullptr;
+  int m_stageCount = 0;
+  uint16_t m_busyUaPerMhz = ENERGY_BUSY_UA_PER_MHZ;
+  uint16_t m_idleUaPerMhz = ENERGY_IDLE_UA_PER_MHZ;
+  uint16_t m_capacityMah = 0;
+
+  // open interval
+  int m_state = 0;
+  uint32_t m_khz = 0;
+  uint64_t m_openUs = 0;
+  uint64_t m_openBusyUs = 0;
+
+  uint64_t m_beginUs = 0;
+  Slot m_states[ENERGY_STATES_MAX];
+  Slot m_points[ENERGY_POINTS_MAX];
+  uint32_t m_pointKhz[ENERGY_POINTS_MAX] = {};
+  int m_pointCount = 0;
+  uint64_t m_stageUs[ENERGY_STAGES_MAX] = {};
+  uint64_t m_stageCycles[ENERGY_STAGES_MAX] = {};
+
+  bool m_hasBattery = false;
+  EnergyBatterySample m_batteryFirst = {};
+  EnergyBatterySample m_batteryLast = {};
+
+  void close(uint64_t now_us);
+  int pointIndex(uint32_t khz);
+  float slotMicroAh(const Slot& s) const;
+};
@@ -2,42 +2,43 @@
 
 // 配置参数（可调整以适应不同的渲染效果）
 
-// 16-bit 565 颜色线性插值
-uint16_t FluidRenderer::lerp565(uint16_t c1, uint16_t c2, float t) const {
-  // clamp t to [0,1]
-  if (t < 0.0f)
-    t = 0.0f;
-  if (t > 1.0f)
-    t = 1.0f;
-
-  auto lerp = [t](int a, int b, int bits) -> uint16_t {
-    const int mask = (1 << bits) - 1;
-    float v = a + (b - a) * t;  // ① 浮点插值
-    int iv = (int)roundf(v);    // ② 四舍五入取整
-    iv = iv & mask;             // ③ 掩码裁剪
-    return (uint16_t)iv;
-  };
-
-  uint16_t r = lerp((c1 >> 11) & 0x1F, (c2 >> 11) & 0x1F, 5);  // 5 bits
-  uint16_t g = lerp((c1 >> 5) & 0x3F, (c2 >> 5) & 0x3F, 6);    // 6 bits
-  uint16_t b = lerp(c1 & 0x1F, c2 & 0x1F, 5);                  // 5 bits
+// 小球渐变：m_ballBase → 白。按速度² 取下标，绘制时免开方
+// 第 i 项对应 |v|² = i / (SIZE-1) · MAX²，即 t = sqrt(i / (SIZE-1))
+void FluidRenderer::rebuildBallLut() {
+  for (int i = 0; i < RENDER_BALL_LUT_SIZE; ++i) {
+    float t = sqrtf(float(i) / (RENDER_BALL_LUT_SIZE - 1));
+    m_ballLut[i] = blend565(m_ballBase, TFT_WHITE, uint32_t(t * 256 + 0.5f));
+  }
+}
 
-  return (r << 11) | (g << 5) | b;
+// 格子配色：半透明边缘取液体色与光晕色的中点
+void FluidRenderer::rebuildCellPalette() {
+  m_fluidColor[RENDER_FLUID_EMPTY] = TFT_BLACK;
+  m_fluidColor[RENDER_FLUID_LIQUID] = m_gridFluid;
+  m_fluidColor[RENDER_FLUID_FOAM] = m_gridFoam;
+  m_fluidColor[RENDER_FLUID_RIM_TRANSPARENT] =
+      blend565(m_gridFluid, m_gridRim, 128);
+  m_fluidColor[RENDER_FLUID_RIM_LIGHT] = m_gridRim;
+  m_fluidColor[RENDER_FLUID_BODY] = m_gridBody;
+
+  // 明暗 8 级：黑 → 液体色（0..L-3），再 → 泡沫色（L-2, L-1）
+  constexpr int L = RENDER_SHADE_LEVELS;
+  for (int l = 0; l < L - 2; ++l)
+    m_shadeLut[l] = blend565(TFT_BLACK, m_gridFluid, l * 256 / (L - 3));
+  m_shadeLut[L - 2] = blend565(m_gridFluid, m_gridFoam, 128);
+  m_shadeLut[L - 1] = m_gridFoam;
+
+  // 元球软边：背景 → 液体色
+  for (int a = 0; a < 256; ++a)
+    m_metaLut[a] = blend565(TFT_BLACK, m_gridFluid, a + (a >> 7));
 }
 
-// 获取流体类型对应的颜色
-uint16_t FluidRenderer::getFluidColor(RenderFluidType type) const {
-  switch (type) {
-    case RENDER_FLUID_LIQUID:
-      return m_disp->color565(0, 240, 255);
-    case RENDER_FLUID_FOAM:
-      return m_disp->color565(200, 200, 230);
-    case RENDER_FLUID_RIM_TRANSPARENT:
-      return m_disp->color565(0, 120, 255);
-    case RENDER_FLUID_RIM_LIGHT:
-      return m_disp->color565(0, 0, 200);
-    default:  // RENDER_FLUID_EMPTY
-      return m_disp->color565(0, 0, 0);
+// 元球核：w = PEAK · (1 - d²/R²)²，下标为 d²（场定点²）>> SHIFT
+void FluidRenderer::buildMetaKernel() {
+  const float r2 = float(META_RQ) * META_RQ;
+  for (int i = 0; i < META_KERNEL_SIZE; ++i) {
+    float s = 1.0f - float(i << META_KERNEL_SHIFT) / r2;
+    m_metaKernel[i] = s > 0.f ? uint16_t(RENDER_META_PEAK * s * s + 0.5f) : 0;
   }
 }
 
@@ -53,32 +54,75 @@ bool FluidRenderer::isSimSolid(int renderGx, int renderGy) const {
   const float cy = (renderGy + 0.5f) * cell - 0.5f;  // 相对圆心 y
 
   // 与模拟端一致的圆容器半径（使用模拟 CELL，保持几何一致性）
-  constexpr float rad = 0.5f - ParticleSimulation::CELL;
+  constexpr float rad = 0.5f - FluidSimulation::CELL;
 
   // 圆外 ⇒ Solid
   return (cx * cx + cy * cy) > (rad * rad);
 }
 
 /******************************************************************
- * FluidRenderer::updateFluidCells() -- 卷积-Closing 平滑液面边缘
- *   ① 统计半径覆盖 → 基础分类
- *   ② 形态学 closing(膨胀→腐蚀)  → 填平凹洞 / 削细尖
- *   ③ 新生成的填充格设为 RENDER_FLUID_RIM_LIGHT
+ * 覆盖统计：m_cnt[] = 覆盖粒子数（Q8），m_speed[] = 平均速度（Q8）
  ******************************************************************/
 
-void FluidRenderer::updateFluidCells() {
+// 渲染格中心 (g+0.5)/GSr 在模拟格心坐标中的位置 u = s·GS - 0.5
+void FluidRenderer::buildUpsample() {
+  constexpr int SGS = FluidSimulation::GS;
+  for (int g = 0; g < m_renderGridSize; ++g) {
+    float u = (g + 0.5f) / m_renderGridSize * SGS - 0.5f;
+    if (u < 0.f)
+      u = 0.f;
+    if (u > SGS - 1)
+      u = SGS - 1;
+    int i0 = int(u) < SGS - 1 ? int(u) : SGS - 2;
+    m_upIdx[g] = i0;
+    m_upW[g] = uint16_t((u - i0) * 256.f + 0.5f);
+  }
+}
+
+// 双线性放大模拟端逐格统计：O(渲染格数)，与粒子数无关。
+// 覆盖数换算：半径 r 的圆盖住的格心数 ≈ 占有密度 × πr²（以模拟格面积计）
+void FluidRenderer::coverageFromSimField() {
+  constexpr int SGS = FluidSimulation::GS;
+  constexpr float rCells = PARTICLE_RADIUS * SGS;
+  constexpr uint32_t COVER_Q8 = uint32_t(3.14159265f * rCells * rCells * 256);
+
+  const CellStats& st = m_sim->cellStats();
+  const uint16_t* occ = st.occ;
+  const uint16_t* spd = st.speed;
+  const int GS = m_renderGridSize;
+
+  for (int gx = 0; gx < GS; ++gx) {
+    const int i = m_upIdx[gx];
+    const uint32_t fx = m_upW[gx];
+    for (int gy = 0; gy < GS; ++gy) {
+      const int j = m_upIdx[gy];
+      const uint32_t fy = m_upW[gy];
+      const int s00 = i * SGS + j, s10 = s00 + SGS;
+
+      uint32_t o0 = (occ[s00] * (256 - fy) + occ[s00 + 1] * fy) >> 8;
+      uint32_t o1 = (occ[s10] * (256 - fy) + occ[s10 + 1] * fy) >> 8;
+      uint32_t o = (o0 * (256 - fx) + o1 * fx) >> 8;
+
+      uint32_t v0 = (spd[s00] * (256 - fy) + spd[s00 + 1] * fy) >> 8;
+      uint32_t v1 = (spd[s10] * (256 - fy) + spd[s10 + 1] * fy) >> 8;
+      uint32_t v = (v0 * (256 - fx) + v1 * fx) >> 8;
+
+      const int id = idx(gx, gy);
+      const uint32_t c = (o * COVER_Q8) >> 8;
+      m_cnt[id] = c > 0xFFFF ? 0xFFFF : c;
+      m_speed[id] = v;
+    }
+  }
+}
+
+// 逐粒子：统计盖住各渲染格中心的粒子（旧方法，开销 ∝ 粒子数）
+void FluidRenderer::coverageFromParticles() {
   const int GS = m_renderGridSize;
   const int GC = GS * GS;
   const float CELL = 1.0f / GS;
 
-  /* 0️⃣ 备份上一帧状态 */
-  memcpy(m_prevFluid, m_currFluid, GC * sizeof(RenderFluidType));
-
-  /* 1️⃣ 统计粒子覆盖半径：cnt[] / acc[] ------------------------- */
-  static uint16_t cnt[MAX_GRID_CELLS];
-  static float acc[MAX_GRID_CELLS];
-  memset(cnt, 0, GC * sizeof(uint16_t));
-  memset(acc, 0, GC * sizeof(float));
+  memset(m_cnt, 0, GC * sizeof(uint16_t));
+  memset(m_speed, 0, GC * sizeof(uint32_t));
 
   const float r = PARTICLE_RADIUS;  // 归一化半径
   const float r2 = r * r;
@@ -88,7 +132,7 @@ void FluidRenderer::updateFluidCells() {
 
   for (int p = 0; p < N; ++p) {
     const float px = P[p].x, py = P[p].y;
-    const float sp = hypotf(P[p].vx, P[p].vy);
+    const uint32_t sp = uint32_t(hypotf(P[p].vx, P[p].vy) * 256.f);
 
     int gx0 = constrain(int((px - r) * GS), 0, GS - 1);
     int gy0 = constrain(int((py - r) * GS), 0, GS - 1);
@@ -104,21 +148,48 @@ void FluidRenderer::updateFluidCells() {
           continue;
 
         int id = idx(gx, gy);
-        ++cnt[id];
-        acc[id] += sp;
+        m_cnt[id] += 256;
+        m_speed[id] += sp;
       }
   }
 
+  for (int id = 0; id < GC; ++id)
+    if (m_cnt[id])
+      m_speed[id] = (m_speed[id] << 8) / m_cnt[id];
+}
+
+/******************************************************************
+ * FluidRenderer::updateFluidCells() -- 卷积-Closing 平滑液面边缘
+ *   ① 统计半径覆盖 → 基础分类
+ *   ② 形态学 closing(膨胀→腐蚀)  → 填平凹洞 / 削细尖
+ *   ③ 新生成的填充格设为 RENDER_FLUID_RIM_LIGHT
+ ******************************************************************/
+
+void FluidRenderer::updateFluidCells() {
+  const int GS = m_renderGridSize;
+  const int GC = GS * GS;
+
+  /* 1️⃣ 覆盖统计：cnt[] / speed[] ------------------------------ */
+#if RENDER_FROM_SIM_FIELD
+  coverageFromSimField();
+#else
+  coverageFromParticles();
+#endif
+
   /* 2️⃣ 基础分类 (Liquid / RimTransparent / Empty / Foam) -------- */
+  // 泡沫：速度超阈值，或所在模拟格是模拟端给出的泡沫候选（液面高速区）
+  constexpr uint32_t FOAM_Q8 = uint32_t(RENDER_FOAM_SPEED_THRESHOLD * 256);
+  constexpr int SGS = FluidSimulation::GS;
+  const CellStats& st = m_sim->cellStats();
   for (int id = 0; id < GC; ++id) {
-    const float n = cnt[id];
-    const float v = n ? acc[id] / n : 0.f;
-
-    if (n >= RENDER_PARTICLE_THRESHOLD)
-      m_currFluid[id] = (v > RENDER_FOAM_SPEED_THRESHOLD) ? RENDER_FLUID_FOAM
-                                                          : RENDER_FLUID_LIQUID;
-    else if (n >= RENDER_RIM_PARTICLE_THRESHOLD)
-      m_currFluid[id] = RENDER_FLUID_RIM_TRANSPARENT;
+    const uint32_t n = m_cnt[id];
+    const bool foam = m_speed[id] > FOAM_Q8 ||
+                      st.isFoam(id / GS * SGS / GS, id % GS * SGS / GS);
+
+    if (n >= RENDER_PARTICLE_THRESHOLD * 256)
+      m_currFluid[id] = foam ? RENDER_FLUID_FOAM : RENDER_FLUID_LIQUID;
+    else if (n >= RENDER_RIM_PARTICLE_THRESHOLD * 256)
+      m_currFluid[id] = foam ? RENDER_FLUID_FOAM : RENDER_FLUID_RIM_TRANSPARENT;
     else
       m_currFluid[id] = RENDER_FLUID_EMPTY;
   }
@@ -211,20 +282,219 @@ void FluidRenderer::updateFluidCells() {
       close[idx(gx, gy)] = all ? 1 : 0;
     }
 
-  /* 4-D 新填补的 EMPTY → RIM_LIGHT */
-  for (int i = 0; i < GC; ++i)
-    if (close[i] && !mask[i] && m_currFluid[i] == RENDER_FLUID_EMPTY)
-      m_currFluid[i] = RENDER_FLUID_RIM_LIGHT;
+  /* 4-C′ 次级粒子所在格子 → FOAM（不参与 closing，保留飞沫的离散感） */
+  if (m_secondary)
+    m_secondary->forEach([&](const SecondaryParticle& s) {
+      int gx = int(s.x * GS), gy = int(s.y * GS);
+      if (gx >= 0 && gx < GS && gy >= 0 && gy < GS)
+        m_currFluid[idx(gx, gy)] = RENDER_FLUID_FOAM;
+    });
+
+  /* 4-C″ 刚体覆盖的格子 → BODY（盖过液体，随位平面一起参与变化检测） */
+  stampBodies();
+
+  /* 4-D 新填补的 EMPTY → RIM_LIGHT，同时打包进本帧位平面 */
+  const int words = (GC + 31) / 32;
+  uint32_t(*cur)[PLANE_WORDS] = m_planes[m_planeCur];
+  uint32_t(*prev)[PLANE_WORDS] = m_planes[m_planeCur ^ 1];
+
+  for (int w = 0; w < words; ++w) {
+    const int base = w * 32;
+    const int n = min(32, GC - base);
+    uint32_t b0 = 0, b1 = 0, b2 = 0;
+    for (int k = 0; k < n; ++k) {
+      const int i = base + k;
+      if (close[i] && !mask[i] && m_currFluid[i] == RENDER_FLUID_EMPTY)
+        m_currFluid[i] = RENDER_FLUID_RIM_LIGHT;
+      const uint32_t t = m_currFluid[i];
+      b0 |= (t & 1) << k;
+      b1 |= (t >> 1 & 1) << k;
+      b2 |= (t >> 2 & 1) << k;
+    }
+    cur[0][w] = b0;
+    cur[1][w] = b1;
+    cur[2][w] = b2;
+  }
 
-  /* 5️⃣ 生成变化列表 --------------------------------------------- */
+  /* 5️⃣ 生成变化列表：逐字异或，只遍历置位 --------------------- */
   m_changedCnt = 0;
-  for (int i = 0; i < GC; ++i)
-    if (m_currFluid[i] != m_prevFluid[i])
-      m_changedIdx[m_changedCnt++] = i;
+  for (int w = 0; w < words; ++w) {
+    uint32_t diff = (cur[0][w] ^ prev[0][w]) | (cur[1][w] ^ prev[1][w]) |
+                    (cur[2][w] ^ prev[2][w]);
+    while (diff) {
+      m_changedIdx[m_changedCnt++] = w * 32 + __builtin_ctz(diff);
+      diff &= diff - 1;
+    }
+  }
+
+  /* 6️⃣ 交换缓冲：本帧即下一帧的「上一帧」 ----------------------- */
+  m_planeCur ^= 1;
+}
+
+// 只遍历每个刚体包围盒内的渲染格，以格心判定
+void FluidRenderer::stampBodies() {
+  const RigidBody* B = m_sim->rigidBodies();
+  const int GS = m_renderGridSize;
+  const float cell = 1.0f / GS;
+  for (int k = 0; k < m_sim->rigidCount(); ++k) {
+    const RigidBody& b = B[k];
+    const int gx0 = max(0, int((b.x - b.extentX()) * GS));
+    const int gy0 = max(0, int((b.y - b.extentY()) * GS));
+    const int gx1 = min(GS - 1, int((b.x + b.extentX()) * GS));
+    const int gy1 = min(GS - 1, int((b.y + b.extentY()) * GS));
+    for (int gx = gx0; gx <= gx1; ++gx)
+      for (int gy = gy0; gy <= gy1; ++gy)
+        if (b.contains((gx + 0.5f) * cell, (gy + 0.5f) * cell))
+          m_currFluid[idx(gx, gy)] = RENDER_FLUID_BODY;
+  }
+}
+// ------------------ 圆屏可见区 ------------------
+
+// 像素中心落在内切圆内即可见；方屏 (RENDER_ROUND_PANEL 0) 整行可见
+void FluidRenderer::buildVisibleSpans() {
+  constexpr float R = SCREEN_WIDTH * 0.5f;
+  for (int y = 0; y < SCREEN_HEIGHT; ++y) {
+#if RENDER_ROUND_PANEL
+    const float dy = y + 0.5f - SCREEN_HEIGHT * 0.5f;
+    const float half = sqrtf(R * R - dy * dy);
+    m_spanX0[y] = (uint8_t)max(0, (int)ceilf(R - 0.5f - half));
+    m_spanX1[y] = (uint8_t)min(SCREEN_WIDTH - 1, (int)floorf(R - 0.5f + half));
+#else
+    m_spanX0[y] = 0;
+    m_spanX1[y] = SCREEN_WIDTH - 1;
+#endif
+  }
+
+  for (int ty = 0; ty < TILE_N; ++ty) {
+    m_tileVisible[ty] = 0;
+    for (int tx = 0; tx < TILE_N; ++tx)
+      if (rectVisible(tx * RENDER_TILE_SIZE, ty * RENDER_TILE_SIZE,
+                      RENDER_TILE_SIZE, RENDER_TILE_SIZE))
+        m_tileVisible[ty] |= 1u << tx;
+  }
+}
+
+// 圆盘是凸的且上下对称：矩形内离圆心最近的那一行跨度最宽
+bool FluidRenderer::rectVisible(int x, int y, int w, int h) const {
+  const int r = constrain(SCREEN_HEIGHT / 2, y, y + h - 1);
+  return m_spanX0[r] <= x + w - 1 && m_spanX1[r] >= x;
+}
+
+// 把矩形收缩到它与可见圆盘交集的外包矩形，四边按 RENDER_SPAN_ALIGN
+// 向外对齐（输入须已对齐）；完全不可见时返回 false
+bool FluidRenderer::clipToVisible(int& x, int& y, int& w, int& h) const {
+  const int x1 = x + w - 1;
+  auto hits = [&](int row) {
+    return m_spanX0[row] <= x1 && m_spanX1[row] >= x;
+  };
+
+  int y0 = y, y1 = y + h - 1;
+  while (y0 <= y1 && !hits(y0))
+    ++y0;
+  if (y0 > y1)
+    return false;
+  while (!hits(y1))
+    --y1;
+
+  const int r = constrain(SCREEN_HEIGHT / 2, y0, y1);
+  int nx0 = max(x, (int)m_spanX0[r]);
+  int nx1 = min(x1, (int)m_spanX1[r]);
+
+  constexpr int A = RENDER_SPAN_ALIGN;
+  nx0 = nx0 / A * A;
+  y0 = y0 / A * A;
+  nx1 = nx1 / A * A + A - 1;
+  y1 = y1 / A * A + A - 1;
+
+  w = nx1 - nx0 + 1;
+  h = y1 - y0 + 1;
+  x = nx0;
+  y = y0;
+  return true;
+}
+
+// ------------------ 脏瓦片 ------------------
+
+// 像素闭区间 [x0,x1]×[y0,y1] 覆盖的瓦片标脏（自动裁到屏幕内）
+void FluidRenderer::markDirty(int x0, int y0, int x1, int y1) {
+  if (x1 < 0 || y1 < 0 || x0 >= SCREEN_WIDTH || y0 >= SCREEN_HEIGHT)
+    return;
+  x0 = constrain(x0, 0, SCREEN_WIDTH - 1) / RENDER_TILE_SIZE;
+  y0 = constrain(y0, 0, SCREEN_HEIGHT - 1) / RENDER_TILE_SIZE;
+  x1 = constrain(x1, 0, SCREEN_WIDTH - 1) / RENDER_TILE_SIZE;
+  y1 = constrain(y1, 0, SCREEN_HEIGHT - 1) / RENDER_TILE_SIZE;
+
+  const uint16_t bits = (2u << x1) - (1u << x0);
+  for (int ty = y0; ty <= y1; ++ty)
+    m_dirty[ty] |= bits & m_tileVisible[ty];
+}
+
+void FluidRenderer::markAllDirty() {
+  for (int ty = 0; ty < TILE_N; ++ty)
+    m_dirty[ty] = m_tileVisible[ty];
+}
+
+// 按瓦片行把连续的脏瓦片合并成一段，裁到可见圆盘 → f(x, y, w, h)，随后清空
+template <typename F>
+void FluidRenderer::forEachDirtyRun(F&& f) {
+  for (int ty = 0; ty < TILE_N; ++ty) {
+    uint32_t bits = m_dirty[ty];
+    m_dirty[ty] = 0;
+
+    while (bits) {
+      const int t0 = __builtin_ctz(bits);
+      const int t1 = t0 + __builtin_ctz(~(bits >> t0));  // 段后第一个净瓦片
+      bits &= ~((1u << t1) - 1);
+
+      int x = t0 * RENDER_TILE_SIZE;
+      int y = ty * RENDER_TILE_SIZE;
+      int w = min(t1 * RENDER_TILE_SIZE, SCREEN_WIDTH) - x;
+      int h = min(y + RENDER_TILE_SIZE, SCREEN_HEIGHT) - y;
+      if (clipToVisible(x, y, w, h))
+        f(x, y, w, h);
+    }
+  }
+}
+
+// 上一帧与本帧的粒子足迹都标脏：旧位置要擦掉，新位置要画上。
+// 屏幕位置与 key(i) 都没变的粒子画出来与上一帧相同，不标脏
+template <typename K>
+void FluidRenderer::markParticles(int radius, K&& key) {
+  auto mark = [&](int x, int y) {
+    markDirty(x - radius, y - radius, x + radius, y + radius);
+  };
+
+  for (int i = m_sim->particleCount(); i < m_prevCnt; ++i)
+    mark(m_prevX[i], m_prevY[i]);  // 粒子数减少：擦掉多出的
+
+  const Particle* P = m_sim->data();
+  const int N = m_sim->particleCount();
+  for (int i = 0; i < N; ++i) {
+    const int16_t x = (int16_t)(P[i].x * SCREEN_WIDTH);
+    const int16_t y = (int16_t)(P[i].y * SCREEN_HEIGHT);
+    const uint32_t k = key(i);
+    if (i < m_prevCnt) {
+      if (x == m_prevX[i] && y == m_prevY[i] && k == m_prevKey[i])
+        continue;
+      mark(m_prevX[i], m_prevY[i]);
+    }
+    mark(x, y);
+    m_prevX[i] = x;
+    m_prevY[i] = y;
+    m_prevKey[i] = k;
+  }
+  m_prevCnt = N;
 }
+
 // ------------------ 公共接口 ------------------
 
 void FluidRenderer::render(Mode mode) {
+  // 换模式后屏上内容不再可作增量基准
+  if (mode != m_lastMode) {
+    markAllDirty();
+    m_lastMode = mode;
+  }
+
   m_disp->startWrite();
   switch (mode) {
     case BALLS:
@@ -238,72 +508,132 @@ void FluidRenderer::render(Mode mode) {
       updateFluidCells();
       renderPartialGrid();
       break;
+    case METABALLS:
+      renderMetaballs();
+      break;
+    case SHADED:
+      renderShaded();
+      break;
   }
   m_disp->endWrite();
 }
 
 void FluidRenderer::renderBalls() {
-  // 1. 背景
-  m_disp->fillScreen(m_disp->color565(0, 0, 0));
+  constexpr int radius = (int)(SCREEN_WIDTH * PARTICLE_RADIUS);
+  constexpr float lutScale = (RENDER_BALL_LUT_SIZE - 1) /
+                             (RENDER_BALL_MAX_SPEED * RENDER_BALL_MAX_SPEED);
 
-  // 2. 容器边框
-  m_disp->drawRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, TFT_WHITE);
-
-  // 3. 画每个粒子
+  // 1. 颜色：速度² 查表
   const Particle* P = m_sim->data();
   const int N = m_sim->particleCount();
-  const int radius = (int)(m_renderCellSize * PARTICLE_RADIUS);
-
   for (int i = 0; i < N; ++i) {
-    int sx = (int)(P[i].x * SCREEN_WIDTH);
-    int sy = (int)(P[i].y * SCREEN_HEIGHT);
+    float v2 = P[i].vx * P[i].vx + P[i].vy * P[i].vy;
+    int li = (int)(v2 * lutScale);
+    m_ballColor[i] = m_ballLut[li < RENDER_BALL_LUT_SIZE - 1
+                                   ? li
+                                   : RENDER_BALL_LUT_SIZE - 1];
+  }
 
-    // 速度映射到颜色
-    float speed = sqrtf(P[i].vx * P[i].vx + P[i].vy * P[i].vy);
-    float t = constrain(speed / 8.0f, 0.0f, 1.0f);
-    uint16_t c = lerp565(m_ballBase, TFT_WHITE, t);
+  // 2. 旧/新足迹标脏
+  markParticles(radius, [&](int i) { return m_ballColor[i]; });
 
-    m_disp->fillCircle(sx, sy, radius, c);
-    m_disp->drawCircle(sx, sy, radius, TFT_NAVY);  // 细圈
-  }
+  // 3. 逐段重画：段是整瓦片高，再按 RENDER_SPAN_ALIGN 行一带裁到可见圆盘；
+  //    每带（裁剪到带内）背景 → 容器边框 → 相交的粒子
+  forEachDirtyRun([&](int rx, int ry, int rw, int rh) {
+    for (int yb = ry; yb < ry + rh; yb += RENDER_SPAN_ALIGN) {
+      int x = rx, y = yb, w = rw, h = RENDER_SPAN_ALIGN;
+      if (!clipToVisible(x, y, w, h))
+        continue;
+      m_disp->setClipRect(x, y, w, h);
+      m_disp->fillRect(x, y, w, h, TFT_BLACK);
+#if !RENDER_ROUND_PANEL
+      // 圆屏上方框只剩四个切点，不画
+      m_disp->drawRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, TFT_WHITE);
+#endif
+
+      for (int i = 0; i < m_prevCnt; ++i) {
+        const int sx = m_prevX[i], sy = m_prevY[i];
+        if (sx + radius < x || sx - radius >= x + w || sy + radius < y ||
+            sy - radius >= y + h)
+          continue;
+        m_disp->fillCircle(sx, sy, radius, m_ballColor[i]);
+        m_disp->drawCircle(sx, sy, radius, TFT_NAVY);  // 细圈
+      }
+    }
+    m_disp->clearClipRect();
+  });
 }
 
-void FluidRenderer::renderGrid() {
-  // 1. 先更新状态
-  updateFluidCells();
+void FluidRenderer::drawCell(int gx, int gy) {
+  int px = gx * m_renderCellSize;
+  int py = gy * m_renderCellSize;
 
-  // 2. 先清屏
-  m_disp->fillScreen(m_disp->color565(0, 0, 0));
+  if (isSimSolid(gx, gy)) {
+    m_disp->fillRect(px, py, m_renderCellSize, m_renderCellSize, m_gridSolid);
+    if (DRAW_RECT)
+      m_disp->drawRect(px, py, m_renderCellSize, m_renderCellSize,
+                       m_gridOutline);
+    return;
+  }
 
-  // 3. 逐格绘制
-  for (int gx = 0; gx < m_renderGridSize; ++gx) {
-    for (int gy = 0; gy < m_renderGridSize; ++gy) {
-      int px = gx * m_renderCellSize;
-      int py = gy * m_renderCellSize;
+  // 读取当前帧流体状态
+  RenderFluidType ft = m_currFluid[idx(gx, gy)];
+  m_disp->fillRect(px, py, m_renderCellSize, m_renderCellSize,
+                   m_fluidColor[ft]);
 
-      uint16_t color;
+  // （可选）描边
+  if (DRAW_RECT && ft != RENDER_FLUID_EMPTY)
+    m_disp->drawRect(px, py, m_renderCellSize, m_renderCellSize,
+                     ft == RENDER_FLUID_BODY ? m_gridOutline : m_gridRim);
 
-      if (isSimSolid(gx, gy)) {
-        color = m_gridSolid;  // 墙
-      } else {
-        // 读取当前帧流体状态
-        RenderFluidType ft = m_currFluid[idx(gx, gy)];
-        color = getFluidColor(ft);
-      }
+#if FLUID_RENDERER_VERIFY
+  m_shown[idx(gx, gy)] = ft;
+#endif
+}
 
-      m_disp->fillRect(px, py, m_renderCellSize, m_renderCellSize, color);
+// 重画与像素矩形相交的所有格子：格子互不重叠，伸出矩形的部分内容不变
+void FluidRenderer::drawCellsIn(int x, int y, int w, int h) {
+  const int cs = m_renderCellSize;
+  const int cover = m_renderGridSize * cs;
+
+  // 网格未铺满屏幕时（尺寸不整除），余下的边保持黑色
+  if (x + w > cover || y + h > cover)
+    m_disp->fillRect(x, y, w, h, TFT_BLACK);
+  if (x >= cover || y >= cover)
+    return;
+
+  const int gx1 = (min(x + w, cover) - 1) / cs;
+  const int gy1 = (min(y + h, cover) - 1) / cs;
+  for (int gx = x / cs; gx <= gx1; ++gx)
+    for (int gy = y / cs; gy <= gy1; ++gy)
+      if (rectVisible(gx * cs, gy * cs, cs, cs))  // 圆屏四角的格子不画
+        drawCell(gx, gy);
+}
 
-      // （可选）描边
-      if (DRAW_RECT)
-        m_disp->drawRect(px, py, m_renderCellSize, m_renderCellSize,
-                         m_disp->color565(10, 10, 20));
-    }
+void FluidRenderer::renderGrid() {
+  // 1. 先更新状态
+  updateFluidCells();
+
+  // 2. 变化格子所在瓦片标脏
+  const int cs = m_renderCellSize;
+  for (int n = 0; n < m_changedCnt; ++n) {
+    int gx = m_changedIdx[n] / m_renderGridSize;
+    int gy = m_changedIdx[n] % m_renderGridSize;
+    markDirty(gx * cs, gy * cs, gx * cs + cs - 1, gy * cs + cs - 1);
   }
+
+  // 3. 按瓦片整段重画
+  forEachDirtyRun(
+      [&](int x, int y, int w, int h) { drawCellsIn(x, y, w, h); });
 }
 
 void FluidRenderer::renderPartialGrid() {
   // 注意：updateFluidCells() 已在 render() 中调用
 
+  // 首帧 / invalidate() / 换模式：整屏已标脏，先按瓦片补画
+  forEachDirtyRun(
+      [&](int x, int y, int w, int h) { drawCellsIn(x, y, w, h); });
+
   // 统计并打印
   // Serial.printf("Changed cells this frame: %d\n", m_changedCnt);
 
@@ -315,17 +645,210 @@ void FluidRenderer::renderPartialGrid() {
     if (isSimSolid(gx, gy))
       continue;  // 固体不用重画
 
-    // 像素坐标
-    int px = gx * m_renderCellSize;
-    int py = gy * m_renderCellSize;
+    drawCell(gx, gy);
+  }
 
-    // 颜色
-    uint16_t color = getFluidColor(m_currFluid[idx]);
+#if FLUID_RENDERER_VERIFY
+  // 局部累积必须与整屏重绘一致：非固体格的屏上状态 == 本帧状态
+  const int GC = m_renderGridSize * m_renderGridSize;
+  for (int i = 0; i < GC; ++i)
+    if (!isSimSolid(i / m_renderGridSize, i % m_renderGridSize) &&
+        m_shown[i] != m_currFluid[i])
+      ++m_verifyMismatch;
+#endif
+}
 
-    // 绘制
-    m_disp->fillRect(px, py, m_renderCellSize, m_renderCellSize, color);
-    if (DRAW_RECT && m_currFluid[idx] != RENDER_FLUID_EMPTY)
-      m_disp->drawRect(px, py, m_renderCellSize, m_renderCellSize,
-                       m_disp->color565(0, 0, 200));
+/******************************************************************
+ * 元球渲染：全部整数运算
+ *   ① 每个粒子把核累加到 61×61 定点场（饱和加）
+ *   ② 只对脏瓦片段：每 4 行一带，竖向插值出采样行 → 横向插值到像素
+ *   ③ 场值落在 [ISO - EDGE/2, ISO + EDGE/2] 内线性过渡（抗锯齿）
+ ******************************************************************/
+
+void FluidRenderer::splatMetaField() {
+  memset(m_metaField, 0, sizeof(m_metaField));
+
+  const Particle* P = m_sim->data();
+  const int N = m_sim->particleCount();
+
+  for (int p = 0; p < N; ++p) {
+    // 场定点坐标（每粒子唯一一次浮点转换）
+    const int32_t qx = int32_t(P[p].x * (RENDER_META_GRID * META_Q));
+    const int32_t qy = int32_t(P[p].y * (RENDER_META_GRID * META_Q));
+
+    int i0 = (qx - META_RQ + META_Q - 1) / META_Q;
+    int j0 = (qy - META_RQ + META_Q - 1) / META_Q;
+    int i1 = (qx + META_RQ) / META_Q;
+    int j1 = (qy + META_RQ) / META_Q;
+    i0 = constrain(i0, 0, META_N - 1);
+    j0 = constrain(j0, 0, META_N - 1);
+    i1 = constrain(i1, 0, META_N - 1);
+    j1 = constrain(j1, 0, META_N - 1);
+
+    for (int j = j0; j <= j1; ++j) {
+      const int32_t dy = j * META_Q - qy;
+      uint16_t* row = &m_metaField[j * META_N];
+      for (int i = i0; i <= i1; ++i) {
+        const int32_t dx = i * META_Q - qx;
+        const uint32_t k = uint32_t(dx * dx + dy * dy) >> META_KERNEL_SHIFT;
+        if (k >= META_KERNEL_SIZE)
+          continue;
+        const uint32_t v = row[i] + m_metaKernel[k];
+        row[i] = v > 0xFFFF ? 0xFFFF : v;
+      }
+    }
   }
-}
\ No newline at end of file
+}
+
+void FluidRenderer::renderMetaballs() {
+  // 粒子影响范围：核半径 + 一个插值间距
+  constexpr int FOOT = META_RQ * META_PX / META_Q + META_PX + 1;
+
+  splatMetaField();
+  // 场只取决于粒子的场定点坐标
+  const Particle* P = m_sim->data();
+  markParticles(FOOT, [&](int i) {
+    const int32_t qx = int32_t(P[i].x * (RENDER_META_GRID * META_Q));
+    const int32_t qy = int32_t(P[i].y * (RENDER_META_GRID * META_Q));
+    return uint32_t(qx) << 16 ^ uint32_t(qy & 0xFFFF);
+  });
+
+  // 插值后的场值放大了 META_PX² 倍
+  constexpr int SCALE = META_PX * META_PX;
+  constexpr int32_t LO = (RENDER_META_ISO - RENDER_META_EDGE / 2) * SCALE;
+  constexpr int32_t SPAN = RENDER_META_EDGE * SCALE;  // 2 的幂
+  constexpr int ALPHA_SHIFT = __builtin_ctz(SPAN) - 8;
+
+  int32_t rowv[META_N];
+
+  // 只计算并推送脏段；段边界按 META_PX 对齐
+  forEachDirtyRun([&](int rx, int y, int rw, int h) {
+    for (int yb = y; yb < y + h; yb += META_PX) {
+      // 每带再按圆屏可见跨度收窄
+      int x = rx, by = yb, w = rw, bh = META_PX;
+      if (!clipToVisible(x, by, w, bh))
+        continue;
+      const int i0 = x / META_PX, i1 = (x + w) / META_PX;  // 采样列 [i0,i1]
+
+      const uint16_t* f0 = &m_metaField[(yb / META_PX) * META_N];
+      const uint16_t* f1 = f0 + META_N;
+
+      for (int wy = 0; wy < META_PX; ++wy) {
+        // 竖向插值
+        for (int i = i0; i <= i1; ++i)
+          rowv[i] = f0[i] * (META_PX - wy) + f1[i] * wy;
+
+        // 横向插值 + 软阈值
+        uint16_t* out = &m_lineBuf[wy * w];
+        for (int i = i0; i < i1; ++i) {
+          const int32_t a = rowv[i] * META_PX;
+          const int32_t d = rowv[i + 1] - rowv[i];
+          for (int wx = 0; wx < META_PX; ++wx) {
+            int32_t t = (a + d * wx - LO) >> ALPHA_SHIFT;
+            *out++ = m_metaLut[t < 0 ? 0 : (t > 255 ? 255 : t)];
+          }
+        }
+      }
+
+      m_disp->pushImage(x, yb, w, META_PX, m_lineBuf);
+    }
+  });
+}
+
+/******************************************************************
+ * 明暗渲染：覆盖度与速度合成连续亮度，8 级有序抖动输出
+ *   亮度 I（Q8）= 覆盖度 × (L-3) + 速度 × 2，即前 L-3 级表示深浅、
+ *   最后两级表示泡沫；像素级 = (I + Bayer 阈值) >> 8。
+ *   浮点只在每格算一次，像素循环内只有整数加法与查表。
+ ******************************************************************/
+
+// 4×4 Bayer 矩阵，阈值 ∈ [0,256)
+static const uint8_t BAYER4[4][4] = {{0, 128, 32, 160},
+                                     {192, 64, 224, 96},
+                                     {48, 176, 16, 144},
+                                     {240, 112, 208, 80}};
+
+void FluidRenderer::renderShaded() {
+  constexpr int L = RENDER_SHADE_LEVELS;
+  constexpr int IMAX = (L - 1) * 256;
+  constexpr int FOAM_Q8 = int(RENDER_SHADE_FOAM_SPEED * 256);
+
+  // 1. 状态与覆盖统计
+  updateFluidCells();
+
+  // 2. 每格亮度；值变化或落在两级之间（时间抖动会变）的格子标脏
+  const int GS = m_renderGridSize;
+  const int cs = m_renderCellSize;
+  for (int gx = 0; gx < GS; ++gx)
+    for (int gy = 0; gy < GS; ++gy) {
+      const int id = idx(gx, gy);
+      uint16_t I;
+      if (isSimSolid(gx, gy)) {
+        I = SHADE_SOLID;
+      } else if (m_currFluid[id] == RENDER_FLUID_BODY) {
+        I = SHADE_BODY;
+      } else {
+        const int n = m_cnt[id];
+        int cov = n >= RENDER_SHADE_FULL_COUNT * 256
+                      ? 256
+                      : n / RENDER_SHADE_FULL_COUNT;
+        int spd = int(m_speed[id] * 256 / FOAM_Q8);
+        spd = spd > 256 ? 256 : spd;
+        int v = cov * (L - 3) + (cov * spd >> 8) * 2;
+        I = v > IMAX ? IMAX : v;
+      }
+
+      bool dirty = I != m_shade[id];
+#if RENDER_SHADE_TEMPORAL
+      dirty |= I < SHADE_BODY && (I & 0xFF) != 0;
+#endif
+      if (dirty)
+        markDirty(gx * cs, gy * cs, gx * cs + cs - 1, gy * cs + cs - 1);
+      m_shade[id] = I;
+    }
+
+  // 3. 时间抖动：每帧把 Bayer 图样平移 (2,0)/(0,2)/(2,2)，空间均值不变
+#if RENDER_SHADE_TEMPORAL
+  const int ox = (m_ditherFrame & 1) * 2, oy = (m_ditherFrame & 2);
+  ++m_ditherFrame;
+#else
+  const int ox = 0, oy = 0;
+#endif
+
+  // 4. 逐段输出：每 4 行一带 pushImage
+  const int cover = GS * cs;
+  forEachDirtyRun([&](int rx, int y, int rw, int h) {
+    for (int yb = y; yb < y + h; yb += META_PX) {
+      // 每带再按圆屏可见跨度收窄
+      int x = rx, by = yb, w = rw, bh = META_PX;
+      if (!clipToVisible(x, by, w, bh))
+        continue;
+      uint16_t* out = m_lineBuf;
+      for (int py = yb; py < yb + META_PX; ++py) {
+        const uint8_t* thr = BAYER4[(py + oy) & 3];
+        const int gy = py / cs;
+        int gx = x / cs, sub = x - gx * cs;
+        for (int px = x; px < x + w; ++px) {
+          uint16_t c = TFT_BLACK;
+          if (px < cover && py < cover) {
+            const uint16_t I = m_shade[idx(gx, gy)];
+            if (I == SHADE_SOLID) {
+              c = m_gridSolid;
+            } else if (I == SHADE_BODY) {
+              c = m_gridBody;
+            } else {
+              int l = (I + thr[(px + ox) & 3]) >> 8;
+              c = m_shadeLut[l < L - 1 ? l : L - 1];
+            }
+          }
+          *out++ = c;
+          if (++sub == cs) {
+            sub = 0;
+            ++gx;
+          }
+        }
+      }
+      m_disp->pushImage(x, yb, w, META_PX, m_lineBuf);
+    }
+  });
+}
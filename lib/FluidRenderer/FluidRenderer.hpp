@@ -1,6 +1,7 @@
 #pragma once
 #include <LovyanGFX.h>
-#include "ParticleSimulation.hpp"
+#include "FluidSimulation.hpp"
+#include "SecondaryPool.hpp"
 
 #define RENDER_GRID_SIZE 48
 #define RENDER_PIXEL_PER_CELL SCREEN_HEIGHT / RENDER_GRID_SIZE
@@ -10,24 +11,61 @@
 #define RENDER_RIM_LIGHT_WIDTH 1         // 老代码：光晕向外扩张曼哈顿半径
 #define RENDER_EDGE_SMOOTH_RADIUS 3      // ★ 新增：closing 卷积半径 (≥1)
 #define RENDER_FOAM_SPEED_THRESHOLD 99.0f  // 泡沫速度阈值
+// 覆盖统计来源：1 = 插值放大模拟端的逐格占有场（与粒子数无关）；
+// 0 = 逐粒子按半径覆盖渲染格（旧方法）
+#ifndef RENDER_FROM_SIM_FIELD
+#define RENDER_FROM_SIM_FIELD 1
+#endif
+#define RENDER_BALL_LUT_SIZE 256          // 小球速度→颜色渐变表长度
+#define RENDER_BALL_MAX_SPEED 8.0f        // 该速度及以上映射为纯白
+// 元球（metaball）：低分辨率定点标量场 → 双线性放大 → 软阈值
+#define RENDER_META_GRID 60     // 场格数（每格 4 px，采样点 61×61）
+#define RENDER_META_RADIUS 3.75f  // 核半径（场格）≈ 2 × 粒子半径
+#define RENDER_META_PEAK 1024     // 单粒子核峰值（定点）
+#define RENDER_META_ISO 512       // 等值面阈值
+#define RENDER_META_EDGE 256      // 软边宽度（场值），须为 2 的幂
+// 明暗模式：覆盖度 + 速度 → 连续亮度 → 8 级调色板，4×4 Bayer 有序抖动
+#define RENDER_SHADE_LEVELS 8
+#define RENDER_SHADE_FULL_COUNT 4    // 覆盖粒子数达到该值即满亮度
+#define RENDER_SHADE_FOAM_SPEED 4.0f  // 平均速度达到该值即全白（泡沫）
+#define RENDER_SHADE_TEMPORAL 1       // 抖动图样逐帧平移（时间抖动）
+#define RENDER_TILE_SIZE 16  // 脏瓦片边长 (px)，须为元球带高的整数倍
+#ifndef RENDER_ROUND_PANEL
+#define RENDER_ROUND_PANEL 1  // GC9A01 圆屏：只推送可见圆盘内的像素
+#endif
+#define RENDER_SPAN_ALIGN 4  // 可见裁剪后矩形的对齐 (px)，= 元球带高
+// 调试：每次局部重绘后校验「屏上状态 == 本帧状态」（等价于整屏重绘）
+#ifndef FLUID_RENDERER_VERIFY
+#define FLUID_RENDERER_VERIFY 0
+#endif
 // 渲染器使用的流体类型定义
 enum RenderFluidType : uint8_t {
   RENDER_FLUID_EMPTY,
   RENDER_FLUID_LIQUID,
   RENDER_FLUID_FOAM,
   RENDER_FLUID_RIM_TRANSPARENT,
-  RENDER_FLUID_RIM_LIGHT
+  RENDER_FLUID_RIM_LIGHT,
+  RENDER_FLUID_BODY,  // 刚体（模拟端 rigidBodies()）
+  RENDER_FLUID_TYPE_COUNT
 };
 
 class FluidRenderer {
  public:
-  enum Mode { BALLS, GRID, PARTIAL_GRID, PARTIAL_BALLS };
+  enum Mode { BALLS, GRID, PARTIAL_GRID, PARTIAL_BALLS, METABALLS, SHADED };
 
-  FluidRenderer(lgfx::LGFX_Device* disp, const ParticleSimulation* sim)
+  // disp 可以是面板 (LGFX_Device) 也可以是内存帧缓冲 (LGFX_Sprite, RGB565)
+  FluidRenderer(lgfx::LovyanGFX* disp, const FluidSimulation* sim)
       : m_disp(disp), m_sim(sim) {
     // 初始化状态数组
-    memset(m_prevFluid, 0, sizeof(m_prevFluid));
+    memset(m_planes, 0, sizeof(m_planes));
     memset(m_currFluid, 0, sizeof(m_currFluid));
+    memset(m_shade, 0, sizeof(m_shade));
+    rebuildBallLut();
+    rebuildCellPalette();
+    buildMetaKernel();
+    buildVisibleSpans();
+    buildUpsample();
+    markAllDirty();
   }
 
   void render(Mode mode);
@@ -36,24 +74,53 @@ class FluidRenderer {
   void renderBalls();
   void renderGrid();
   void renderPartialGrid();
+  void renderMetaballs();
+  void renderShaded();
 
   // 新增：更新流体状态（从粒子数据计算渲染网格状态）
   void updateFluidCells();
 
-  // 配色
-  void setBallBaseColor(uint16_t c) { m_ballBase = c; }
-  void setGridSolidColor(uint16_t c) { m_gridSolid = c; }
-  void setGridFluidColor(uint16_t c) { m_gridFluid = c; }
+  // 下一帧整屏重绘（屏幕内容被外部改动后调用）
+  void invalidate() { markAllDirty(); }
+  // FLUID_RENDERER_VERIFY 下累计的局部/整屏不一致格子数
+  uint32_t verifyMismatches() const { return m_verifyMismatch; }
+
+  // 次级粒子（泡沫/飞沫/气泡）：所在渲染格显示为泡沫；nullptr = 不显示
+  void setSecondary(const SecondaryPool* pool) { m_secondary = pool; }
+
+  // 配色：调色板只在这里重建，绘制循环内只查表；
+  // 屏上旧颜色不在脏区跟踪之内，下一帧整屏重绘
+  void setBallBaseColor(uint16_t c) {
+    m_ballBase = c;
+    rebuildBallLut();
+    markAllDirty();
+  }
+  void setGridSolidColor(uint16_t c) {
+    m_gridSolid = c;
+    markAllDirty();
+  }
+  void setGridFluidColor(uint16_t c) {
+    m_gridFluid = c;
+    rebuildCellPalette();
+    markAllDirty();
+  }
+  void setBodyColor(uint16_t c) {
+    m_gridBody = c;
+    rebuildCellPalette();
+    markAllDirty();
+  }
 
   // 设置渲染网格大小（默认与模拟网格相同）
   void setRenderGridSize(int size) {
     m_renderGridSize = size;
     m_renderCellSize = SCREEN_WIDTH / size;
+    buildUpsample();
   }
 
  private:
-  lgfx::LGFX_Device* m_disp;
-  const ParticleSimulation* m_sim;
+  lgfx::LovyanGFX* m_disp;
+  const FluidSimulation* m_sim;
+  const SecondaryPool* m_secondary = nullptr;
 
   // 渲染网格参数
   int m_renderGridSize = RENDER_GRID_SIZE;
@@ -62,27 +129,121 @@ class FluidRenderer {
   // 状态追踪（使用最大可能的网格大小）
   static constexpr int MAX_GRID_CELLS = RENDER_GRID_SIZE * RENDER_GRID_SIZE;
 
-  RenderFluidType m_prevFluid[MAX_GRID_CELLS];
+  // 状态位平面（3 位/格，每平面 1 位/格）：双缓冲，按帧交替，无需 memcpy 备份；
+  // 两帧异或后按字 ctz 遍历即得变化格子
+  static constexpr int PLANE_WORDS = (MAX_GRID_CELLS + 31) / 32;
+  static constexpr int PLANE_BITS = 3;  // RenderFluidType < 8
+  static_assert(RENDER_FLUID_TYPE_COUNT <= (1 << PLANE_BITS),
+                "RenderFluidType 超出位平面容量");
+  uint32_t m_planes[2][PLANE_BITS][PLANE_WORDS];
+  uint8_t m_planeCur = 0;
   RenderFluidType m_currFluid[MAX_GRID_CELLS];
   int m_changedIdx[MAX_GRID_CELLS];
   int m_changedCnt = 0;
 
+  // 脏瓦片：所有模式共用，每个瓦片行一个位图（15 个瓦片 ≤ 16 位）
+  static constexpr int TILE_N =
+      (SCREEN_WIDTH + RENDER_TILE_SIZE - 1) / RENDER_TILE_SIZE;
+  uint16_t m_dirty[TILE_N];
+  int m_lastMode = -1;
+
+  // 圆屏可见区：每行可见像素 [x0, x1]；每瓦片行可见瓦片位图
+  uint8_t m_spanX0[SCREEN_HEIGHT];
+  uint8_t m_spanX1[SCREEN_HEIGHT];
+  uint16_t m_tileVisible[TILE_N];
+
+  // 上一帧粒子的屏幕位置（BALLS / METABALLS 擦除旧足迹用）
+  int16_t m_prevX[FluidSimulation::PC_MAX];
+  int16_t m_prevY[FluidSimulation::PC_MAX];
+  uint32_t m_prevKey[FluidSimulation::PC_MAX];  // 画法相关的其余状态（颜色等）
+  int m_prevCnt = 0;
+  uint16_t m_ballColor[FluidSimulation::PC_MAX];
+
+#if FLUID_RENDERER_VERIFY
+  RenderFluidType m_shown[MAX_GRID_CELLS];  // 屏上实际显示的状态
+#endif
+  uint32_t m_verifyMismatch = 0;
+
   // 临时缓冲区
   RenderFluidType m_convTmp[MAX_GRID_CELLS];
 
+  // 覆盖统计（updateFluidCells 填充）：覆盖粒子数 Q8 / 平均速度 Q8
+  uint16_t m_cnt[MAX_GRID_CELLS];
+  uint32_t m_speed[MAX_GRID_CELLS];  // 逐粒子路径中先作累加器
+
+  // 模拟格 → 渲染格插值表：每个渲染行/列对应的模拟格下标与权重 (Q8)
+  uint8_t m_upIdx[RENDER_GRID_SIZE];
+  uint16_t m_upW[RENDER_GRID_SIZE];
+
+  // 明暗模式：每格亮度（Q8，级数 × 256；SHADE_SOLID / SHADE_BODY = 容器 / 刚体）
+  static constexpr uint16_t SHADE_SOLID = 0xFFFF;
+  static constexpr uint16_t SHADE_BODY = 0xFFFE;
+  uint16_t m_shade[MAX_GRID_CELLS];
+  uint16_t m_shadeLut[RENDER_SHADE_LEVELS];
+  uint8_t m_ditherFrame = 0;
+
   // 颜色配置
   uint16_t m_ballBase = TFT_CYAN;
   uint16_t m_gridSolid = TFT_DARKGREY;
-  uint16_t m_gridFluid = TFT_BLUE;
-  uint16_t m_gridFoam = TFT_WHITE;
+  uint16_t m_gridFluid = lgfx::color565(0, 240, 255);
+  uint16_t m_gridFoam = lgfx::color565(200, 200, 230);
+  uint16_t m_gridRim = lgfx::color565(0, 0, 200);       // 光晕 / 描边
+  uint16_t m_gridOutline = lgfx::color565(10, 10, 20);  // 固体格描边
+  uint16_t m_gridBody = lgfx::color565(230, 140, 40);   // 刚体
+
+  // 预计算调色板
+  uint16_t m_ballLut[RENDER_BALL_LUT_SIZE];         // 下标 ∝ 速度²
+  uint16_t m_fluidColor[RENDER_FLUID_TYPE_COUNT];  // RenderFluidType → 565
+
+  // 元球：场、核查找表（按距离² 取下标）、按带输出的扫描线
+  static constexpr int META_N = RENDER_META_GRID + 1;  // 每轴采样点
+  static constexpr int META_PX = SCREEN_WIDTH / RENDER_META_GRID;  // 4
+  static constexpr int META_Q = 256;  // 场坐标定点：1 格 = 256
+  static constexpr int META_RQ = int(RENDER_META_RADIUS * META_Q);
+  static constexpr int META_KERNEL_SHIFT = 12;
+  static constexpr int META_KERNEL_SIZE =
+      ((META_RQ * META_RQ) >> META_KERNEL_SHIFT) + 1;
+
+  uint16_t m_metaField[META_N * META_N];
+  uint16_t m_metaKernel[META_KERNEL_SIZE];
+  uint16_t m_metaLut[256];                        // 覆盖度 → 565
+  uint16_t m_lineBuf[META_PX * SCREEN_WIDTH];  // 一带（4 行）像素
+
+  void rebuildBallLut();
+  void rebuildCellPalette();
+  void buildMetaKernel();
+  void splatMetaField();
+
+  void markDirty(int x0, int y0, int x1, int y1);
+  void markAllDirty();
+  template <typename F>
+  void forEachDirtyRun(F&& f);
+  template <typename K>
+  void markParticles(int radius, K&& key);
+  void buildUpsample();
+  void coverageFromSimField();
+  void coverageFromParticles();
+  void buildVisibleSpans();
+  bool rectVisible(int x, int y, int w, int h) const;
+  bool clipToVisible(int& x, int& y, int& w, int& h) const;
+  void drawCellsIn(int x, int y, int w, int h);
+  void stampBodies();
 
   // 辅助函数
-  inline uint16_t lerp565(uint16_t c1, uint16_t c2, float t) const;
+  // 整数 565 混合：a ∈ [0,256]，0 → c1，256 → c2
+  static inline uint16_t blend565(uint16_t c1, uint16_t c2, uint32_t a) {
+    uint32_t r = (((c1 >> 11) & 0x1F) * (256 - a) + ((c2 >> 11) & 0x1F) * a +
+                  128) >> 8;
+    uint32_t g = (((c1 >> 5) & 0x3F) * (256 - a) + ((c2 >> 5) & 0x3F) * a +
+                  128) >> 8;
+    uint32_t b = ((c1 & 0x1F) * (256 - a) + (c2 & 0x1F) * a + 128) >> 8;
+    return (r << 11) | (g << 5) | b;
+  }
   inline int idx(int x, int y) const { return x * m_renderGridSize + y; }
 
-  // 获取渲染网格对应的流体类型颜色
-  uint16_t getFluidColor(RenderFluidType type) const;
-
   // 检查模拟网格中的固体单元（需要坐标转换）
   bool isSimSolid(int renderGx, int renderGy) const;
+
+  // 单格绘制：GRID 与 PARTIAL_GRID 共用，保证局部累积 == 整屏重绘
+  void drawCell(int gx, int gy);
 };
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include <Arduino.h>
+
+#include "ImuTrace.hpp"
+
+static int16_t quantize(float value, float per_lsb) {
+  float q = value / per_lsb;
+  q += q < 0 ? -0.5f : 0.5f;
+  if (q > 32767.0f)
+    return 32767;
+  if (q < -32768.0f)
+    return -32768;
+  return static_cast<int16_t>(q);
+}
+
+static constexpr float ACC_LSB_G = IMU_TRACE_ACC_UNIT_UG / 1e6f;
+static constexpr float GYRO_LSB_DPS = IMU_TRACE_GYRO_UNIT_MDPS / 1e3f;
+
+// ------------------ recorder ------------------
+
+void ImuTraceRecorder::begin(ImuSource* source, Print* out) {
+  m_source = source;
+  m_out = out;
+  m_pending = {};
+  m_hasAcc = m_hasGyro = false;
+  m_records = 0;
+  m_lastUs = micros();
+
+  ImuTraceHeader header = {IMU_TRACE_MAGIC, IMU_TRACE_VERSION,
+                           sizeof(ImuTraceRecord), IMU_TRACE_ACC_UNIT_UG,
+                           IMU_TRACE_GYRO_UNIT_MDPS};
+  m_out->write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+}
+
+void ImuTraceRecorder::end() {
+  flush();
+}
+
+void ImuTraceRecorder::open(bool& channel) {
+  // same channel read twice: the previous frame is complete
+  if (channel)
+    flush();
+
+  if (!m_hasAcc && !m_hasGyro)
+    m_pendingUs = micros();
+
+  channel = true;
+}
+
+void ImuTraceRecorder::flush() {
+  if (!m_out || (!m_hasAcc && !m_hasGyro))
+    return;
+
+  uint32_t dt = (m_pendingUs - m_lastUs) / IMU_TRACE_DT_UNIT_US;
+  m_pending.dt = dt > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(dt);
+  m_lastUs = m_pendingUs;
+
+  m_out->write(reinterpret_cast<const uint8_t*>(&m_pending),
+               sizeof(m_pending));
+  m_records++;
+
+  // keep the sample values: a channel that is not re-read repeats
+  m_hasAcc = m_hasGyro = false;
+}
+
+bool ImuTraceRecorder::readAccelerometer(float* ax, float* ay, float* az) {
+  if (!m_source->readAccelerometer(ax, ay, az))
+    return false;
+
+  open(m_hasAcc);
+  m_pending.acc[0] = quantize(*ax, ACC_LSB_G);
+  m_pending.acc[1] = quantize(*ay, ACC_LSB_G);
+  m_pending.acc[2] = quantize(*az, ACC_LSB_G);
+
+  return true;
+}
+
+bool ImuTraceRecorder::readGyroscope(float* gx, float* gy, float* gz) {
+  if (!m_source->readGyroscope(gx, gy, gz))
+    return false;
+
+  open(m_hasGyro);
+  m_pending.gyro[0] = quantize(*gx, GYRO_LSB_DPS);
+  m_pending.gyro[1] = quantize(*gy, GYRO_LSB_DPS);
+  m_pending.gyro[2] = quantize(*gz, GYRO_LSB_DPS);
+
+  return true;
+}
+
+// ------------------ replay ------------------
+
+bool ImuTraceReplay::begin(const uint8_t* trace,
+                           size_t length,
+                           bool realtime) {
+  ImuTraceHeader header;
+  if (!trace || length < sizeof(header))
+    return false;
+
+  memcpy(&header, trace, sizeof(header));
+  if (header.magic != IMU_TRACE_MAGIC || header.version != IMU_TRACE_VERSION ||
+      header.recordSize != sizeof(ImuTraceRecord))
+    return false;
+
+  m_records = reinterpret_cast<const ImuTraceRecord*>(trace + sizeof(header));
+  m_count = (length - sizeof(header)) / sizeof(ImuTraceRecord);
+  m_accScale = header.accUnit / 1e6f;
+  m_gyroScale = header.gyroUnit / 1e3f;
+  m_realtime = realtime;
+
+  // the looped trace repeats record 0 one record interval after the last;
+  // record 0's own dt is the gap since the recorder started, so the last
+  // interval of the trace stands in for it
+  m_periodUs = 0;
+  for (uint32_t i = 1; i < m_count; i++)
+    m_periodUs += uint64_t(m_records[i].dt) * IMU_TRACE_DT_UNIT_US;
+  m_wrapUs = m_count > 1
+                 ? uint64_t(m_records[m_count - 1].dt) * IMU_TRACE_DT_UNIT_US
+                 : 0;
+  m_periodUs += m_wrapUs;
+
+  rewind();
+  return m_count > 0;
+}
+
+void ImuTraceReplay::rewind() {
+  m_startUs = micros();
+  m_nowUs = 0;
+  m_recordUs = 0;
+  m_index = 0;
+}
+
+const ImuTraceRecord* ImuTraceReplay::current() {
+  if (m_count == 0)
+    return nullptr;
+
+  if (m_realtime)
+    m_nowUs = micros() - m_startUs;
+
+  const bool loop = m_loop && m_periodUs > 0;
+  if (loop && m_nowUs >= m_periodUs) {
+    // skip whole periods at once; only the last, partial one is walked
+    const uint64_t skip = (m_nowUs - m_recordUs) / m_periodUs * m_periodUs;
+    m_nowUs -= skip;
+    if (m_realtime)
+      m_startUs += static_cast<uint32_t>(skip);
+  }
+
+  // advance while the next record has already started
+  while (m_index + 1 < m_count || loop) {
+    uint64_t next = m_recordUs + intervalAfter(m_index);
+    if (next > m_nowUs)
+      break;
+
+    if (m_index + 1 < m_count) {
+      m_recordUs = next;
+      m_index++;
+      continue;
+    }
+
+    // wrap around: the last record has been held for its interval; the
+    // clock is rebased, not reset, so the overshoot carries into the loop
+    m_nowUs -= next;
+    if (m_realtime)
+      m_startUs += static_cast<uint32_t>(next);
+    m_recordUs = 0;
+    m_index = 0;
+  }
+
+  return &m_records[m_index];
+}
+
+uint64_t ImuTraceReplay::intervalAfter(uint32_t index) const {
+  if (index + 1 < m_count)
+    return uint64_t(m_records[index + 1].dt) * IMU_TRACE_DT_UNIT_US;
+  return m_wrapUs;
+}
+
+bool ImuTraceReplay::finished() {
+  current();
+  return !m_loop && m_index + 1 >= m_count;
+}
+
+bool ImuTraceReplay::readAccelerometer(float* ax, float* ay, float* az) {
+  const ImuTraceRecord* r = current();
+  if (!r)
+    return false;
+
+  *ax = r->acc[0] * m_accScale;
+  *ay = r->acc[1] * m_accScale;
+  *az = r->acc[2] * m_accScale;
+
+  return true;
+}
+
+bool ImuTraceReplay::readGyroscope(float* gx, float* gy, float* gz) {
+  const ImuTraceRecord* r = current();
+  if (!r)
+    return false;
+
+  *gx = r->gyro[0] * m_gyroScale;
+  *gy = r->gyro[1] * m_gyroScale;
+  *gz = r->gyro[2] * m_gyroScale;
+
+  return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "imu_source.hpp"
+
+/*
+ * Binary IMU trace format (little-endian)
+ *
+ *   header  (12 bytes)
+ *     uint32  magic            "IMUT"
+ *     uint16  version
+ *     uint16  record size      sizeof(ImuTraceRecord)
+ *     uint16  acc unit         µg per LSB   (1000 → 1 mg)
+ *     uint16  gyro unit        mdps per LSB (100  → 0.1 dps)
+ *
+ *   records (14 bytes each)
+ *     uint16  dt               time since previous record, 100 µs units,
+ *                              saturating at 6.5535 s
+ *     int16   ax, ay, az       acc  / acc unit
+ *     int16   gx, gy, gz       gyro / gyro unit
+ *
+ * A record holds the latest accelerometer and gyroscope values at the time
+ * of the first read that opened it, so gyro-only polling (sleep state) and
+ * acc+gyro frames (running state) share one format.
+ */
+
+#define IMU_TRACE_MAGIC 0x54554D49u  // "IMUT"
+#define IMU_TRACE_VERSION 1
+#define IMU_TRACE_ACC_UNIT_UG 1000    // 1 mg per LSB, ±32 g
+#define IMU_TRACE_GYRO_UNIT_MDPS 100  // 0.1 dps per LSB, ±3276 dps
+#define IMU_TRACE_DT_UNIT_US 100
+
+struct __attribute__((packed)) ImuTraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint16_t accUnit;
+  uint16_t gyroUnit;
+};
+
+struct __attribute__((packed)) ImuTraceRecord {
+  uint16_t dt;
+  int16_t acc[3];
+  int16_t gyro[3];
+};
+
+/**
+ * Pass-through recorder: forwards every read to the wrapped source and
+ * streams the samples as trace records to `out` (typically `Serial`).
+ *
+ * Reads of acc and gyro within one frame are merged into a single record;
+ * a repeated read of the same channel closes the record. Rotation
+ * increments are forwarded but not recorded: the format has no field for
+ * them, so a replay integrates the gyroscope instead.
+ */
+class ImuTraceRecorder : public ImuSource {
+ private:
+  ImuSource* m_source = nullptr;
+  Print* m_out = nullptr;
+
+  ImuTraceRecord m_pending = {};
+  bool m_hasAcc = false;
+  bool m_hasGyro = false;
+  uint32_t m_pendingUs = 0;
+  uint32_t m_lastUs = 0;
+  uint32_t m_records = 0;
+
+  void open(bool& channel);
+  void flush();
+
+ public:
+  /// @brief starts a new trace and writes its header to `out`
+  void begin(ImuSource* source, Print* out);
+  /// @brief writes the pending record, if any
+  void end();
+
+  uint32_t records() const { return m_records; }
+
+  bool readAccelerometer(float* ax, float* ay, float* az) override;
+  bool readGyroscope(float* gx, float* gy, float* gz) override;
+  bool readRotationIncrement(int16_t* dq) override {
+    return m_source->readRotationIncrement(dq);
+  }
+};
+
+/**
+ * Replays a trace from memory through the `ImuSource` interface.
+ *
+ * Time either follows `micros()` since `begin()` (on device), or is
+ * advanced explicitly with `advance()` for deterministic host runs.
+ * Reads return the record that is current at the replay time; after the
+ * last record the final sample is held and `finished()` reports the end.
+ * When looping, the last record lasts as long as the interval before it,
+ * then the trace restarts; time past the wrap carries into the next pass.
+ */
+class ImuTraceReplay : public ImuSource {
+ private:
+  const ImuTraceRecord* m_records = nullptr;
+  uint32_t m_count = 0;
+  float m_accScale = 0.0f;
+  float m_gyroScale = 0.0f;
+
+  bool m_realtime = false;
+  bool m_loop = false;
+  uint32_t m_startUs = 0;
+  uint64_t m_nowUs = 0;     // replay clock
+  uint64_t m_recordUs = 0;  // start time of record m_index
+  uint32_t m_index = 0;
+  uint64_t m_wrapUs = 0;    // last record -> record 0 when looping
+  uint64_t m_periodUs = 0;  // one pass of the loop; 0 holds the sample
+
+  const ImuTraceRecord* current();
+  uint64_t intervalAfter(uint32_t index) const;
+
+ public:
+  /// @brief attaches a trace buffer (header + records)
+  /// @return `false` if the header is missing or incompatible
+  bool begin(const uint8_t* trace, size_t length, bool realtime = true);
+  void setLoop(bool loop) { m_loop = loop; }
+  /// @brief moves the replay clock forward (step mode)
+  void advance(uint32_t us) { m_nowUs += us; }
+  void rewind();
+
+  uint32_t recordCount() const { return m_count; }
+  bool finished();
+
+  bool readAccelerometer(float* ax, float* ay, float* az) override;
+  bool readGyroscope(float* gx, float* gy, float* gz) override;
+};
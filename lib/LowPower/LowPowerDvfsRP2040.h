@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "hardware/clocks.h"
+#include "hardware/structs/vreg_and_chip_reset.h"
+#include "hardware/vreg.h"
+
+namespace low_power {
+
+/// Governor tuning
+#define DVFS_UP_LOAD 0.90f     // predicted busy/frame above this: step up now
+#define DVFS_DOWN_LOAD 0.70f   // a lower point qualifies below this ...
+#define DVFS_DOWN_FRAMES 30    // ... for that many frames in a row
+#define DVFS_AVG_SHIFT 3       // workload average: weight 1/8 per frame
+#define DVFS_VREG_TIMEOUT_US 1000
+
+/// One operating point: system clock and the core voltage it needs
+struct OperatingPoint {
+  uint32_t khz;
+  vreg_voltage voltage;
+};
+
+/// Default RP2040 table, ascending; every frequency is reachable with the
+/// system PLL from the 12 MHz crystal.
+static const OperatingPoint rp2040_operating_points[] = {
+    {48000, VREG_VOLTAGE_0_90},  {96000, VREG_VOLTAGE_0_95},
+    {125000, VREG_VOLTAGE_1_00}, {150000, VREG_VOLTAGE_1_05},
+    {200000, VREG_VOLTAGE_1_10}, {240000, VREG_VOLTAGE_1_10},
+};
+
+/// Waits until the regulator reports the new voltage (VREG.ROK) instead of a
+/// fixed delay; gives up after DVFS_VREG_TIMEOUT_US
+inline void vreg_wait_regulated() {
+  uint32_t start = micros();
+  while (!(vreg_and_chip_reset_hw->vreg & VREG_AND_CHIP_RESET_VREG_ROK_BITS) &&
+         micros() - start < DVFS_VREG_TIMEOUT_US) {
+  }
+}
+
+/// Switches to `point`: the voltage goes up before the clock is raised and
+/// down only after it was lowered.
+/// @return `false` if the frequency cannot be generated (nothing changed)
+inline bool set_operating_point(const OperatingPoint& point) {
+  uint32_t current_khz = clock_get_hz(clk_sys) / 1000;
+  if (point.khz > current_khz) {
+    vreg_set_voltage(point.voltage);
+    vreg_wait_regulated();
+    return set_sys_clock_khz(point.khz, false);
+  }
+  if (!set_sys_clock_khz(point.khz, false))
+    return false;
+  vreg_set_voltage(point.voltage);
+  return true;
+}
+
+/**
+ * @brief Dynamic voltage and frequency scaling for a frame loop: picks the
+ * lowest operating point whose predicted busy time still meets the frame
+ * deadline.
+ *
+ * Call `update()` once per frame with the busy time (sim + render, without
+ * the idle wait). The busy time is turned into a cycle count at the current
+ * clock, which predicts the busy time at every other point. A frame that
+ * would exceed DVFS_UP_LOAD of the deadline moves up at once; moving down
+ * needs the averaged workload to fit DVFS_DOWN_LOAD of the deadline at the
+ * lower point for DVFS_DOWN_FRAMES frames.
+ *
+ * Changing the system clock also changes clk_peri: every peripheral divider
+ * derived from it (SPI, I2C, PWM) has to be set again in the clock change
+ * callback.
+ */
+class DvfsGovernorRP2040 {
+ public:
+  typedef void (*clock_change_cb_t)(uint32_t khz);
+
+  DvfsGovernorRP2040(const OperatingPoint* points = rp2040_operating_points,
+                     int count = sizeof(rp2040_operating_points) /
+                                 sizeof(rp2040_operating_points[0]))
+      : points(points), count(count) {}
+
+  /// Starts at the highest point
+  bool begin(uint32_t frame_us, clock_change_cb_t cb = nullptr) {
+    deadline_us = frame_us;
+    clock_change_cb = cb;
+    avg_cycles = 0;
+    down_frames = 0;
+    return apply(count - 1);
+  }
+
+  /// Feeds the busy time of the last frame
+  /// @return `true` if the operating point changed
+  bool update(uint32_t busy_us) {
+    uint64_t cycles = (uint64_t)busy_us * points[index].khz / 1000;
+    if (avg_cycles == 0)
+      avg_cycles = cycles;
+    else
+      avg_cycles += ((int64_t)cycles - (int64_t)avg_cycles) >> DVFS_AVG_SHIFT;
+
+    // step up: this frame would not fit at the current point
+    uint64_t peak = cycles > avg_cycles ? cycles : avg_cycles;
+    if (busyAt(peak, index) > deadline_us * DVFS_UP_LOAD) {
+      down_frames = 0;
+      int target = lowestFitting(peak, DVFS_UP_LOAD);
+      return target > index && apply(target);
+    }
+
+    // step down: the average fits a lower point with margin, for a while
+    int target = lowestFitting(avg_cycles, DVFS_DOWN_LOAD);
+    if (target >= index) {
+      down_frames = 0;
+      return false;
+    }
+    if (++down_frames < DVFS_DOWN_FRAMES)
+      return false;
+    down_frames = 0;
+    return apply(target);
+  }
+
+  /// Changes the frame deadline (e.g. a lower frame rate); the averaged
+  /// workload is kept and the next update picks the point for it
+  void setDeadline(uint32_t frame_us) {
+    deadline_us = frame_us;
+    down_frames = 0;
+  }
+  uint32_t getDeadline() const { return deadline_us; }
+
+  /// Forces a point (e.g. the top one before a burst of work)
+  bool setIndex(int idx) { return apply(idx); }
+
+  int getIndex() const { return index; }
+  uint32_t getKhz() const { return points[index].khz; }
+  /// Averaged workload in cycles per frame
+  uint32_t getCycles() const { return (uint32_t)avg_cycles; }
+
+ protected:
+  const OperatingPoint* points;
+  int count;
+  int index = 0;
+  uint32_t deadline_us = 33333;
+  uint64_t avg_cycles = 0;
+  int down_frames = 0;
+  clock_change_cb_t clock_change_cb = nullptr;
+
+  float busyAt(uint64_t cycles, int idx) const {
+    return (float)cycles * 1000.0f / points[idx].khz;
+  }
+
+  int lowestFitting(uint64_t cycles, float load) const {
+    for (int i = 0; i < count; i++)
+      if (busyAt(cycles, i) <= deadline_us * load)
+        return i;
+    return count - 1;
+  }
+
+  bool apply(int idx) {
+    if (idx < 0 || idx >= count || !set_operating_point(points[idx]))
+      return false;
+    index = idx;
+    if (clock_change_cb)
+      clock_change_cb(points[idx].khz);
+    return true;
+  }
+};
+
+}  // namespace low_power
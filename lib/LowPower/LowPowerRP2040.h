@@ -1,7 +1,10 @@
 #pragma once
 
 #include "LowPowerCommon.h"
+#include "LowPowerDvfsRP2040.h"
+#include "drivers/rp2040/pico_rtc_utils.h"
 #include "drivers/rp2040/pico_sleep.h"
+#include "hardware/sync.h"
 #include "hardware/vreg.h"
 #include "vector"
 
@@ -10,11 +13,23 @@ namespace low_power {
 class ArduinoLowPowerRP2040;
 static ArduinoLowPowerRP2040* selfArduinoLowPowerRP2040 = nullptr;
 
+/// Why the last deepSleep returned
+enum class wake_reason_t {
+  none,   // did not sleep: no or unsupported wake source
+  pin,    // wakeup pin edge
+  timer,  // sleep time elapsed (RTC alarm)
+};
+
 /**
  * @brief Low Power Management for RP2040: In lightSleep we just reduce the
- * processor system clock and voltage. In deepSleep we actually set the
- * processor as dormant, but we must choose between the wakeup by a pin or a
- * timer based wakeup. Only one single wakeup gpio pin is supported!
+ * processor system clock and voltage. deepSleep depends on the wake sources:
+ * - a pin only: dormant (all clocks stopped) until the pin edge
+ * - a sleep time: sleep with only the crystal and the RTC running, until
+ *   the RTC alarm (1 s resolution); a pin set as well can end it earlier
+ * Only one single wakeup gpio pin is supported! SRAM and peripheral
+ * registers are kept: without restart, sleep() returns after the wake
+ * event with the clocks restored to the operating point that was active
+ * before, and `getWakeReason()` tells which source fired.
  *
  * @author Phil Schatzmann
  * for details see
@@ -69,30 +84,8 @@ class ArduinoLowPowerRP2040 : public ArduinoLowPowerCommon {
         }
       } break;
 
-      case sleep_mode_enum_t::deepSleep: {
-        // use wakup pins
-        if (wakeup_pins.size() >= 0) {
-          if (wakeup_pins.size() > 1)
-            return false;
-          if (wakeup_pins[0].change_type == pin_change_t::on_high) {
-            sleep_goto_dormant_until_edge_high(wakeup_pins[0].pin);
-          } else {
-            sleep_goto_dormant_until_edge_low(wakeup_pins[0].pin);
-          }
-        } else if (sleep_time_us > 0) {
-          // use time to sleep
-          sleep_goto_sleep_for(sleep_time_us / 1000, timer_cb);
-          if (is_restart)
-            rp2040.reboot();
-
-        } else {
-          // no wakeup !
-          processor_deep_sleep();
-          if (is_restart)
-            rp2040.reboot();
-        }
-        return true;
-      }
+      case sleep_mode_enum_t::deepSleep:
+        return deep_sleep();
 
       case sleep_mode_enum_t::modemSleep:
         delay(sleep_time_us / 1000);
@@ -107,28 +100,41 @@ class ArduinoLowPowerRP2040 : public ArduinoLowPowerCommon {
     return false;
   }
 
+  /// @return `false` for 0: no sleep time, deepSleep then needs a pin
   bool setSleepTime(uint32_t time, time_unit_t time_unit_type) override {
-    sleep_time_us = (toUs(time, time_unit_type));
-    return sleep_mode == sleep_mode_enum_t::lightSleep ||
-           wakeup_pins.size() == 0;
+    // 64 bit: toUs() overflows after 71 minutes
+    sleep_time_us = time;
+    if (time_unit_type == time_unit_t::sec)
+      sleep_time_us *= 1000000;
+    else if (time_unit_type == time_unit_t::ms)
+      sleep_time_us *= 1000;
+    return sleep_time_us > 0;
   }
 
   bool addWakeupPin(int pin, pin_change_t change_type) override {
     PinChangeDef pin_change_def{pin, change_type};
     wakeup_pins.push_back(pin_change_def);
-    return sleep_mode == sleep_mode_enum_t::lightSleep || sleep_time_us == 0;
+    return sleep_mode == sleep_mode_enum_t::lightSleep ||
+           wakeup_pins.size() == 1;
   }
 
+  /// Source that ended the last deepSleep
+  wake_reason_t getWakeReason() const { return wake_reason; }
+
   void clear() {
     ArduinoLowPowerCommon::clear();
     sleep_time_us = 0;
     is_wait_for_pin = false;
     wakeup_pins.clear();
+    wake_reason = wake_reason_t::none;
   }
 
   /// We force a restart after we wake up from sleep
   void setRestart(bool flag) { is_restart = flag; }
 
+  /// micros() right after the last dormant wake event, for latency checks
+  uint32_t getWakeMicros() const { return wake_us; }
+
  protected:
   struct PinChangeDef {
     int pin;
@@ -143,8 +149,89 @@ class ArduinoLowPowerRP2040 : public ArduinoLowPowerCommon {
   bool is_wait_for_pin = false;
   bool is_restart = false;
   int timer_update_delay = 2;
+  OperatingPoint awake_point{240000, VREG_VOLTAGE_DEFAULT};
+  uint32_t wake_us = 0;
+  wake_reason_t wake_reason = wake_reason_t::none;
+  volatile bool woke_by_pin = false;
+  volatile bool woke_by_timer = false;
+
+  static void pin_wake_cb() { selfArduinoLowPowerRP2040->woke_by_pin = true; }
+  static void rtc_wake_cb() { selfArduinoLowPowerRP2040->woke_by_timer = true; }
 
-  static void timer_cb(unsigned int) {}
+  bool deep_sleep() {
+    wake_reason = wake_reason_t::none;
+    const bool use_pin = !wakeup_pins.empty();
+    const bool use_timer = sleep_time_us > 0;
+    // no wake source: we would never come back
+    if ((!use_pin && !use_timer) || wakeup_pins.size() > 1)
+      return false;
+
+    datetime_t alarm;
+    if (use_timer)
+      rtc_alarm_after(sleep_time_us, &alarm);
+
+    // both modes stop the PLLs: the system has to run from the crystal
+    save_awake_point();
+    Serial.flush();
+    sleep_run_from_xosc();
+
+    if (!use_timer) {
+      // dormant: every clock stops until the pin edge
+      const PinChangeDef& pin = wakeup_pins[0];
+      if (pin.change_type == pin_change_t::on_high) {
+        sleep_goto_dormant_until_edge_high(pin.pin);
+      } else {
+        sleep_goto_dormant_until_edge_low(pin.pin);
+      }
+      wake_reason = wake_reason_t::pin;
+    } else {
+      // sleep until the RTC alarm; an optional pin interrupt races it
+      woke_by_pin = woke_by_timer = false;
+      if (use_pin)
+        attachInterrupt(digitalPinToInterrupt(wakeup_pins[0].pin), pin_wake_cb,
+                        toMode(wakeup_pins[0].change_type));
+      sleep_goto_sleep_until_or_gpio(&alarm, rtc_wake_cb);
+      // any other interrupt ends WFI as well: go back to sleep
+      while (!woke_by_pin && !woke_by_timer)
+        __wfi();
+      if (use_pin)
+        detachInterrupt(digitalPinToInterrupt(wakeup_pins[0].pin));
+      rtc_disable_alarm();
+      wake_reason = woke_by_pin ? wake_reason_t::pin : wake_reason_t::timer;
+    }
+    wake_us = micros();
+
+    if (is_restart)
+      rp2040.reboot();
+    // SRAM is retained: bring the PLLs back and continue. sleep_power_up()
+    // restarts them at the SDK default clock, which a DVFS point below it
+    // (e.g. 48 MHz at 0.90 V) has too little voltage for: raise it first
+    if (awake_point.voltage < VREG_VOLTAGE_DEFAULT) {
+      vreg_set_voltage(VREG_VOLTAGE_DEFAULT);
+      vreg_wait_regulated();
+    }
+    sleep_power_up();
+    if (!set_operating_point(awake_point)) {
+      Serial.println("awake clock hz is not correct!");
+    }
+    return true;
+  }
+
+  /// RTC date/time `us` from now (rounded up to whole seconds); starts the
+  /// RTC at an arbitrary date if it is not running yet
+  void rtc_alarm_after(uint64_t us, datetime_t* alarm) {
+    if (!rtc_running()) {
+      datetime_t start = {2024, 1, 1, 1, 0, 0, 0};
+      rtc_init();
+      rtc_set_datetime(&start);
+      delayMicroseconds(64);  // the new time needs 2 clk_rtc cycles to load
+    }
+    datetime_t now;
+    rtc_get_datetime(&now);
+    time_t t = datetime_to_epoch(&now, nullptr);
+    t += (time_t)((us + 999999) / 1000000);
+    epoch_to_datetime(&t, alarm);
+  }
 
   static void interrupt_cb() {
     selfArduinoLowPowerRP2040->is_wait_for_pin = false;
@@ -169,27 +256,29 @@ class ArduinoLowPowerRP2040 : public ArduinoLowPowerCommon {
     light_sleep_end();
   }
 
+  // remember the point we run at: a DVFS governor may have lowered it
+  void save_awake_point() {
+    awake_point.khz = clock_get_hz(clk_sys) / 1000;
+    awake_point.voltage = (vreg_voltage)(
+        (vreg_and_chip_reset_hw->vreg & VREG_AND_CHIP_RESET_VREG_VSEL_BITS) >>
+        VREG_AND_CHIP_RESET_VREG_VSEL_LSB);
+  }
+
   void light_sleep_begin() {
-    delay(timer_update_delay);
-    if (!set_sys_clock_khz(18000, false)) {
+    save_awake_point();
+    Serial.flush();
+    // sys_clock_khz(10000, true); did not work for me
+    // 0.85V did not work, 0.95V seems pretty stable
+    if (!set_operating_point({18000, VREG_VOLTAGE_0_95})) {
       Serial.println("sleep clock hz is not correct!");
     }
-    // Set System clock to 10 MHz,
-    // sys_clock_khz(10000, true); did not work for me
-    delay(timer_update_delay);
-    vreg_set_voltage(VREG_VOLTAGE_0_95);  // 0.85V did not work, 0.95V
-    //                                       // seetime_unit_t::ms pretty stable
   }
   void light_sleep_end() {
     if (is_restart)
       rp2040.reboot();
-    vreg_set_voltage(
-        VREG_VOLTAGE_DEFAULT);  // corresponds to 1.10V, not sure if
-                                // that is really required for 48 MHz
-    if (!set_sys_clock_khz(240 * 1000, false)) {
+    if (!set_operating_point(awake_point)) {
       Serial.println("awake clock hz is not correct!");
-    }  // Set System clock to 10 MHz,
-    delay(timer_update_delay);
+    }
   }
 
   inline void sleep_goto_dormant_until_edge_high(uint gpio_pin) {
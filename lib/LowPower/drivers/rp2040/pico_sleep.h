@@ -65,6 +65,16 @@ static inline void sleep_run_from_rosc(void) {
   sleep_run_from_dormant_source(DORMANT_SOURCE_ROSC);
 }
 
+/*! \brief Restore the clocks after waking up from dormant or sleep mode
+ *  \ingroup hardware_sleep
+ *
+ * Restarts the oscillator that was disabled, clears the deep sleep bit and
+ * brings clk_sys, clk_peri, clk_usb and clk_adc back to the SDK defaults
+ * (PLLs running). Memory and peripheral registers are retained, so the
+ * caller only has to re-derive clock dependent dividers.
+ */
+void sleep_power_up(void);
+
 /*! \brief Send system to sleep until the specified time
  *  \ingroup hardware_sleep
  *
@@ -75,6 +85,17 @@ static inline void sleep_run_from_rosc(void) {
  */
 void sleep_goto_sleep_until(datetime_t *t, rtc_callback_t callback);
 
+/*! \brief Send system to sleep until the specified time or a GPIO interrupt
+ *  \ingroup hardware_sleep
+ *
+ * Like sleep_goto_sleep_until(), but the IO bank stays clocked so that a
+ * GPIO interrupt set up by the caller ends the sleep before the alarm.
+ *
+ * \param t The time to wake up
+ * \param callback Function to call on wakeup.
+ */
+void sleep_goto_sleep_until_or_gpio(datetime_t *t, rtc_callback_t callback);
+
 /*! \brief Send system to sleep until the specified GPIO changes
  *  \ingroup hardware_sleep
  *
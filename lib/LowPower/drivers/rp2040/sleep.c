@@ -20,6 +20,10 @@
 #include "hardware/sync.h"
 // For scb_hw so we can enable deep sleep
 #include "hardware/structs/scb.h"
+#include "pico/version.h"
+#if PICO_SDK_VERSION_MAJOR >= 2
+#include "pico/runtime_init.h"
+#endif
 
 // The difference between sleep and dormant is that ALL clocks are stopped in dormant mode,
 // until the source (either xosc or rosc) is started again by an external event.
@@ -118,6 +122,30 @@ void sleep_run_from_dormant_source(dormant_source_t dormant_source) {
 #endif
 }
 
+void sleep_power_up(void) {
+    // Restart the oscillator sleep_run_from_dormant_source() stopped; the
+    // dormant one is running again after the wake event
+    if (_dormant_source == DORMANT_SOURCE_XOSC) {
+        rosc_enable();
+    } else {
+        xosc_init();
+    }
+
+    // Clear deep sleep at the proc and enable all clocks in sleep mode again
+    scb_hw->scr &= ~M0PLUS_SCR_SLEEPDEEP_BITS;
+    clocks_hw->sleep_en0 = ~0u;
+    clocks_hw->sleep_en1 = ~0u;
+
+    // PLLs, clk_sys, clk_peri, clk_usb, clk_adc, clk_rtc back to the defaults
+    // (clocks_init() became runtime_init_clocks() in pico-sdk 2.0). The core
+    // voltage is not touched: the caller raises it for 125 MHz beforehand
+#if PICO_SDK_VERSION_MAJOR >= 2
+    runtime_init_clocks();
+#else
+    clocks_init();
+#endif
+}
+
 // Go to sleep until woken up by the RTC
 void sleep_goto_sleep_until(datetime_t *t, rtc_callback_t callback) {
     // We should have already called the sleep_run_from_dormant_source function
@@ -137,6 +165,26 @@ void sleep_goto_sleep_until(datetime_t *t, rtc_callback_t callback) {
     __wfi();
 }
 
+void sleep_goto_sleep_until_or_gpio(datetime_t *t, rtc_callback_t callback) {
+    // We should have already called the sleep_run_from_dormant_source function
+    assert(dormant_source_valid(_dormant_source));
+
+    // Turn off all clocks when in sleep mode except for RTC and the IO bank,
+    // whose edge detection raises the GPIO interrupt
+    clocks_hw->sleep_en0 = CLOCKS_SLEEP_EN0_CLK_RTC_RTC_BITS |
+                           CLOCKS_SLEEP_EN0_CLK_SYS_IO_BITS |
+                           CLOCKS_SLEEP_EN0_CLK_SYS_PADS_BITS;
+    clocks_hw->sleep_en1 = 0x0;
+
+    rtc_set_alarm(t, callback);
+
+    // Enable deep sleep at the proc
+    processor_deep_sleep();
+
+    // Go to sleep
+    __wfi();
+}
+
 bool sleep_goto_sleep_for(uint32_t delay_ms, hardware_alarm_callback_t callback)
 {
     // We should have already called the sleep_run_from_dormant_source function
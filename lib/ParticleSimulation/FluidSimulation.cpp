@@ -0,0 +1,208 @@
+#include "FluidSimulation.hpp"
+#include <string.h>
+
+// ──────────────────────────────────────── IMU
+void FluidSimulation::updateIMU() {
+  if (!m_imu)
+    return;  // 无 IMU：保留 setGravity() 设定的重力
+  // Q16 g 整数读数（已校准），一次常数乘缩放到归一化空间
+  constexpr float Q16_TO_SIM = 10.f * GRAVITY_MODIFIER / 65536.f;
+  int32_t ax, ay, az;
+  if (m_imu->readAccelerometerQ16(&ax, &ay, &az)) {
+    m_ax = ay * Q16_TO_SIM;
+    m_ay = -ax * Q16_TO_SIM;
+  }
+}
+
+// ──────────────────────────────────────── 逐格统计
+// ⌊√n⌋，逐位试商：M0+ 没有 FPU，比软浮点 hypotf 便宜得多
+static uint32_t isqrt32(uint32_t n) {
+  uint32_t root = 0, bit = 1u << 30;
+  while (bit > n)
+    bit >>= 2;
+  while (bit) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// 8 邻格中占有量 ≥ 半个粒子的格数：曲率的粗略代替，越少液面越外凸
+static int fluidNeighbors(const uint16_t* occ, int gx, int gy) {
+  constexpr int GS = CellStats::GS;
+  int n = 0;
+  for (int i = gx - 1; i <= gx + 1; ++i)
+    for (int j = gy - 1; j <= gy + 1; ++j)
+      if ((i != gx || j != gy) && i >= 0 && i < GS && j >= 0 && j < GS &&
+          occ[i * GS + j] >= 128)
+        ++n;
+  return n;
+}
+
+void FluidSimulation::updateCellStats() {
+  CellStats& st = m_stats;
+  memset(st.occ, 0, sizeof(st.occ));
+  memset(m_speedSum, 0, sizeof(m_speedSum));
+  memset(m_vxSum, 0, sizeof(m_vxSum));
+  memset(m_vySum, 0, sizeof(m_vySum));
+
+  // ① 粒子 → 格心（双线性，Q8）
+  uint32_t total = 0, vmax = 0;
+  const Particle* P = data();
+  for (int p = 0; p < m_numParticles; ++p) {
+    // 以格心为采样点：u = x·GS - 0.5；推开后越过最外格心的粒子钳到边格，
+    // 权重不丢，Σocc 守恒
+    float u = P[p].x * GS - 0.5f, v = P[p].y * GS - 0.5f;
+    u = u < 0.f ? 0.f : (u > GS - 1 ? GS - 1 : u);
+    v = v < 0.f ? 0.f : (v > GS - 1 ? GS - 1 : v);
+    int i0 = int(floorf(u)), j0 = int(floorf(v));
+    int fx = int((u - i0) * 256.f), fy = int((v - j0) * 256.f);
+    // 速度 Q8，钳到 ±127 使平方和不溢出 32 位；模长由定点开方得到
+    int32_t qvx = int32_t(P[p].vx * 256.f), qvy = int32_t(P[p].vy * 256.f);
+    qvx = qvx > 32767 ? 32767 : (qvx < -32767 ? -32767 : qvx);
+    qvy = qvy > 32767 ? 32767 : (qvy < -32767 ? -32767 : qvy);
+    uint32_t s = isqrt32(uint32_t(qvx * qvx) + uint32_t(qvy * qvy));
+    total += s;
+    vmax = s > vmax ? s : vmax;
+
+    const int wx[2] = {256 - fx, fx}, wy[2] = {256 - fy, fy};
+    for (int a = 0; a < 2; ++a)
+      for (int b = 0; b < 2; ++b) {
+        int gx = i0 + a, gy = j0 + b;
+        if (gx < 0 || gx >= GS || gy < 0 || gy >= GS)
+          continue;
+        uint32_t w = uint32_t(wx[a] * wy[b]) >> 8;  // Q8
+        int id = gx * GS + gy;
+        uint32_t o = st.occ[id] + w;
+        st.occ[id] = o > 0xFFFF ? 0xFFFF : o;
+        m_speedSum[id] += (w * s) >> 8;
+        m_vxSum[id] += int32_t(w) * qvx / 256;
+        m_vySum[id] += int32_t(w) * qvy / 256;
+      }
+  }
+
+  // ② 平均速度 / 泡沫候选 / 汇总
+  constexpr uint32_t FOAM_SPEED = uint32_t(SIM_FOAM_SPEED * 256);
+  constexpr uint32_t FOAM_OCC = uint32_t(SIM_FOAM_MAX_OCC * 256);
+  st.fluidCells = st.foamCells = 0;
+  for (int gx = 0; gx < GS; ++gx) {
+    uint16_t bits = 0;
+    for (int gy = 0; gy < GS; ++gy) {
+      const int id = gx * GS + gy;
+      const uint32_t o = st.occ[id];
+      uint32_t sp = o ? (m_speedSum[id] << 8) / o : 0;
+      st.speed[id] = sp > 0xFFFF ? 0xFFFF : sp;
+      int32_t mvx = o ? m_vxSum[id] * 256 / int32_t(o) : 0;
+      int32_t mvy = o ? m_vySum[id] * 256 / int32_t(o) : 0;
+      st.vx[id] = mvx > 32767 ? 32767 : (mvx < -32768 ? -32768 : mvx);
+      st.vy[id] = mvy > 32767 ? 32767 : (mvy < -32768 ? -32768 : mvy);
+
+      if (o >= 128)
+        ++st.fluidCells;
+      if (o && o <= FOAM_OCC && sp > FOAM_SPEED &&
+          fluidNeighbors(st.occ, gx, gy) <= SIM_FOAM_MAX_NEIGHBORS) {
+        bits |= 1u << gy;
+        ++st.foamCells;
+      }
+    }
+    st.foam[gx] = bits;
+  }
+
+  const uint32_t mean = m_numParticles ? total / m_numParticles : 0;
+  st.meanSpeed = mean > 0xFFFF ? 0xFFFF : mean;
+  st.maxSpeed = vmax > 0xFFFF ? 0xFFFF : vmax;
+}
+
+// ──────────────────────────────────────── 快照
+namespace {
+struct SnapshotHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t engine;
+  uint8_t reserved;
+  uint32_t count;    // 粒子数
+  uint32_t payload;  // 头部之后的字节数
+  uint32_t rng;      // PRNG 状态
+  float ax, ay;      // 当前重力
+  uint32_t checksum;  // 负载的 FNV-1a
+};
+
+constexpr size_t PARTICLE_BYTES = 4 * sizeof(float);
+
+uint32_t fnv1a(const uint8_t* p, size_t n) {
+  uint32_t h = 2166136261u;
+  while (n--)
+    h = (h ^ *p++) * 16777619u;
+  return h;
+}
+}  // namespace
+
+size_t FluidSimulation::snapshotSize() const {
+  return sizeof(SnapshotHeader) + m_numParticles * PARTICLE_BYTES +
+         stateSize();
+}
+
+size_t FluidSimulation::save(uint8_t* buf, size_t cap) const {
+  const size_t total = snapshotSize();
+  if (!buf || cap < total)
+    return 0;
+
+  uint8_t* out = buf + sizeof(SnapshotHeader);
+  const Particle* P = data();
+  for (int i = 0; i < m_numParticles; ++i) {
+    memcpy(out, &P[i].x, PARTICLE_BYTES);  // x, y, vx, vy 连续存放
+    out += PARTICLE_BYTES;
+  }
+  saveState(out);
+
+  SnapshotHeader h{};
+  h.magic = SIM_SNAPSHOT_MAGIC;
+  h.version = SIM_SNAPSHOT_VERSION;
+  h.engine = engineId();
+  h.count = m_numParticles;
+  h.payload = total - sizeof(SnapshotHeader);
+  h.rng = m_rng;
+  h.ax = m_ax;
+  h.ay = m_ay;
+  h.checksum = fnv1a(buf + sizeof(SnapshotHeader), h.payload);
+  memcpy(buf, &h, sizeof(h));
+  return total;
+}
+
+bool FluidSimulation::load(const uint8_t* buf, size_t len) {
+  SnapshotHeader h;
+  if (!buf || len < sizeof(h))
+    return false;
+  memcpy(&h, buf, sizeof(h));
+
+  if (h.magic != SIM_SNAPSHOT_MAGIC || h.version != SIM_SNAPSHOT_VERSION ||
+      h.engine != engineId() || h.count > uint32_t(PC_MAX))
+    return false;
+
+  const int prevCount = m_numParticles;
+  m_numParticles = h.count;  // stateSize() 可能依赖粒子数
+  const size_t expect = h.count * PARTICLE_BYTES + stateSize();
+  if (h.payload != expect || len < sizeof(h) + expect ||
+      fnv1a(buf + sizeof(h), expect) != h.checksum) {
+    m_numParticles = prevCount;
+    return false;
+  }
+
+  const uint8_t* in = buf + sizeof(h);
+  Particle* P = particles();
+  for (int i = 0; i < m_numParticles; ++i) {
+    memcpy(&P[i].x, in, PARTICLE_BYTES);
+    in += PARTICLE_BYTES;
+  }
+  loadState(in);
+
+  m_rng = h.rng;
+  m_ax = h.ax;
+  m_ay = h.ay;
+  return true;
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "imu_source.hpp"
+
+// ─── 公共宏与常量 ─────────────────────────────────
+#define LOGICAL_GRID_SIZE 16  // GS
+#define SCREEN_WIDTH 240
+#define SCREEN_HEIGHT 240
+#define PIXEL_PER_CELL (SCREEN_WIDTH / LOGICAL_GRID_SIZE)
+
+#define NUM_PARTICLES 100
+#ifndef MAX_PARTICLES
+#define MAX_PARTICLES NUM_PARTICLES  // 粒子容量（基准测试时可调大）
+#endif
+#define PARTICLE_RADIUS 0.5f / LOGICAL_GRID_SIZE  // 归一化单位；≈ 单元半径一半
+
+#define GRAVITY_MODIFIER 1
+
+#define REST_N 0.02f
+#define FRIC_T 0.05f
+
+// ─── 引擎选择（编译期） ───────────────────────────
+#define FLUID_ENGINE_FLIP 0  // ParticleSimulation：PIC/FLIP + 推开 + 压力求解
+#define FLUID_ENGINE_MPM 1   // MpmSimulation：MLS-MPM 弱可压缩
+#define FLUID_ENGINE_SPH 2   // SphSimulation：基于位置的 SPH，无网格（< 100 粒子）
+#ifndef FLUID_ENGINE
+#define FLUID_ENGINE FLUID_ENGINE_FLIP
+#endif
+
+// ─── 逐格统计 ─────────────────────────────────────
+#define SIM_FOAM_SPEED 2.0f    // 泡沫候选：格内平均速度高于此值
+#define SIM_FOAM_MAX_OCC 1.5f  // 且占有量（粒子数）不超过此值，即靠近液面
+#define SIM_FOAM_MAX_NEIGHBORS 3  // 且 8 邻格中液体格不超过此数：液面外凸
+                                  // （浪尖 / 水滴；平直液面约 5 个）
+
+// ─── 刚体（FLIP 双向耦合） ────────────────────────
+#define SIM_RIGID_MAX 4           // 刚体容量
+#define SIM_RIGID_DENSITY 0.6f    // 默认密度（相对流体）；< 1 浮在液面
+#define SIM_RIGID_DAMPING 0.5f    // 线/角速度阻尼（每秒）
+
+// ─── 快照 ─────────────────────────────────────────
+#define SIM_SNAPSHOT_MAGIC 0x4D495346u  // "FSIM"（小端）
+#define SIM_SNAPSHOT_VERSION 2  // 2：FLIP 私有状态加入刚体
+#define SIM_DEFAULT_SEED 0x2545F491u
+
+// ─── 结构 ─────────────────────────────────────────
+struct Particle {
+  float x, y;     // 位置  ∈ [0,1]
+  float vx, vy;   // 速度
+  float r, g, b;  // 调试颜色
+};
+
+// 刚体：胶囊 = 轴线段（质心 ± halfLen·轴向）向外扩 radius；halfLen = 0 即圆盘。
+// 质量以粒子为单位（一个粒子 ≈ 一个模拟格面积的流体）。
+struct RigidBody {
+  float x, y;          // 质心
+  float ux, uy;        // 轴向单位向量，由 angle 维护
+  float angle;         // 朝向（弧度）
+  float vx, vy;        // 线速度
+  float omega;         // 角速度
+  float radius, halfLen;
+  float invMass, invInertia;
+
+  // 点到轴线段的最近点
+  void closestOnAxis(float px, float py, float* qx, float* qy) const {
+    float t = (px - x) * ux + (py - y) * uy;
+    t = t < -halfLen ? -halfLen : (t > halfLen ? halfLen : t);
+    *qx = x + t * ux;
+    *qy = y + t * uy;
+  }
+  bool contains(float px, float py) const {
+    float qx, qy;
+    closestOnAxis(px, py, &qx, &qy);
+    const float dx = px - qx, dy = py - qy;
+    return dx * dx + dy * dy < radius * radius;
+  }
+  // 轴对齐包围盒的半宽 / 半高
+  float extentX() const { return fabsf(ux) * halfLen + radius; }
+  float extentY() const { return fabsf(uy) * halfLen + radius; }
+};
+
+// 逐格统计（定点），每帧 simulate() 末尾算一次，渲染与功耗逻辑共用。
+// 格子索引 gx*GS+gy；粒子按双线性权重分摊到相邻 4 个格心。
+struct CellStats {
+  static constexpr int GS = LOGICAL_GRID_SIZE;
+
+  uint16_t occ[GS * GS];    // 占有量：粒子数 Q8
+  uint16_t speed[GS * GS];  // 格内（按权重）平均速度 Q8
+  int16_t vx[GS * GS];      // 格内（按权重）平均速度向量 Q8
+  int16_t vy[GS * GS];
+  uint16_t foam[GS];        // 泡沫候选位图：foam[gx] 的第 gy 位
+
+  uint16_t meanSpeed;   // 全部粒子平均速度 Q8
+  uint16_t maxSpeed;    // 最大粒子速度 Q8
+  uint16_t fluidCells;  // 占有量 ≥ 半个粒子的格子数
+  uint16_t foamCells;   // 泡沫候选格数
+
+  bool isFoam(int gx, int gy) const { return foam[gx] >> gy & 1; }
+};
+
+// ─── 公共接口 ─────────────────────────────────────
+// 所有模拟引擎共享的接口：FluidRenderer 与 main.cpp 只依赖这里
+class FluidSimulation {
+ public:
+  virtual ~FluidSimulation() = default;
+
+  virtual void begin(ImuSource* imu) = 0;
+  virtual void simulate(float dt) = 0;
+  virtual const char* name() const = 0;
+  virtual uint8_t engineId() const = 0;  // FLUID_ENGINE_*
+
+  // 渲染层接口
+  virtual const Particle* data() const = 0;
+  int particleCount() const { return m_numParticles; }
+  // 逻辑网格 (GS×GS) 上的固体判定
+  virtual bool isSolid(int gx, int gy) const = 0;
+
+  // 本帧逐格统计
+  const CellStats& cellStats() const { return m_stats; }
+
+  // 刚体（目前只有 FLIP 支持，其余引擎为 0 个）
+  virtual int rigidCount() const { return 0; }
+  virtual const RigidBody* rigidBodies() const { return nullptr; }
+
+  // 粒子数：begin() 之前设置，超出容量则截断；
+  // 运行中只用来减少（只模拟前 n 个），调回时不要超过 begin() 时的数目，
+  // 末尾粒子从停下的位置继续
+  void setParticleCount(int n) {
+    m_numParticles = n < 0 ? 0 : (n > PC_MAX ? PC_MAX : n);
+  }
+  // 无 IMU 时使用的外部重力（归一化空间）
+  void setGravity(float ax, float ay) {
+    m_ax = ax;
+    m_ay = ay;
+  }
+  float gravityX() const { return m_ax; }
+  float gravityY() const { return m_ay; }
+  // 每秒一次的分阶段计时打印
+  void setStagePrint(bool enable) { m_stagePrint = enable; }
+  // 上一帧各阶段耗时（µs），阶段名与计时打印一致；功耗统计按阶段记账
+  virtual int stageCount() const = 0;
+  virtual const char* stageName(int i) const = 0;
+  uint32_t stageUs(int i) const { return m_stageUs[i]; }
+  // 播种用 PRNG（xorshift32）：begin() 之前设置；同种子 ⇒ 同一初始状态
+  void setSeed(uint32_t seed) {
+    m_rng = m_seed = seed ? seed : SIM_DEFAULT_SEED;
+  }
+  uint32_t seed() const { return m_seed; }
+
+  // 快照：版本化二进制（小端），头部 + 粒子 (x,y,vx,vy) + 引擎私有状态。
+  // 用于宿主机逐位重放，以及深睡前保存、唤醒后直接恢复液面。
+  size_t snapshotSize() const;
+  /// @return 写入字节数；缓冲区不足时为 0
+  size_t save(uint8_t* buf, size_t cap) const;
+  /// 必须在 begin() 之后调用；引擎/版本/校验不符时返回 false 且不改动状态
+  bool load(const uint8_t* buf, size_t len);
+
+  // 静态别名
+  static constexpr int GS = LOGICAL_GRID_SIZE;  // 网格边
+  static constexpr int GC = GS * GS;            // 单元数
+  static constexpr float CELL = 1.0f / GS;      // 单元物理尺寸
+  static constexpr int PC_MAX = MAX_PARTICLES;
+  static constexpr int STAGE_MAX = 8;  // stageCount() 上限
+  // 任一引擎快照大小的上界（头部 + 粒子 + 最大的私有状态）
+  static constexpr size_t SNAPSHOT_MAX = 64 + PC_MAX * 36 +
+                                         2 * GC * sizeof(float) + 4 +
+                                         SIM_RIGID_MAX * sizeof(RigidBody);
+
+ protected:
+  // 传感器
+  ImuSource* m_imu{nullptr};
+  float m_ax{0.f}, m_ay{0.f};
+
+  int m_numParticles{NUM_PARTICLES};
+  bool m_stagePrint{true};
+  uint32_t m_stageUs[STAGE_MAX]{};
+  uint32_t m_rng{SIM_DEFAULT_SEED};
+  uint32_t m_seed{SIM_DEFAULT_SEED};  // setSeed() 的值；m_rng 随播种前进
+
+  CellStats m_stats{};
+  // updateCellStats() 的逐格累加：Σ 权重·速度 / 速度向量（Q8）
+  uint32_t m_speedSum[GC];
+  int32_t m_vxSum[GC], m_vySum[GC];
+
+  void updateIMU();
+  void updateCellStats();
+
+  // [lo, hi) 均匀整数，替代 Arduino random()（全局状态、不可复现）
+  int32_t randomRange(int32_t lo, int32_t hi) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 17;
+    m_rng ^= m_rng << 5;
+    return lo + static_cast<int32_t>(m_rng % static_cast<uint32_t>(hi - lo));
+  }
+
+  // 快照钩子：粒子可写视图 + 引擎私有状态（网格速度、APIC 矩阵等）
+  virtual Particle* particles() = 0;
+  virtual size_t stateSize() const { return 0; }
+  virtual void saveState(uint8_t* out) const {}
+  virtual void loadState(const uint8_t* in) {}
+
+  // 圆容器（与 initGrid 相同半径）判定：归一化坐标
+  static inline bool outsideContainer(float x, float y) {
+    constexpr float rad = 0.5f - CELL;
+    float dx = x - 0.5f, dy = y - 0.5f;
+    return dx * dx + dy * dy > rad * rad;
+  }
+};
@@ -0,0 +1,235 @@
+#include "MpmSimulation.hpp"
+#include <math.h>
+#include <string.h>
+
+// ──────────────────────────────────────── 初始化
+void MpmSimulation::begin(ImuSource* imu) {
+  m_imu = imu;
+  setParticleCount(m_numParticles);
+  initGrid();
+  seedParticles();
+}
+
+void MpmSimulation::initGrid() {
+  // 壁面节点比粒子兜底半径再往内一格：速度在粒子被夹紧前就已被约束，
+  // 否则夹紧会悄悄吞掉体积（J 不变但液块越来越薄）
+  constexpr float rad = 0.5f - CELL - PARTICLE_RADIUS - DX;
+  for (int i = 0; i < NGC; ++i) {
+    float cx = (i / NG) * DX - 0.5f, cy = (i % NG) * DX - 0.5f;
+    m_nodeSolid[i] = cx * cx + cy * cy > rad * rad;
+  }
+}
+
+void MpmSimulation::seedParticles() {
+  // 居中方块规则排布：间距取「面积/粒子数」，限制在 [DX/2, DX]
+  // （每格 1~4 个粒子，少于此 MPM 会出现空洞，多于此只是浪费）
+  const int n = m_numParticles;
+  float sp = n ? sqrtf(MPM_SEED_AREA / n) : DX;
+  sp = sp < 0.5f * DX ? 0.5f * DX : (sp > DX ? DX : sp);
+  const int side = static_cast<int>(ceilf(sqrtf(float(n))));
+  const float x0 = 0.5f - 0.5f * side * sp;
+
+  for (int i = 0; i < n; ++i) {
+    Particle& p = m_particles[i];
+    p.x = x0 + (i % side + 0.5f) * sp + randomRange(-10, 10) / 100.0f * sp;
+    p.y = x0 + (i / side + 0.5f) * sp + randomRange(-10, 10) / 100.0f * sp;
+    p.vx = p.vy = 0.f;
+    p.r = 0.2f;
+    p.g = 0.4f;
+    p.b = 1.0f;
+    m_C[i][0] = m_C[i][1] = m_C[i][2] = m_C[i][3] = 0.f;
+    m_J[i] = 1.f;
+  }
+  m_pVol = sp * sp;
+  m_pMass = m_pVol * MPM_DENSITY;
+}
+
+// ──────────────────────────────────────── 主循环
+static const char* const STAGE_NAMES[] = {"IMU", "P2G", "Grid", "G2P",
+                                          "Stat"};
+
+int MpmSimulation::stageCount() const {
+  return sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]);
+}
+
+const char* MpmSimulation::stageName(int i) const {
+  return STAGE_NAMES[i];
+}
+
+void MpmSimulation::simulate(float dt) {
+  /* ───── 计时用变量 ─────────────────── */
+  static uint32_t accIMU = 0;
+  static uint32_t accP2G = 0;
+  static uint32_t accGrid = 0;
+  static uint32_t accG2P = 0;
+  static uint32_t accStat = 0;
+  static uint32_t substeps = 0;
+  static uint32_t frames = 0;
+  static uint32_t tLastPrint = millis();
+
+  /* ───── 阶段 1：IMU ─────────────────── */
+  uint32_t t0 = micros();
+  updateIMU();
+  m_stageUs[0] = micros() - t0;
+  accIMU += m_stageUs[0];
+
+  /* ───── 子步：P2G → 网格 → G2P ──────── */
+  int n = static_cast<int>(ceilf(dt / MPM_MAX_SUBSTEP));
+  n = n < 1 ? 1 : (n > MPM_MAX_SUBSTEPS ? MPM_MAX_SUBSTEPS : n);
+  const float sdt = dt / n;
+  m_stageUs[1] = m_stageUs[2] = m_stageUs[3] = 0;  // 本帧各子步之和
+  for (int s = 0; s < n; ++s) {
+    uint32_t t1 = micros();
+    particleToGrid(sdt);
+    uint32_t t2 = micros();
+    updateGrid(sdt);
+    uint32_t t3 = micros();
+    gridToParticle(sdt);
+    uint32_t t4 = micros();
+    m_stageUs[1] += t2 - t1;
+    m_stageUs[2] += t3 - t2;
+    m_stageUs[3] += t4 - t3;
+  }
+  accP2G += m_stageUs[1];
+  accGrid += m_stageUs[2];
+  accG2P += m_stageUs[3];
+  substeps += n;
+  ++frames;
+
+  /* ───── 逐格统计 ─────────────────────── */
+  uint32_t t5 = micros();
+  updateCellStats();
+  m_stageUs[4] = micros() - t5;
+  accStat += m_stageUs[4];
+
+  /* ───── 每秒打印一次 ─────────────────── */
+  if (millis() - tLastPrint >= 1000) {
+    if (m_stagePrint)
+      Serial.printf(
+          "[%3u fps]  IMU:%4lu  P2G:%4lu  Grid:%4lu  G2P:%4lu  Stat:%4lu  "
+          "Sub:%2lu (µs per frame)\r\n",
+          frames, accIMU / frames, accP2G / frames, accGrid / frames,
+          accG2P / frames, accStat / frames, substeps / frames);
+    accIMU = accP2G = accGrid = accG2P = accStat = substeps = 0;
+    frames = 0;
+    tLastPrint = millis();
+  }
+}
+
+// ──────────────────────────────────────── P2G
+void MpmSimulation::particleToGrid(float dt) {
+  memset(m_grid, 0, sizeof(m_grid));
+
+  // 弱可压缩状态方程：p = E (1 - J)，合并进 APIC 仿射项
+  const float k = -dt * 4.f * MPM_STIFFNESS * m_pVol * INV_DX * INV_DX;
+
+  for (int p = 0; p < m_numParticles; ++p) {
+    const Particle& pr = m_particles[p];
+    int bx, by;
+    float fx, fy, wx[3], wy[3];
+    bsplineWeights(pr.x, bx, fx, wx);
+    bsplineWeights(pr.y, by, fy, wy);
+
+    const float stress = k * (m_J[p] - 1.f);
+    const float a00 = stress + m_pMass * m_C[p][0];
+    const float a01 = m_pMass * m_C[p][1];
+    const float a10 = m_pMass * m_C[p][2];
+    const float a11 = stress + m_pMass * m_C[p][3];
+    const float mvx = m_pMass * pr.vx, mvy = m_pMass * pr.vy;
+
+    for (int i = 0; i < 3; ++i) {
+      const float dpx = (i - fx) * DX;
+      for (int j = 0; j < 3; ++j) {
+        const float dpy = (j - fy) * DX;
+        const float w = wx[i] * wy[j];
+        Node& nd = m_grid[(bx + i) * NG + (by + j)];
+        nd.vx += w * (mvx + a00 * dpx + a01 * dpy);
+        nd.vy += w * (mvy + a10 * dpx + a11 * dpy);
+        nd.m += w * m_pMass;
+      }
+    }
+  }
+}
+
+// ──────────────────────────────────────── 网格更新
+void MpmSimulation::updateGrid(float dt) {
+  for (int i = 0; i < NGC; ++i) {
+    Node& nd = m_grid[i];
+    if (nd.m <= 0.f)
+      continue;
+    const float inv = 1.f / nd.m;
+    nd.vx = nd.vx * inv + m_ax * dt;
+    nd.vy = nd.vy * inv + m_ay * dt;
+
+    if (!m_nodeSolid[i])
+      continue;
+    // 圆壁：去掉指向壁外的法向分量（自由滑移）
+    const float cx = (i / NG) * DX - 0.5f, cy = (i % NG) * DX - 0.5f;
+    const float d = sqrtf(cx * cx + cy * cy);
+    if (d <= 0.f)
+      continue;
+    const float nx = cx / d, ny = cy / d;
+    const float vn = nd.vx * nx + nd.vy * ny;
+    if (vn > 0.f) {
+      nd.vx -= vn * nx;
+      nd.vy -= vn * ny;
+    }
+  }
+}
+
+// ──────────────────────────────────────── G2P
+void MpmSimulation::gridToParticle(float dt) {
+  constexpr float CX = 0.5f, CY = 0.5f, R = 0.5f - CELL - PARTICLE_RADIUS;
+  const float c4 = 4.f * INV_DX * INV_DX;
+
+  for (int p = 0; p < m_numParticles; ++p) {
+    Particle& pr = m_particles[p];
+    int bx, by;
+    float fx, fy, wx[3], wy[3];
+    bsplineWeights(pr.x, bx, fx, wx);
+    bsplineWeights(pr.y, by, fy, wy);
+
+    float vx = 0.f, vy = 0.f, c00 = 0.f, c01 = 0.f, c10 = 0.f, c11 = 0.f;
+    for (int i = 0; i < 3; ++i) {
+      const float dpx = (i - fx) * DX;
+      for (int j = 0; j < 3; ++j) {
+        const float dpy = (j - fy) * DX;
+        const float w = wx[i] * wy[j];
+        const Node& nd = m_grid[(bx + i) * NG + (by + j)];
+        vx += w * nd.vx;
+        vy += w * nd.vy;
+        c00 += w * nd.vx * dpx;
+        c01 += w * nd.vx * dpy;
+        c10 += w * nd.vy * dpx;
+        c11 += w * nd.vy * dpy;
+      }
+    }
+    pr.vx = vx;
+    pr.vy = vy;
+    m_C[p][0] = c00 * c4;
+    m_C[p][1] = c01 * c4;
+    m_C[p][2] = c10 * c4;
+    m_C[p][3] = c11 * c4;
+    m_J[p] *= 1.f + dt * (m_C[p][0] + m_C[p][3]);
+    m_J[p] = m_J[p] < 0.5f ? 0.5f : (m_J[p] > 1.5f ? 1.5f : m_J[p]);
+
+    pr.x += dt * vx;
+    pr.y += dt * vy;
+
+    // 圆容器兜底：网格边界已处理速度，这里只防止穿透
+    float dx = pr.x - CX, dy = pr.y - CY;
+    float d2 = dx * dx + dy * dy;
+    if (d2 > R * R) {
+      float d = sqrtf(d2);
+      float s = R / d;
+      pr.x = CX + dx * s;
+      pr.y = CY + dy * s;
+      float nx = dx / d, ny = dy / d;
+      float vn = pr.vx * nx + pr.vy * ny;
+      if (vn > 0.f) {
+        pr.vx -= (1.f + REST_N) * vn * nx;
+        pr.vy -= (1.f + REST_N) * vn * ny;
+      }
+    }
+  }
+}
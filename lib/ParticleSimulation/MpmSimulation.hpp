@@ -0,0 +1,91 @@
+#pragma once
+#include <string.h>
+#include "FluidSimulation.hpp"
+
+// ─── 宏与常量 ─────────────────────────────────────
+#define MPM_GRID_SIZE 32       // MPM 背景网格边长（与逻辑网格独立）
+#define MPM_STIFFNESS 60.0f    // 体积模量 E：越大越不可压，子步越多
+#define MPM_MAX_SUBSTEP 0.003f // 单个子步最大时长 (s)，CFL 约束
+#define MPM_MAX_SUBSTEPS 16    // 每帧子步上限，防止掉帧后雪崩
+#define MPM_SEED_AREA 0.30f    // 初始液块面积（归一化）
+#define MPM_DENSITY 1.0f       // 静止密度
+
+// ─── 主类 ─────────────────────────────────────────
+// MLS-MPM (Hu et al. 2018, "mpm88" 形式) 弱可压缩流体：
+// 每个子步只有一次 P2G → 网格更新 → G2P，压力由粒子体积比 J 给出，
+// 不需要单独的推开与压力迭代。
+class MpmSimulation : public FluidSimulation {
+ public:
+  void begin(ImuSource* imu) override;
+  void simulate(float dt) override;
+  const char* name() const override { return "MLS-MPM"; }
+  uint8_t engineId() const override { return FLUID_ENGINE_MPM; }
+  int stageCount() const override;
+  const char* stageName(int i) const override;
+
+  // 渲染层接口
+  const Particle* data() const override { return m_particles; }
+  bool isSolid(int gx, int gy) const override {
+    return outsideContainer((gx + 0.5f) * CELL, (gy + 0.5f) * CELL);
+  }
+
+  static constexpr int NG = MPM_GRID_SIZE;
+  static constexpr int NGC = NG * NG;
+  static constexpr float DX = 1.0f / NG;
+  static constexpr float INV_DX = float(NG);
+
+ private:
+  struct Node {
+    float vx, vy;  // 动量 → 速度
+    float m;       // 质量
+  };
+
+  // ── 网格字段 ───────────────────────────────
+  Node m_grid[NGC]{};
+  bool m_nodeSolid[NGC]{};
+
+  // ── 粒子字段 ───────────────────────────────
+  Particle m_particles[PC_MAX];
+  float m_C[PC_MAX][4]{};  // APIC 仿射矩阵 (c00 c01 c10 c11)
+  float m_J[PC_MAX]{};     // 体积比 det(F)
+  float m_pVol{0.f}, m_pMass{0.f};
+
+  // ── 快照：APIC 矩阵 + 体积比 + 粒子体积（网格每子步重建） ──
+  Particle* particles() override { return m_particles; }
+  size_t stateSize() const override {
+    return m_numParticles * (sizeof(m_C[0]) + sizeof(m_J[0])) +
+           sizeof(m_pVol);
+  }
+  void saveState(uint8_t* out) const override {
+    memcpy(out, m_C, m_numParticles * sizeof(m_C[0]));
+    out += m_numParticles * sizeof(m_C[0]);
+    memcpy(out, m_J, m_numParticles * sizeof(m_J[0]));
+    out += m_numParticles * sizeof(m_J[0]);
+    memcpy(out, &m_pVol, sizeof(m_pVol));
+  }
+  void loadState(const uint8_t* in) override {
+    memcpy(m_C, in, m_numParticles * sizeof(m_C[0]));
+    in += m_numParticles * sizeof(m_C[0]);
+    memcpy(m_J, in, m_numParticles * sizeof(m_J[0]));
+    in += m_numParticles * sizeof(m_J[0]);
+    memcpy(&m_pVol, in, sizeof(m_pVol));
+    m_pMass = m_pVol * MPM_DENSITY;
+  }
+
+  // ── 内部算法 ───────────────────────────────
+  void seedParticles();
+  void initGrid();
+  void particleToGrid(float dt);
+  void updateGrid(float dt);
+  void gridToParticle(float dt);
+
+  // 二次 B 样条权重：base 为 3×3 模板左下角
+  static inline void bsplineWeights(float x, int& base, float& fx, float w[3]) {
+    base = static_cast<int>(x * INV_DX - 0.5f);
+    fx = x * INV_DX - base;
+    float a = 1.5f - fx, b = fx - 1.0f, c = fx - 0.5f;
+    w[0] = 0.5f * a * a;
+    w[1] = 0.75f - b * b;
+    w[2] = 0.5f * c * c;
+  }
+};
@@ -5,9 +5,9 @@
 // ──────────────────────────────────────── 工具
 
 // ──────────────────────────────────────── 初始化
-void ParticleSimulation::begin(QMI8658C* imu) {
+void ParticleSimulation::begin(ImuSource* imu) {
   m_imu = imu;
-  m_numParticles = PC_MAX;
+  setParticleCount(m_numParticles);
   seedParticles();
   initGrid();
 }
@@ -15,28 +15,46 @@ void ParticleSimulation::begin(QMI8658C* imu) {
 void ParticleSimulation::seedParticles() {
   for (int i = 0; i < m_numParticles; ++i) {
     // 0.2 ~ 0.8 区域内随机
-    m_particles[i].x = random(20, 80) / 100.0f;
-    m_particles[i].y = random(20, 80) / 100.0f;
-    m_particles[i].vx = random(-50, 50) / 100.0f * CELL;  // 速度尺度≈单元
-    m_particles[i].vy = random(-50, 50) / 100.0f * CELL;
+    m_particles[i].x = randomRange(20, 80) / 100.0f;
+    m_particles[i].y = randomRange(20, 80) / 100.0f;
+    m_particles[i].vx = randomRange(-50, 50) / 100.0f * CELL;  // 速度尺度≈单元
+    m_particles[i].vy = randomRange(-50, 50) / 100.0f * CELL;
     m_particles[i].r = 0.2f;
     m_particles[i].g = 0.4f;
     m_particles[i].b = 1.0f;
   }
 }
 
+bool ParticleSimulation::wallCell(int gx, int gy) const {
+  float cx = (gx + 0.5f) * CELL - 0.5f,
+        cy = (gy + 0.5f) * CELL - 0.5f;  // 以(0,0)~(1,1)中心
+  float rad = 0.5f - CELL;               // 圆容器半径
+  return cx * cx + cy * cy > rad * rad;
+}
+
 void ParticleSimulation::initGrid() {
   for (int i = 0; i < GC; ++i) {
-    int gx = i / GS, gy = i % GS;
-    float cx = (gx + 0.5f) * CELL - 0.5f,
-          cy = (gy + 0.5f) * CELL - 0.5f;  // 以(0,0)~(1,1)中心
-    float rad = 0.5f - CELL;               // 圆容器半径
-    m_cellType[i] = (cx * cx + cy * cy <= rad * rad) ? FLUID_CELL : SOLID_CELL;
+    m_cellType[i] = wallCell(i / GS, i % GS) ? SOLID_CELL : FLUID_CELL;
     m_s[i] = 1.0f;
   }
+  // 刚体格全部作废，下次 markBodyCells() 按当前位置重新标记
+  for (int k = 0; k < SIM_RIGID_MAX; ++k)
+    m_bodyBox[k] = {1, 1, 0, 0};
+  m_changedCnt = 0;
 }
 
 // ──────────────────────────────────────── 主循环
+static const char* const STAGE_NAMES[] = {"IMU", "Intg", "Push", "ToG",
+                                          "Solve", "ToP", "Stat"};
+
+int ParticleSimulation::stageCount() const {
+  return sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]);
+}
+
+const char* ParticleSimulation::stageName(int i) const {
+  return STAGE_NAMES[i];
+}
+
 void ParticleSimulation::simulate(float dt) {
   /* ───── 计时用变量 ─────────────────── */
   static uint32_t accIMU = 0;
@@ -55,7 +73,9 @@ void ParticleSimulation::simulate(float dt) {
   uint32_t t1 = micros();
 
   /* ───── 阶段 2：积分 & 碰撞 ──────────── */
+  integrateBodies(dt);
   integrateParticles(dt);
+  markBodyCells();
   uint32_t t2 = micros();
 
   /* ───── 阶段 3：粒子推开  ─────────────── */
@@ -75,27 +95,36 @@ void ParticleSimulation::simulate(float dt) {
   transferVelocities(false, FLIP_RATIO);
   uint32_t t6 = micros();
 
-  /* ───── 阶段 7：统计/卷积 ─────────────── */
-  updateFluidCells();
+  /* ───── 阶段 7：逐格统计 ──────────────── */
+  updateCellStats();
   uint32_t t7 = micros();
 
   /* ───── 累加 ─────────────────────────── */
-  accIMU += t1 - t0;
-  accIntg += t2 - t1;
-  accPush += t3 - t2;
-  accTvG += t4 - t3;
-  accSolve += t5 - t4;
-  accTvP += t6 - t5;
-  accStat += t7 - t6;
+  m_stageUs[0] = t1 - t0;
+  m_stageUs[1] = t2 - t1;
+  m_stageUs[2] = t3 - t2;
+  m_stageUs[3] = t4 - t3;
+  m_stageUs[4] = t5 - t4;
+  m_stageUs[5] = t6 - t5;
+  m_stageUs[6] = t7 - t6;
+  accIMU += m_stageUs[0];
+  accIntg += m_stageUs[1];
+  accPush += m_stageUs[2];
+  accTvG += m_stageUs[3];
+  accSolve += m_stageUs[4];
+  accTvP += m_stageUs[5];
+  accStat += m_stageUs[6];
   ++frames;
 
   /* ───── 每秒打印一次 ─────────────────── */
   if (millis() - tLastPrint >= 1000) {
-    Serial.printf(
-        "[%3u fps]  IMU:%4lu  Intg:%4lu  Push:%4lu  ToG:%4lu  Solve:%4lu  "
-        "ToP:%4lu  Stat:%4lu (µs per frame)\r\n",
-        frames, accIMU / frames, accIntg / frames, accPush / frames,
-        accTvG / frames, accSolve / frames, accTvP / frames, accStat / frames);
+    if (m_stagePrint)
+      Serial.printf(
+          "[%3u fps]  IMU:%4lu  Intg:%4lu  Push:%4lu  ToG:%4lu  Solve:%4lu  "
+          "ToP:%4lu  Stat:%4lu (µs per frame)\r\n",
+          frames, accIMU / frames, accIntg / frames, accPush / frames,
+          accTvG / frames, accSolve / frames, accTvP / frames,
+          accStat / frames);
     /* 清零 */
     accIMU = accIntg = accPush = accTvG = accSolve = accTvP = accStat = 0;
     frames = 0;
@@ -103,17 +132,6 @@ void ParticleSimulation::simulate(float dt) {
   }
 }
 
-// ──────────────────────────────────────── IMU
-void ParticleSimulation::updateIMU() {
-  if (!m_imu)
-    return;
-  float ax, ay, az;
-  if (m_imu->readAccelerometer(&ax, &ay, &az)) {
-    m_ax = ay * 10.f * GRAVITY_MODIFIER;  // 缩放到归一化空间
-    m_ay = -ax * 10.f * GRAVITY_MODIFIER;
-  }
-}
-
 // ──────────────────────────────────────── 积分+碰撞
 void ParticleSimulation::integrateParticles(float dt) {
   constexpr float CX = 0.5f, CY = 0.5f, R = 0.5f - CELL - PARTICLE_RADIUS;
@@ -157,59 +175,315 @@ void ParticleSimulation::integrateParticles(float dt) {
       p.vx = vx_n + vx_t;
       p.vy = vy_n + vy_t;
     }
+
+    // 刚体碰撞（双向）
+    for (int k = 0; k < m_numBodies; ++k)
+      collideParticleBody(p, m_bodies[k]);
+  }
+}
+
+// ──────────────────────────────────────── 刚体
+int ParticleSimulation::addRigidBody(float x,
+                                     float y,
+                                     float radius,
+                                     float halfLen,
+                                     float angle,
+                                     float density) {
+  if (m_numBodies >= SIM_RIGID_MAX || radius <= 0.f)
+    return -1;
+
+  RigidBody& b = m_bodies[m_numBodies];
+  b = {};
+  b.x = x;
+  b.y = y;
+  b.angle = angle;
+  b.ux = cosf(angle);
+  b.uy = sinf(angle);
+  b.radius = radius;
+  b.halfLen = halfLen < 0.f ? 0.f : halfLen;
+
+  // 质量 = 密度 × 面积 / 单格面积；转动惯量取圆盘 + 细杆的近似。
+  // density ≤ 0 ⇒ 固定不动（逆质量为 0）
+  if (density > 0.f) {
+    const float area = float(M_PI) * radius * radius + 4 * b.halfLen * radius;
+    const float mass = density * area / (CELL * CELL);
+    b.invMass = 1.f / mass;
+    b.invInertia =
+        1.f / (mass * (0.5f * radius * radius + b.halfLen * b.halfLen / 3.f));
+  }
+
+  m_bodyBox[m_numBodies] = {1, 1, 0, 0};
+  ++m_numBodies;
+  markBodyCells();
+  return m_numBodies - 1;
+}
+
+void ParticleSimulation::clearRigidBodies() {
+  m_numBodies = 0;
+  initGrid();
+}
+
+void ParticleSimulation::integrateBodies(float dt) {
+  constexpr float CX = 0.5f, CY = 0.5f;
+  float damp = 1.f - SIM_RIGID_DAMPING * dt;
+  damp = damp < 0.f ? 0.f : damp;
+
+  for (int k = 0; k < m_numBodies; ++k) {
+    RigidBody& b = m_bodies[k];
+    if (b.invMass == 0.f)
+      continue;  // 固定刚体
+
+    b.vx = (b.vx + m_ax * dt) * damp;
+    b.vy = (b.vy + m_ay * dt) * damp;
+    b.omega *= damp;
+    b.x += b.vx * dt;
+    b.y += b.vy * dt;
+    b.angle += b.omega * dt;
+    b.ux = cosf(b.angle);
+    b.uy = sinf(b.angle);
+
+    // 圆容器：两个端点分别推回圆内，法向冲量作用在端点上
+    const float R = 0.5f - CELL - b.radius;
+    for (int e = -1; e <= 1; e += 2) {
+      const float rx = e * b.halfLen * b.ux, ry = e * b.halfLen * b.uy;
+      const float dx = b.x + rx - CX, dy = b.y + ry - CY;
+      const float d2 = dx * dx + dy * dy;
+      if (d2 <= R * R)
+        continue;
+      const float d = sqrtf(d2);
+      const float nx = dx / d, ny = dy / d;
+      b.x -= nx * (d - R);
+      b.y -= ny * (d - R);
+
+      const float vn = (b.vx - b.omega * ry) * nx + (b.vy + b.omega * rx) * ny;
+      if (vn <= 0.f)
+        continue;
+      const float rn = rx * ny - ry * nx;
+      const float j = (1.f + REST_N) * vn / (b.invMass + rn * rn * b.invInertia);
+      b.vx -= j * nx * b.invMass;
+      b.vy -= j * ny * b.invMass;
+      b.omega -= j * rn * b.invInertia;
+    }
+  }
+
+  for (int i = 0; i < m_numBodies; ++i)
+    for (int j = i + 1; j < m_numBodies; ++j)
+      collideBodyPair(m_bodies[i], m_bodies[j]);
+}
+
+void ParticleSimulation::collideBodyPair(RigidBody& a, RigidBody& b) {
+  const float w = a.invMass + b.invMass;
+  if (w == 0.f)
+    return;
+
+  // 两轴线段的最近点对：不相交时必有一点是某条线段的端点
+  float pax = a.x, pay = a.y, pbx = b.x, pby = b.y, best = 1e9f;
+  auto probe = [&](const RigidBody& s, const RigidBody& o, bool sIsA) {
+    for (int e = -1; e <= 1; e += 2) {
+      const float ex = s.x + e * s.halfLen * s.ux;
+      const float ey = s.y + e * s.halfLen * s.uy;
+      float qx, qy;
+      o.closestOnAxis(ex, ey, &qx, &qy);
+      const float d2 = (ex - qx) * (ex - qx) + (ey - qy) * (ey - qy);
+      if (d2 >= best)
+        continue;
+      best = d2;
+      pax = sIsA ? ex : qx;
+      pay = sIsA ? ey : qy;
+      pbx = sIsA ? qx : ex;
+      pby = sIsA ? qy : ey;
+    }
+  };
+  probe(a, b, true);
+  probe(b, a, false);
+
+  const float rsum = a.radius + b.radius;
+  if (best >= rsum * rsum)
+    return;
+
+  const float d = sqrtf(best);
+  float nx = 1.f, ny = 0.f;  // a → b
+  if (d > 1e-6f) {
+    nx = (pbx - pax) / d;
+    ny = (pby - pay) / d;
+  }
+
+  // 位置：按逆质量分摊穿透
+  const float pen = (rsum - d) / w;
+  a.x -= nx * pen * a.invMass;
+  a.y -= ny * pen * a.invMass;
+  b.x += nx * pen * b.invMass;
+  b.y += ny * pen * b.invMass;
+
+  // 速度：接触点取两表面的中点
+  const float cx = 0.5f * (pax + nx * a.radius + pbx - nx * b.radius);
+  const float cy = 0.5f * (pay + ny * a.radius + pby - ny * b.radius);
+  const float rax = cx - a.x, ray = cy - a.y, rbx = cx - b.x, rby = cy - b.y;
+  const float vn = (b.vx - b.omega * rby - a.vx + a.omega * ray) * nx +
+                   (b.vy + b.omega * rbx - a.vy - a.omega * rax) * ny;
+  if (vn >= 0.f)
+    return;
+  const float rna = rax * ny - ray * nx, rnb = rbx * ny - rby * nx;
+  const float j = -(1.f + REST_N) * vn /
+                  (w + rna * rna * a.invInertia + rnb * rnb * b.invInertia);
+  a.vx -= j * nx * a.invMass;
+  a.vy -= j * ny * a.invMass;
+  a.omega -= j * rna * a.invInertia;
+  b.vx += j * nx * b.invMass;
+  b.vy += j * ny * b.invMass;
+  b.omega += j * rnb * b.invInertia;
+}
+
+// 粒子 ↔ 刚体：粒子质量为 1，穿透与冲量按逆质量分摊，刚体因此被流体推动
+void ParticleSimulation::collideParticleBody(Particle& p, RigidBody& b) {
+  float qx, qy;
+  b.closestOnAxis(p.x, p.y, &qx, &qy);
+  const float dx = p.x - qx, dy = p.y - qy;
+  const float rmin = b.radius + PARTICLE_RADIUS;
+  const float d2 = dx * dx + dy * dy;
+  if (d2 >= rmin * rmin)
+    return;
+
+  const float d = sqrtf(d2);
+  float nx = -b.uy, ny = b.ux;  // 恰在轴线上：沿轴的法向推出
+  if (d > 1e-6f) {
+    nx = dx / d;
+    ny = dy / d;
+  }
+
+  // 位置
+  const float pen = (rmin - d) / (1.f + b.invMass);
+  p.x += nx * pen;
+  p.y += ny * pen;
+  b.x -= nx * pen * b.invMass;
+  b.y -= ny * pen * b.invMass;
+
+  // 速度：法向冲量（弹性 REST_N）+ 切向摩擦（FRIC_T），接触点在刚体表面
+  const float rx = qx + nx * b.radius - b.x, ry = qy + ny * b.radius - b.y;
+  const float rvx = p.vx - (b.vx - b.omega * ry);
+  const float rvy = p.vy - (b.vy + b.omega * rx);
+  const float vn = rvx * nx + rvy * ny;
+  if (vn >= 0.f)
+    return;
+
+  const float rn = rx * ny - ry * nx;
+  const float j =
+      -(1.f + REST_N) * vn / (1.f + b.invMass + rn * rn * b.invInertia);
+  p.vx += j * nx;
+  p.vy += j * ny;
+  b.vx -= j * nx * b.invMass;
+  b.vy -= j * ny * b.invMass;
+  b.omega -= j * rn * b.invInertia;
+
+  const float tx = -ny, ty = nx;
+  const float vt = rvx * tx + rvy * ty;
+  const float rt = rx * ty - ry * tx;
+  const float jt =
+      -FRIC_T * vt / (1.f + b.invMass + rt * rt * b.invInertia);
+  p.vx += jt * tx;
+  p.vy += jt * ty;
+  b.vx -= jt * tx * b.invMass;
+  b.vy -= jt * ty * b.invMass;
+  b.omega -= jt * rt * b.invInertia;
+}
+
+ParticleSimulation::CellBox ParticleSimulation::bodyCells(
+    const RigidBody& b) const {
+  auto cell = [](float v) {
+    return int8_t(clampIdx(int(floorf(v * GS)), 0, GS - 1));
+  };
+  return {cell(b.x - b.extentX()), cell(b.y - b.extentY()),
+          cell(b.x + b.extentX()), cell(b.y + b.extentY())};
+}
+
+// 增量固体标记：只重判各刚体「上一帧范围 ∪ 本帧范围」内的格子，
+// 类型有变化的格子写入变化列表；静止的刚体每帧只重判自身包围盒
+void ParticleSimulation::markBodyCells() {
+  m_changedCnt = 0;
+  for (int k = 0; k < m_numBodies; ++k) {
+    const CellBox nb = bodyCells(m_bodies[k]);
+    CellBox& ob = m_bodyBox[k];
+    int x0 = nb.x0, y0 = nb.y0, x1 = nb.x1, y1 = nb.y1;
+    if (ob.x0 <= ob.x1) {
+      x0 = ob.x0 < x0 ? ob.x0 : x0;
+      y0 = ob.y0 < y0 ? ob.y0 : y0;
+      x1 = ob.x1 > x1 ? ob.x1 : x1;
+      y1 = ob.y1 > y1 ? ob.y1 : y1;
+    }
+    ob = nb;
+
+    for (int gx = x0; gx <= x1; ++gx)
+      for (int gy = y0; gy <= y1; ++gy) {
+        const float cx = (gx + 0.5f) * CELL, cy = (gy + 0.5f) * CELL;
+        bool solid = wallCell(gx, gy);
+        for (int j = 0; j < m_numBodies && !solid; ++j)
+          solid = m_bodies[j].contains(cx, cy);
+
+        const int i = idx(gx, gy);
+        const CellType t = solid ? SOLID_CELL : FLUID_CELL;
+        if (m_cellType[i] != t) {
+          m_cellType[i] = t;
+          m_changedIdx[m_changedCnt++] = i;
+        }
+      }
   }
 }
 
+// ──────────────────────────────────────── 快照
+void ParticleSimulation::saveState(uint8_t* out) const {
+  const int32_t n = m_numBodies;
+  memcpy(out, m_u, sizeof(m_u));
+  out += sizeof(m_u);
+  memcpy(out, m_v, sizeof(m_v));
+  out += sizeof(m_v);
+  memcpy(out, &n, sizeof(n));
+  out += sizeof(n);
+  memcpy(out, m_bodies, sizeof(m_bodies));
+}
+
+void ParticleSimulation::loadState(const uint8_t* in) {
+  int32_t n;
+  memcpy(m_u, in, sizeof(m_u));
+  in += sizeof(m_u);
+  memcpy(m_v, in, sizeof(m_v));
+  in += sizeof(m_v);
+  memcpy(&n, in, sizeof(n));
+  in += sizeof(n);
+  memcpy(m_bodies, in, sizeof(m_bodies));
+
+  // 固体格按恢复后的刚体位置全量重建
+  m_numBodies = n < 0 ? 0 : (n > SIM_RIGID_MAX ? SIM_RIGID_MAX : n);
+  initGrid();
+  markBodyCells();
+}
+
 // ──────────────────────────────────────── Push-Apart
 void ParticleSimulation::pushParticlesApart(int iters) {
   const float min2 =  // PUSH_DIST_MODIFIER * PUSH_DIST_MODIFIER *
       (2 * PARTICLE_RADIUS) * (2 * PARTICLE_RADIUS);
 
-  memset(m_numPartCell, 0, sizeof(m_numPartCell));
-  for (int i = 0; i < m_numParticles; ++i) {
-    int xi = clampF(m_particles[i].x * P_INV_SP, 0, PNX - 1);
-    int yi = clampF(m_particles[i].y * P_INV_SP, 0, PNY - 1);
-    ++m_numPartCell[xi * PNY + yi];
-  }
-  int pref = 0;
-  for (int i = 0; i < PNC; ++i) {
-    int n = m_numPartCell[i];
-    m_firstPart[i] = pref;
-    pref += n;
-  }
-  m_firstPart[PNC] = pref;
-  for (int i = 0; i < m_numParticles; ++i) {
-    int xi = clampF(m_particles[i].x * P_INV_SP, 0, PNX - 1);
-    int yi = clampF(m_particles[i].y * P_INV_SP, 0, PNY - 1);
-    m_cellPartIds[--m_firstPart[xi * PNY + yi]] = i;
-  }
+  m_hash.build(m_particles, m_numParticles);
 
   for (int it = 0; it < iters; ++it) {
     for (int i = 0; i < m_numParticles; ++i) {
       Particle& a = m_particles[i];
-      int cx = a.x * P_INV_SP, cy = a.y * P_INV_SP;
-      for (int xi = max(cx - 1, 0); xi <= min(cx + 1, PNX - 1); ++xi)
-        for (int yi = max(cy - 1, 0); yi <= min(cy + 1, PNY - 1); ++yi) {
-          int cell = xi * PNY + yi;
-          for (int k = m_firstPart[cell]; k < m_firstPart[cell + 1]; ++k) {
-            int j = m_cellPartIds[k];
-            if (j <= i)
-              continue;
-            Particle& b = m_particles[j];
-            float dx = b.x - a.x, dy = b.y - a.y, d2 = dx * dx + dy * dy;
-            if (d2 > min2 || d2 == 0)
-              continue;
-            float d = sqrtf(d2),
-                  s =  // PUSH_FORCE_MODIFIER *
-                  0.5f * ((2 * PARTICLE_RADIUS) - d) / d;
-            dx *= s;
-            dy *= s;
-            a.x -= dx;
-            a.y -= dy;
-            b.x += dx;
-            b.y += dy;
-          }
-        }
+      m_hash.forEachNear(a.x, a.y, [&](int j) {
+        if (j <= i)
+          return;
+        Particle& b = m_particles[j];
+        float dx = b.x - a.x, dy = b.y - a.y, d2 = dx * dx + dy * dy;
+        if (d2 > min2 || d2 == 0)
+          return;
+        float d = sqrtf(d2),
+              s =  // PUSH_FORCE_MODIFIER *
+              0.5f * ((2 * PARTICLE_RADIUS) - d) / d;
+        dx *= s;
+        dy *= s;
+        a.x -= dx;
+        a.y -= dy;
+        b.x += dx;
+        b.y += dy;
+      });
     }
   }
 }
@@ -298,46 +572,3 @@ void ParticleSimulation::solveIncompressibility(int iters, float dt) {
       }
   }
 }
-
-// ──────────────────────────────────────── 状态统计
-
-void ParticleSimulation::updateFluidCells() {
-  /* 0️⃣ 备份上一帧状态 */
-  // memcpy(m_prevFluid, m_currFluid, sizeof(m_currFluid));
-
-  /* 1️⃣ 统计粒子覆盖半径：cnt[]、acc[] ---------------------------------- */
-  static uint16_t cnt[GC];
-  static float acc[GC];
-  memset(cnt, 0, sizeof(cnt));
-  memset(acc, 0, sizeof(acc));
-
-  const float r = PARTICLE_RADIUS;  // 归一化空间半径
-  const float r2 = r * r;           // 半径平方
-  const float cell = CELL;          // 1 / GS
-
-  for (int p = 0; p < m_numParticles; ++p) {
-    const float px = m_particles[p].x;
-    const float py = m_particles[p].y;
-    const float speed = hypotf(m_particles[p].vx, m_particles[p].vy);
-
-    /* —— 找出能被此粒子波及的格子 AABB —— */
-    int gx0 = clampIdx(static_cast<int>((px - r) * GS), 0, GS - 1);
-    int gy0 = clampIdx(static_cast<int>((py - r) * GS), 0, GS - 1);
-    int gx1 = clampIdx(static_cast<int>((px + r) * GS), 0, GS - 1);
-    int gy1 = clampIdx(static_cast<int>((py + r) * GS), 0, GS - 1);
-
-    for (int gx = gx0; gx <= gx1; ++gx)
-      for (int gy = gy0; gy <= gy1; ++gy) {
-        /* —— 精确判距：以格子中心为准 —— */
-        float cx = (gx + 0.5f) * cell;
-        float cy = (gy + 0.5f) * cell;
-        float dx = cx - px;
-        float dy = cy - py;
-        if (dx * dx + dy * dy > r2)
-          continue;                // 超出半径
-        int id = safeIdx(gx, gy);  // 统一使用 safeIdx
-        ++cnt[id];
-        acc[id] += speed;
-      }
-  }
-}
@@ -4,27 +4,16 @@
 #include <math.h>
 #include <stdint.h>
 #include <cstring>
-#include "qmi8658c.hpp"
+#include "FluidSimulation.hpp"
+#include "SpatialHash.hpp"
 
 // ─── 宏与常量 ─────────────────────────────────────
-#define LOGICAL_GRID_SIZE 16  // GS
-#define SCREEN_WIDTH 240
-#define SCREEN_HEIGHT 240
-#define PIXEL_PER_CELL (SCREEN_WIDTH / LOGICAL_GRID_SIZE)
-
 #define FOAM_SPEED_THRESHOLD 999.0f / LOGICAL_GRID_SIZE
-#define NUM_PARTICLES 100
-#define PARTICLE_RADIUS 0.5f / LOGICAL_GRID_SIZE  // 归一化单位；≈ 单元半径一半
 #define FLUID_DENSITY 1.0f
 #define SOLVER_ITERS_P 1
 #define SEPARATE_ITERS_P 2
 #define FLIP_RATIO 0.5f
 
-#define GRAVITY_MODIFIER 1
-
-#define REST_N 0.02f
-#define FRIC_T 0.05f
-
 // ─── 枚举 ─────────────────────────────────────────
 enum CellType : uint8_t { FLUID_CELL, AIR_CELL, SOLID_CELL };
 enum FluidType : uint8_t {
@@ -35,34 +24,39 @@ enum FluidType : uint8_t {
   FLUID_RIM_LIGHT
 };
 
-// ─── 结构 ─────────────────────────────────────────
-struct Particle {
-  float x, y;     // 位置  ∈ [0,1]
-  float vx, vy;   // 速度
-  float r, g, b;  // 调试颜色
-};
-
 // ─── 主类 ─────────────────────────────────────────
-class ParticleSimulation {
+class ParticleSimulation : public FluidSimulation {
  public:
-  void begin(QMI8658C* imu);
-  void simulate(float dt);
+  void begin(ImuSource* imu) override;
+  void simulate(float dt) override;
+  const char* name() const override { return "FLIP"; }
+  uint8_t engineId() const override { return FLUID_ENGINE_FLIP; }
+  int stageCount() const override;
+  const char* stageName(int i) const override;
 
   // 渲染层接口
-  const Particle* data() const { return m_particles; }
-  int particleCount() const { return m_numParticles; }
-  bool isSolid(int gx, int gy) const {
+  const Particle* data() const override { return m_particles; }
+  bool isSolid(int gx, int gy) const override {
     return m_cellType[gx * GS + gy] == SOLID_CELL;
   }
+  // 本帧固体/流体类型发生变化的模拟格（刚体移动扫过的格子）
   const int* changedIndices() const { return m_changedIdx; }
   int changedCount() const { return m_changedCnt; }
 
-  // 静态别名
-  static constexpr int GS = LOGICAL_GRID_SIZE;  // 网格边
-  static constexpr int GC = GS * GS;            // 单元数
-  static constexpr float CELL = 1.0f / GS;      // 单元物理尺寸
-  static constexpr float H = CELL;              // 与旧代码兼容
-  static constexpr int PC_MAX = NUM_PARTICLES;
+  // 刚体：与流体双向耦合（粒子推刚体、刚体排开粒子并占据固体格）。
+  // begin() 之后添加；快照按槽位保存，故须在 load() 之前添加完毕
+  /// @return 刚体编号；已满时 -1
+  int addRigidBody(float x,
+                   float y,
+                   float radius,
+                   float halfLen = 0.f,
+                   float angle = 0.f,
+                   float density = SIM_RIGID_DENSITY);
+  void clearRigidBodies();
+  int rigidCount() const override { return m_numBodies; }
+  const RigidBody* rigidBodies() const override { return m_bodies; }
+
+  static constexpr float H = CELL;  // 与旧代码兼容
 
   // 公开流体面板
   // FluidType m_currFluid[GC]{};
@@ -77,32 +71,46 @@ class ParticleSimulation {
 
   // ── 粒子字段 ───────────────────────────────
   Particle m_particles[PC_MAX];
-  int m_numParticles{0};
 
   // 空间哈希
   static constexpr float P_INV_SP = 1.0f / (2.2f * PARTICLE_RADIUS);  // 归一化
   static constexpr int PNX = int(1.0f * P_INV_SP) + 2;
-  static constexpr int PNY = PNX;
-  static constexpr int PNC = PNX * PNY;
-  int m_numPartCell[PNC]{}, m_firstPart[PNC + 1]{}, m_cellPartIds[PC_MAX]{};
+  SpatialHash<PNX, PC_MAX> m_hash{P_INV_SP};
 
   // 变化列表
   int m_changedIdx[GC]{}, m_changedCnt{0};
 
-  // 传感器
-  QMI8658C* m_imu{nullptr};
-  float m_ax{0.f}, m_ay{0.f};
+  // ── 刚体 ───────────────────────────────────
+  struct CellBox {
+    int8_t x0, y0, x1, y1;  // 闭区间；x0 > x1 表示空
+  };
+  RigidBody m_bodies[SIM_RIGID_MAX]{};
+  CellBox m_bodyBox[SIM_RIGID_MAX]{};  // 上一帧标记为固体的格子范围
+  int m_numBodies{0};
+
+  // ── 快照：网格速度（prevU/V、du/dv 每帧重建，无需保存） ──
+  Particle* particles() override { return m_particles; }
+  size_t stateSize() const override {
+    return sizeof(m_u) + sizeof(m_v) + sizeof(int32_t) + sizeof(m_bodies);
+  }
+  void saveState(uint8_t* out) const override;
+  void loadState(const uint8_t* in) override;
 
   // ── 内部算法 ───────────────────────────────
   void seedParticles();
   void initGrid();
-  void updateIMU();
+  bool wallCell(int gx, int gy) const;
   void integrateParticles(float dt);
+
+  void integrateBodies(float dt);
+  void collideBodyPair(RigidBody& a, RigidBody& b);
+  void collideParticleBody(Particle& p, RigidBody& b);
+  CellBox bodyCells(const RigidBody& b) const;
+  void markBodyCells();
   void pushParticlesApart(int iters);
 
   void transferVelocities(bool toGrid, float flipRatio);
   void solveIncompressibility(int iters, float dt);
-  void updateFluidCells();
   // 工具
   inline int idx(int x, int y) const { return x * GS + y; }
   static inline float clampF(float v, float lo, float hi) {
@@ -0,0 +1,122 @@
+#include "SecondaryPool.hpp"
+#include <math.h>
+
+// ──────────────────────────────────────── 池管理
+void SecondaryPool::clear(uint32_t seed) {
+  for (int i = 0; i < CAP; ++i) {
+    m_p[i].life = 0;
+    m_p[i].next = i + 1 < CAP ? i + 1 : -1;
+  }
+  m_free = 0;
+  m_active = 0;
+  m_rng = seed ? seed : SIM_DEFAULT_SEED;
+}
+
+int SecondaryPool::alloc() {
+  if (m_free < 0)
+    return -1;
+  int i = m_free;
+  m_free = m_p[i].next;
+  ++m_active;
+  return i;
+}
+
+void SecondaryPool::release(int i) {
+  m_p[i].life = 0;
+  m_p[i].next = m_free;
+  m_free = i;
+  --m_active;
+}
+
+// ──────────────────────────────────────── 主循环
+void SecondaryPool::update(const FluidSimulation& sim, float dt) {
+  if (dt <= 0.f)
+    return;
+  const CellStats& st = sim.cellStats();
+  advect(st, sim.gravityX(), sim.gravityY(), dt);
+  spawn(st);
+}
+
+// ──────────────────────────────────────── 平流
+void SecondaryPool::advect(const CellStats& st,
+                           float ax,
+                           float ay,
+                           float dt) {
+  constexpr int GS = CellStats::GS;
+  constexpr uint32_t SPRAY_OCC = uint32_t(SECONDARY_SPRAY_OCC * 256);
+  constexpr uint32_t BUBBLE_OCC = uint32_t(SECONDARY_BUBBLE_OCC * 256);
+  constexpr float Q8 = 1.0f / 256.f;
+  constexpr float rad = 0.5f - 1.0f / GS;  // 与模拟端圆容器相同
+
+  for (int i = 0; i < CAP; ++i) {
+    SecondaryParticle& s = m_p[i];
+    if (!s.life)
+      continue;
+
+    int gx = int(s.x * GS), gy = int(s.y * GS);
+    gx = gx < 0 ? 0 : (gx > GS - 1 ? GS - 1 : gx);
+    gy = gy < 0 ? 0 : (gy > GS - 1 ? GS - 1 : gy);
+    const int id = gx * GS + gy;
+    const uint32_t occ = st.occ[id];
+
+    // 按所在格占有量重新分类
+    if (occ < SPRAY_OCC) {
+      s.type = SECONDARY_SPRAY;
+      s.vx += ax * dt;
+      s.vy += ay * dt;
+    } else if (occ > BUBBLE_OCC) {
+      s.type = SECONDARY_BUBBLE;
+      s.vx = st.vx[id] * Q8 - ax * SECONDARY_BUOYANCY;
+      s.vy = st.vy[id] * Q8 - ay * SECONDARY_BUOYANCY;
+    } else {
+      s.type = SECONDARY_FOAM;
+      s.vx = st.vx[id] * Q8;
+      s.vy = st.vy[id] * Q8;
+    }
+
+    s.x += s.vx * dt;
+    s.y += s.vy * dt;
+
+    const float dx = s.x - 0.5f, dy = s.y - 0.5f;
+    if (--s.life == 0 || dx * dx + dy * dy > rad * rad)
+      release(i);
+  }
+}
+
+// ──────────────────────────────────────── 生成
+void SecondaryPool::spawn(const CellStats& st) {
+  constexpr int GS = CellStats::GS;
+  constexpr float CELL = 1.0f / GS;
+  constexpr float Q8 = 1.0f / 256.f;
+
+  if (!st.foamCells)
+    return;
+
+  // 从随机列开始扫描，避免总在左侧生成
+  int budget = SECONDARY_SPAWN_MAX;
+  const int start = randomRange(0, GS);
+  for (int k = 0; k < GS && budget > 0; ++k) {
+    const int gx = (start + k) % GS;
+    uint32_t bits = st.foam[gx];
+    while (bits && budget > 0) {
+      const int gy = __builtin_ctz(bits);
+      bits &= bits - 1;
+
+      const int i = alloc();
+      if (i < 0)
+        return;  // 池满
+      --budget;
+
+      const int id = gx * GS + gy;
+      SecondaryParticle& s = m_p[i];
+      s.x = (gx + randomRange(0, 256) * Q8) * CELL;
+      s.y = (gy + randomRange(0, 256) * Q8) * CELL;
+      // 继承格子速度，±10% 扰动
+      s.vx = st.vx[id] * Q8 * (1.f + randomRange(-10, 11) * 0.01f);
+      s.vy = st.vy[id] * Q8 * (1.f + randomRange(-10, 11) * 0.01f);
+      s.type = SECONDARY_FOAM;
+      s.life = SECONDARY_LIFE * 3 / 4 + randomRange(0, SECONDARY_LIFE / 2 + 1);
+      s.next = -1;
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "FluidSimulation.hpp"
+
+// ─── 宏与常量 ─────────────────────────────────────
+#define SECONDARY_MAX 64          // 池容量（固定，RAM 上限 ≈ 64 × 20 B）
+#define SECONDARY_SPAWN_MAX 4     // 每帧最多生成个数
+#define SECONDARY_LIFE 45         // 寿命（帧），生成时 ±25% 随机
+#define SECONDARY_SPRAY_OCC 0.25f  // 所在格占有量低于此：飞沫（弹道）
+#define SECONDARY_BUBBLE_OCC 2.0f  // 高于此：气泡（随流 + 上浮）
+#define SECONDARY_BUOYANCY 0.05f   // 气泡上浮速度 = -重力 × 该值（秒）
+
+// ─── 结构 ─────────────────────────────────────────
+enum SecondaryType : uint8_t {
+  SECONDARY_SPRAY,   // 液面外：只受重力
+  SECONDARY_FOAM,    // 液面：随格子平均速度漂移
+  SECONDARY_BUBBLE,  // 液体内部：随流并逆重力上浮
+};
+
+struct SecondaryParticle {
+  float x, y;    // 位置 ∈ [0,1]
+  float vx, vy;  // 速度
+  uint8_t type;  // SecondaryType，每帧按所在格占有量重新判定
+  uint8_t life;  // 剩余帧数；0 = 空闲
+  int8_t next;   // 空闲链表
+};
+
+// ─── 次级粒子池 ───────────────────────────────────
+// 泡沫 / 飞沫 / 气泡：从 CellStats 的泡沫候选格生成，只做平流，
+// 不参与压力求解，也不反作用于主模拟。容量固定，空闲槽位串成链表，
+// 生成 / 回收均为 O(1)；池满时直接丢弃新的生成请求。
+class SecondaryPool {
+ public:
+  static constexpr int CAP = SECONDARY_MAX;
+  static_assert(CAP <= 127, "空闲链表用 int8_t 下标");
+
+  SecondaryPool() { clear(); }
+
+  // 清空并重设 PRNG；传 sim.seed() 使次级粒子随模拟种子复现
+  void clear(uint32_t seed = SIM_DEFAULT_SEED);
+  // 每帧在 sim.simulate() 之后调用
+  void update(const FluidSimulation& sim, float dt);
+
+  int activeCount() const { return m_active; }
+
+  template <typename F>
+  void forEach(F&& f) const {
+    for (int i = 0; i < CAP; ++i)
+      if (m_p[i].life)
+        f(m_p[i]);
+  }
+
+ private:
+  SecondaryParticle m_p[CAP];
+  int8_t m_free{-1};  // 空闲链表头；-1 = 池满
+  int m_active{0};
+  uint32_t m_rng{SIM_DEFAULT_SEED};
+
+  int alloc();
+  void release(int i);
+  void advect(const CellStats& st, float ax, float ay, float dt);
+  void spawn(const CellStats& st);
+
+  // [lo, hi) 均匀整数（xorshift32，与模拟端相同）
+  int32_t randomRange(int32_t lo, int32_t hi) {
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 17;
+    m_rng ^= m_rng << 5;
+    return lo + static_cast<int32_t>(m_rng % static_cast<uint32_t>(hi - lo));
+  }
+};
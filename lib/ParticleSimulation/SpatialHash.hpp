@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// ─── 计数排序空间哈希 ─────────────────────────────
+// NX×NX 均匀格子覆盖 [0,1]²；build() 用计数排序把粒子下标按格子连续存放，
+// forEachNear() 遍历 3×3 邻域格子内的粒子（格子边长 ≥ 查询半径即可）。
+// T 只需有 x / y 成员（Particle 或预测位置）。
+template <int NX, int CAP>
+class SpatialHash {
+ public:
+  static constexpr int NC = NX * NX;
+
+  explicit SpatialHash(float invSpacing) : m_invSp(invSpacing) {}
+
+  template <typename T>
+  void build(const T* pts, int n) {
+    memset(m_numPartCell, 0, sizeof(m_numPartCell));
+    for (int i = 0; i < n; ++i)
+      ++m_numPartCell[cellOf(pts[i].x, pts[i].y)];
+
+    // 包含式前缀和：m_firstPart[c] 先指向格子末尾
+    int pref = 0;
+    for (int i = 0; i < NC; ++i) {
+      pref += m_numPartCell[i];
+      m_firstPart[i] = pref;
+    }
+    m_firstPart[NC] = pref;
+    // 倒序回填：结束后 m_firstPart[c] 恰好回到格子起点
+    for (int i = 0; i < n; ++i)
+      m_cellPartIds[--m_firstPart[cellOf(pts[i].x, pts[i].y)]] = i;
+  }
+
+  template <typename F>
+  void forEachNear(float x, float y, F&& f) const {
+    int cx = x * m_invSp, cy = y * m_invSp;
+    for (int xi = max0(cx - 1); xi <= minN(cx + 1); ++xi)
+      for (int yi = max0(cy - 1); yi <= minN(cy + 1); ++yi) {
+        int cell = xi * NX + yi;
+        for (int k = m_firstPart[cell]; k < m_firstPart[cell + 1]; ++k)
+          f(m_cellPartIds[k]);
+      }
+  }
+
+ private:
+  float m_invSp;
+  int m_numPartCell[NC]{}, m_firstPart[NC + 1]{}, m_cellPartIds[CAP]{};
+
+  static inline int max0(int v) { return v < 0 ? 0 : v; }
+  static inline int minN(int v) { return v > NX - 1 ? NX - 1 : v; }
+  inline int clampCell(float v) const {
+    return v < 0 ? 0 : (v > NX - 1 ? NX - 1 : int(v));
+  }
+  inline int cellOf(float x, float y) const {
+    return clampCell(x * m_invSp) * NX + clampCell(y * m_invSp);
+  }
+};
@@ -0,0 +1,218 @@
+#include "SphSimulation.hpp"
+#include <math.h>
+#include <string.h>
+
+// ──────────────────────────────────────── 初始化
+void SphSimulation::begin(ImuSource* imu) {
+  m_imu = imu;
+  setParticleCount(m_numParticles);
+  seedParticles();
+
+  // 静止密度：间距 2r 的方格排布下，单个粒子看到的核和
+  const float sp = 2 * PARTICLE_RADIUS;
+  const int R = int(H / sp) + 1;
+  float rho = 0.f;
+  for (int i = -R; i <= R; ++i)
+    for (int j = -R; j <= R; ++j)
+      rho += poly6((i * i + j * j) * sp * sp);
+  m_restDensity = rho;
+}
+
+void SphSimulation::seedParticles() {
+  for (int i = 0; i < m_numParticles; ++i) {
+    // 与 FLIP 相同：0.2 ~ 0.8 区域内随机
+    m_particles[i].x = randomRange(20, 80) / 100.0f;
+    m_particles[i].y = randomRange(20, 80) / 100.0f;
+    m_particles[i].vx = randomRange(-50, 50) / 100.0f * CELL;
+    m_particles[i].vy = randomRange(-50, 50) / 100.0f * CELL;
+    m_particles[i].r = 0.2f;
+    m_particles[i].g = 0.4f;
+    m_particles[i].b = 1.0f;
+  }
+}
+
+// ──────────────────────────────────────── 主循环
+static const char* const STAGE_NAMES[] = {"IMU", "Pred", "Hash", "Solve",
+                                          "Vel", "Stat"};
+
+int SphSimulation::stageCount() const {
+  return sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]);
+}
+
+const char* SphSimulation::stageName(int i) const {
+  return STAGE_NAMES[i];
+}
+
+void SphSimulation::simulate(float dt) {
+  /* ───── 计时用变量 ─────────────────── */
+  static uint32_t accIMU = 0;
+  static uint32_t accPred = 0;
+  static uint32_t accHash = 0;
+  static uint32_t accSolve = 0;
+  static uint32_t accVel = 0;
+  static uint32_t accStat = 0;
+  static uint32_t frames = 0;
+  static uint32_t tLastPrint = millis();
+
+  if (dt <= 0.f)
+    return;
+
+  /* ───── 阶段 1：IMU ─────────────────── */
+  uint32_t t0 = micros();
+  updateIMU();
+  uint32_t t1 = micros();
+
+  /* ───── 阶段 2：外力 + 预测位置 ──────── */
+  predict(dt);
+  uint32_t t2 = micros();
+
+  /* ───── 阶段 3：空间哈希 ─────────────── */
+  m_hash.build(m_pred, m_numParticles);
+  uint32_t t3 = micros();
+
+  /* ───── 阶段 4：密度约束 ─────────────── */
+  for (int it = 0; it < SPH_SOLVER_ITERS; ++it)
+    solveDensity();
+  uint32_t t4 = micros();
+
+  /* ───── 阶段 5：速度 + XSPH ──────────── */
+  updateVelocities(dt);
+  uint32_t t5 = micros();
+
+  /* ───── 阶段 6：逐格统计 ──────────────── */
+  updateCellStats();
+  uint32_t t6 = micros();
+
+  /* ───── 累加 ─────────────────────────── */
+  m_stageUs[0] = t1 - t0;
+  m_stageUs[1] = t2 - t1;
+  m_stageUs[2] = t3 - t2;
+  m_stageUs[3] = t4 - t3;
+  m_stageUs[4] = t5 - t4;
+  m_stageUs[5] = t6 - t5;
+  accIMU += m_stageUs[0];
+  accPred += m_stageUs[1];
+  accHash += m_stageUs[2];
+  accSolve += m_stageUs[3];
+  accVel += m_stageUs[4];
+  accStat += m_stageUs[5];
+  ++frames;
+
+  /* ───── 每秒打印一次 ─────────────────── */
+  if (millis() - tLastPrint >= 1000) {
+    if (m_stagePrint)
+      Serial.printf(
+          "[%3u fps]  IMU:%4lu  Pred:%4lu  Hash:%4lu  Solve:%4lu  Vel:%4lu  "
+          "Stat:%4lu (µs per frame)\r\n",
+          frames, accIMU / frames, accPred / frames, accHash / frames,
+          accSolve / frames, accVel / frames, accStat / frames);
+    accIMU = accPred = accHash = accSolve = accVel = accStat = 0;
+    frames = 0;
+    tLastPrint = millis();
+  }
+}
+
+// ──────────────────────────────────────── 预测
+void SphSimulation::predict(float dt) {
+  for (int i = 0; i < m_numParticles; ++i) {
+    Particle& p = m_particles[i];
+    p.vx += m_ax * dt;
+    p.vy += m_ay * dt;
+    m_pred[i].x = p.x + p.vx * dt;
+    m_pred[i].y = p.y + p.vy * dt;
+    collide(m_pred[i]);
+  }
+}
+
+// ──────────────────────────────────────── 密度约束
+void SphSimulation::solveDensity() {
+  const float invRho0 = 1.0f / m_restDensity;
+
+  // ① λ_i = -C_i / (Σ|∇C|² + ε)，C_i 单边（只推不拉，避免表面结团）
+  for (int i = 0; i < m_numParticles; ++i) {
+    const Pos& a = m_pred[i];
+    float rho = 0.f, gx = 0.f, gy = 0.f, sum2 = 0.f;
+    m_hash.forEachNear(a.x, a.y, [&](int j) {
+      float dx = a.x - m_pred[j].x, dy = a.y - m_pred[j].y;
+      float r2 = dx * dx + dy * dy;
+      if (r2 >= H * H)
+        return;
+      rho += poly6(r2);
+      if (j == i || r2 == 0.f)
+        return;
+      float r = sqrtf(r2);
+      float g = spikyGrad(r) * invRho0 / r;
+      gx += g * dx;
+      gy += g * dy;
+      sum2 += g * g * r2;
+    });
+    float C = rho * invRho0 - 1.f;
+    sum2 += gx * gx + gy * gy;
+    m_lambda[i] = C > 0.f ? -C / (sum2 + SPH_RELAXATION) : 0.f;
+  }
+
+  // ② Δp_i = Σ (λ_i + λ_j) ∇W / ρ0，就地更新（Gauss-Seidel 风格）
+  for (int i = 0; i < m_numParticles; ++i) {
+    Pos& a = m_pred[i];
+    float px = 0.f, py = 0.f;
+    m_hash.forEachNear(a.x, a.y, [&](int j) {
+      if (j == i)
+        return;
+      float dx = a.x - m_pred[j].x, dy = a.y - m_pred[j].y;
+      float r2 = dx * dx + dy * dy;
+      if (r2 >= H * H || r2 == 0.f)
+        return;
+      float r = sqrtf(r2);
+      float s = (m_lambda[i] + m_lambda[j]) * spikyGrad(r) / r;
+      px += s * dx;
+      py += s * dy;
+    });
+    a.x += px * invRho0;
+    a.y += py * invRho0;
+    collide(a);
+  }
+}
+
+// ──────────────────────────────────────── 圆容器
+void SphSimulation::collide(Pos& p) const {
+  constexpr float CX = 0.5f, CY = 0.5f, R = 0.5f - CELL - PARTICLE_RADIUS;
+  float dx = p.x - CX, dy = p.y - CY;
+  float d2 = dx * dx + dy * dy;
+  if (d2 > R * R) {
+    float s = R / sqrtf(d2);
+    p.x = CX + dx * s;
+    p.y = CY + dy * s;
+  }
+}
+
+// ──────────────────────────────────────── 速度
+void SphSimulation::updateVelocities(float dt) {
+  const float invDt = 1.0f / dt;
+  for (int i = 0; i < m_numParticles; ++i) {
+    Particle& p = m_particles[i];
+    p.vx = (m_pred[i].x - p.x) * invDt;
+    p.vy = (m_pred[i].y - p.y) * invDt;
+  }
+
+  // XSPH：向邻居平均速度靠拢，抑制高频抖动
+  for (int i = 0; i < m_numParticles; ++i) {
+    const Pos& a = m_pred[i];
+    Particle& p = m_particles[i];
+    float dvx = 0.f, dvy = 0.f;
+    m_hash.forEachNear(a.x, a.y, [&](int j) {
+      if (j == i)
+        return;
+      float dx = a.x - m_pred[j].x, dy = a.y - m_pred[j].y;
+      float w = poly6(dx * dx + dy * dy);
+      dvx += (m_particles[j].vx - p.vx) * w;
+      dvy += (m_particles[j].vy - p.vy) * w;
+    });
+    p.vx += SPH_XSPH_C * dvx / m_restDensity;
+    p.vy += SPH_XSPH_C * dvy / m_restDensity;
+  }
+
+  for (int i = 0; i < m_numParticles; ++i) {
+    m_particles[i].x = m_pred[i].x;
+    m_particles[i].y = m_pred[i].y;
+  }
+}
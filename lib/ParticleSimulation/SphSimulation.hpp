@@ -0,0 +1,68 @@
+#pragma once
+#include "FluidSimulation.hpp"
+#include "SpatialHash.hpp"
+
+// ─── 宏与常量 ─────────────────────────────────────
+#define SPH_SUPPORT (4.0f * PARTICLE_RADIUS)  // 核半径 h ≈ 两倍粒子间距
+#define SPH_SOLVER_ITERS 3                    // 密度约束迭代次数
+#define SPH_RELAXATION 100.0f                 // 约束软化 ε（λ 分母）
+#define SPH_XSPH_C 0.02f                      // XSPH 人工粘性
+
+// ─── 主类 ─────────────────────────────────────────
+// 基于位置的 SPH (Macklin & Müller 2013, PBF)：
+// 没有欧拉网格，邻域查询复用 SpatialHash（与 FLIP 推开阶段相同的计数排序）。
+// 面向 < 100 粒子的低功耗配置：此时 16×16 网格的搬运/压力阶段反而是大头。
+class SphSimulation : public FluidSimulation {
+ public:
+  void begin(ImuSource* imu) override;
+  void simulate(float dt) override;
+  const char* name() const override { return "PB-SPH"; }
+  uint8_t engineId() const override { return FLUID_ENGINE_SPH; }
+  int stageCount() const override;
+  const char* stageName(int i) const override;
+
+  // 渲染层接口
+  const Particle* data() const override { return m_particles; }
+  bool isSolid(int gx, int gy) const override {
+    return outsideContainer((gx + 0.5f) * CELL, (gy + 0.5f) * CELL);
+  }
+
+ private:
+  struct Pos {
+    float x, y;
+  };
+
+  // ── 粒子字段 ───────────────────────────────
+  Particle m_particles[PC_MAX];
+  Pos m_pred[PC_MAX];        // 预测位置
+  float m_lambda[PC_MAX]{};  // 密度约束乘子
+  float m_restDensity{1.f};
+
+  // 空间哈希：格子边长 = 核半径
+  static constexpr float H = SPH_SUPPORT;
+  static constexpr float INV_H = 1.0f / H;
+  static constexpr int HNX = int(INV_H) + 1;
+  SpatialHash<HNX, PC_MAX> m_hash{INV_H};
+
+  // 快照：λ 与预测位置每帧重建，只需粒子本身
+  Particle* particles() override { return m_particles; }
+
+  // ── 内部算法 ───────────────────────────────
+  void seedParticles();
+  void predict(float dt);
+  void solveDensity();
+  void collide(Pos& p) const;
+  void updateVelocities(float dt);
+
+  // 2D 核函数：poly6 求密度，spiky 梯度求修正
+  static inline float poly6(float r2) {
+    constexpr float k = 4.0f / (3.14159265f * H * H * H * H * H * H * H * H);
+    float d = H * H - r2;
+    return d > 0.f ? k * d * d * d : 0.f;
+  }
+  static inline float spikyGrad(float r) {  // |∇W|，方向 -r̂
+    constexpr float k = -30.0f / (3.14159265f * H * H * H * H * H);
+    float d = H - r;
+    return d > 0.f ? k * d * d : 0.f;
+  }
+};
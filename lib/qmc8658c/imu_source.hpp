@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Minimal read interface shared by the QMI8658C driver and offline sample
+ * sources (e.g. trace replay). Consumers such as
+ * `FluidSimulation::updateIMU` only depend on this.
+ */
+class ImuSource {
+ public:
+  virtual ~ImuSource() = default;
+
+  /// @brief reads the current accelerometer values
+  /// @param ax x-axis value in g
+  /// @param ay y-axis value in g
+  /// @param az z-axis value in g
+  /// @return `true` on success, `false` if the read operation failed
+  virtual bool readAccelerometer(float* ax, float* ay, float* az) = 0;
+  /// @brief reads out the current gyroscope values
+  /// @param gx x-axis rotation in dps (degrees per second)
+  /// @param gy y-axis rotation in dps (degrees per second)
+  /// @param gz z-axis rotation in dps (degrees per second)
+  /// @return `true` on success, `false` if the read operation failed
+  virtual bool readGyroscope(float* gx, float* gy, float* gz) = 0;
+  /// @brief reads the current accelerometer values in Q16.16 g (65536 = 1 g)
+  /// @return `true` on success, `false` if the read operation failed
+  /// @note the default converts `readAccelerometer()`; drivers override it
+  /// with an integer path straight from the raw counts
+  virtual bool readAccelerometerQ16(int32_t* ax, int32_t* ay, int32_t* az) {
+    float x, y, z;
+    if (!readAccelerometer(&x, &y, &z))
+      return false;
+    *ax = static_cast<int32_t>(x * 65536.0f);
+    *ay = static_cast<int32_t>(y * 65536.0f);
+    *az = static_cast<int32_t>(z * 65536.0f);
+    return true;
+  }
+  /// @brief reads the current gyroscope values in Q16.16 dps
+  /// @return `true` on success, `false` if the read operation failed
+  virtual bool readGyroscopeQ16(int32_t* gx, int32_t* gy, int32_t* gz) {
+    float x, y, z;
+    if (!readGyroscope(&x, &y, &z))
+      return false;
+    *gx = static_cast<int32_t>(x * 65536.0f);
+    *gy = static_cast<int32_t>(y * 65536.0f);
+    *gz = static_cast<int32_t>(z * 65536.0f);
+    return true;
+  }
+  /// @brief reads the sensor-fused rotation since the previous sample as a
+  /// unit quaternion increment (w, x, y, z) in Q14 (16384 = 1.0); each
+  /// increment is returned once
+  /// @return `false` if the source has no such output (the default) or no
+  /// new increment since the last read
+  virtual bool readRotationIncrement(int16_t* dq) { return false; }
+};
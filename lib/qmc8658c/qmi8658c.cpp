@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include <I2Cdev.h>
+#include <string.h>
 
 #include "qmi8658c.hpp"
 
@@ -30,6 +31,85 @@ bool QMI8658C::detectDevice() {
   return true;
 }
 
+bool QMI8658C::ctrl9Command(uint8_t command) {
+  I2Cdev::writeByte(m_i2cAddress, QMI8658C_REG_CTRL9, command, m_wire);
+
+  // the device raises CmdDone once the command has been executed
+  uint8_t status = 0;
+  uint32_t start = millis();
+  while (true) {
+    if (I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_STATUS_INT, &status,
+                         I2Cdev::readTimeout, m_wire) > 0 &&
+        (status & QMI8658C_STATUS_INT_CMD_DONE))
+      break;
+
+    if (millis() - start > QMI8658C_CTRL9_TIMEOUT_MS)
+      return false;
+    delay(1);
+  }
+
+  // acknowledge, which clears CmdDone again
+  I2Cdev::writeByte(m_i2cAddress, QMI8658C_REG_CTRL9, QMI8658C_CTRL9_CMD_ACK,
+                    m_wire);
+  return true;
+}
+
+// ------------------ shadow registers ------------------
+
+void QMI8658C::loadShadow() {
+  for (uint8_t i = 0; i < QMI8658C_SHADOW_COUNT; i++)
+    I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_CTRL1 + i, &m_reg[i],
+                     I2Cdev::readTimeout, m_wire);
+  memcpy(m_next, m_reg, sizeof(m_reg));
+}
+
+void QMI8658C::setRegister(uint8_t address, uint8_t mask, uint8_t value) {
+  uint8_t& r = m_next[address - QMI8658C_REG_CTRL1];
+  r = (r & ~mask) | (value & mask);
+  if (!m_batch)
+    flushShadow();
+}
+
+bool QMI8658C::flushShadow() {
+  // sensors that are switched off go off before the reconfiguration,
+  // sensors that are switched on come up after it (CTRL7 is last in the run)
+  constexpr int ctrl7 = QMI8658C_REG_CTRL7 - QMI8658C_REG_CTRL1;
+  const uint8_t turning_off = m_reg[ctrl7] & ~m_next[ctrl7] & 0b11;
+  if (turning_off && memcmp(m_next, m_reg, ctrl7) != 0) {
+    uint8_t off = m_reg[ctrl7] & ~turning_off;
+    if (!I2Cdev::writeByte(m_i2cAddress, QMI8658C_REG_CTRL7, off, m_wire))
+      return false;
+    m_reg[ctrl7] = off;
+  }
+
+  int first = -1, last = -1;
+  for (int i = 0; i < QMI8658C_SHADOW_COUNT; i++)
+    if (m_next[i] != m_reg[i]) {
+      first = first < 0 ? i : first;
+      last = i;
+    }
+  if (first < 0)
+    return true;  // nothing changed
+
+  // one auto-increment burst over [first, last]; unchanged registers in
+  // between are rewritten with their current value
+  if (!I2Cdev::writeBytes(m_i2cAddress, QMI8658C_REG_CTRL1 + first,
+                          last - first + 1, &m_next[first], m_wire))
+    return false;
+  // the gyro turn-on time runs from the write that actually switches it
+  // on, not from enable(): an off/on pair inside a batch changes nothing
+  if (~m_reg[ctrl7] & m_next[ctrl7] & QMI8658C_CTRL7_GYRO_EN)
+    m_gyroOnMs = millis();
+  memcpy(&m_reg[first], &m_next[first], last - first + 1);
+  return true;
+}
+
+bool QMI8658C::commit() {
+  if (m_batch)
+    m_batch--;
+  return m_batch ? true : flushShadow();
+}
+
 bool QMI8658C::i2cReadU16(uint8_t register_l,
                           uint8_t register_h,
                           uint16_t* buffer) {
@@ -51,14 +131,12 @@ bool QMI8658C::i2cReadU16(uint8_t register_l,
 uint8_t QMI8658C::i2cReadRegisterBlock(uint8_t start_register,
                                        uint8_t length,
                                        uint8_t* buffer) {
-  uint8_t read = 0;
-
-  for (uint8_t i = 0; i < length; i++)
-    if (I2Cdev::readByte(m_i2cAddress, start_register + i, &buffer[i],
-                         I2Cdev::readTimeout, m_wire))
-      read++;
+  // CTRL1 ADDR_AI is set in begin(): one burst instead of a transaction per
+  // register
+  int8_t read = I2Cdev::readBytes(m_i2cAddress, start_register, length, buffer,
+                                  I2Cdev::readTimeout, m_wire);
 
-  return read;
+  return read < 0 ? 0 : read;
 }
 
 bool QMI8658C::begin() {
@@ -94,13 +172,22 @@ bool QMI8658C::begin(TwoWire* wire, uint8_t device_address) {
     whoami_tries++;
   }
 
+  // the IMU keeps its configuration across MCU resets: start from the
+  // device's actual registers, then enable address auto-increment so that
+  // shadow commits can be written as one burst
+  loadShadow();
+  setRegister(QMI8658C_REG_CTRL1, QMI8658C_CTRL1_ADDR_AI,
+              QMI8658C_CTRL1_ADDR_AI);
+
   // default settings
   // enable gyroscope and accelerometer
+  beginBatch();
   enable(true, true);
   configureAcc();
   configureGyro();
+  m_powerMode = PowerMode::ACC_GYRO;
 
-  return true;
+  return commit();
 }
 
 bool QMI8658C::deviceInfo(uint8_t* device_id, uint8_t* device_revision) {
@@ -114,22 +201,54 @@ bool QMI8658C::deviceInfo(uint8_t* device_id, uint8_t* device_revision) {
 }
 
 void QMI8658C::enable(bool enable_gyro, bool enable_acc) {
-  uint8_t value = 0;
-  I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_CTRL7, &value,
-                   I2Cdev::readTimeout, m_wire);
-  value = ((value & 0b1111'1100) |
-           ((enable_gyro ? 1 : 0) << 1 | (enable_acc ? 1 : 0)));
+  // low-power accelerometer rates are invalid in 6DOF mode: go back to the
+  // active rate before the gyroscope comes up
+  if (enable_gyro && m_accLowPower)
+    writeAccConfig(m_accScale, m_accOdr, m_accLpf);
 
-  I2Cdev::writeByte(m_i2cAddress, QMI8658C_REG_CTRL7, value, m_wire);
+  setRegister(QMI8658C_REG_CTRL7, 0b0000'0011,
+              (enable_gyro ? 1 : 0) << 1 | (enable_acc ? 1 : 0));
+
+  m_gyroEnabled = enable_gyro;
+  m_accEnabled = enable_acc;
 }
 
-void QMI8658C::configureHsClock(bool enable) {
-  uint8_t value = 0;
-  I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_CTRL7, &value,
-                   I2Cdev::readTimeout, m_wire);
-  value = ((value & 0b1011'1111) | (enable ? 1 : 0) << 6);
+bool QMI8658C::setPowerMode(PowerMode mode, AccODR lp_odr) {
+  if (mode == PowerMode::ACC_LOW_POWER && !isLowPower(lp_odr))
+    return false;
+
+  // reconfigure with everything off, then bring up what the mode needs;
+  // batched, so only the final register values go out in one burst
+  beginBatch();
+  enable(false, false);
+
+  switch (mode) {
+    case PowerMode::POWER_DOWN:
+      break;
+    case PowerMode::ACC_LOW_POWER:
+      writeAccConfig(m_accScale, lp_odr, AccLPF::ACC_LPF_DISABLED);
+      enable(false, true);
+      break;
+    case PowerMode::ACC_ONLY:
+      writeAccConfig(m_accScale, m_accOdr, m_accLpf);
+      enable(false, true);
+      break;
+    case PowerMode::ACC_GYRO:
+      writeAccConfig(m_accScale, m_accOdr, m_accLpf);
+      writeGyroConfig(m_gyroScale, m_gyroOdr, m_gyroLpf);
+      enable(true, true);
+      break;
+    case PowerMode::WAKE_ON_MOTION:
+      commit();
+      return false;  // needs a threshold: use enableWakeOnMotion()
+  }
 
-  I2Cdev::writeByte(m_i2cAddress, QMI8658C_REG_CTRL7, value, m_wire);
+  m_powerMode = mode;
+  return commit();
+}
+
+void QMI8658C::configureHsClock(bool enable) {
+  setRegister(QMI8658C_REG_CTRL7, 0b0100'0000, (enable ? 1 : 0) << 6);
 }
 
 void QMI8658C::configureAcc() {
@@ -145,6 +264,20 @@ void QMI8658C::configureAcc(AccScale scale, AccODR odr) {
 }
 
 void QMI8658C::configureAcc(AccScale scale, AccODR odr, AccLPF lpf) {
+  if (isLowPower(odr)) {
+    // accelerometer-only rate; not remembered as the active configuration
+    if (m_gyroEnabled)
+      enable(false, m_accEnabled);
+  } else {
+    m_accScale = scale;
+    m_accOdr = odr;
+    m_accLpf = lpf;
+  }
+
+  writeAccConfig(scale, odr, lpf);
+}
+
+void QMI8658C::writeAccConfig(AccScale scale, AccODR odr, AccLPF lpf) {
   // set the lsb sensitivity based on the scale
   switch (scale) {
     case AccScale::ACC_SCALE_2G:
@@ -161,24 +294,23 @@ void QMI8658C::configureAcc(AccScale scale, AccODR odr, AccLPF lpf) {
       break;
   };
 
+  // scale, ODR and lpf go out together
+  beginBatch();
+
   // set scale and ODR
-  I2Cdev::writeByte(
-      m_i2cAddress, QMI8658C_REG_CTRL2,
-      (static_cast<uint8_t>(scale) << 4) + static_cast<uint8_t>(odr), m_wire);
+  setRegister(QMI8658C_REG_CTRL2, 0xff,
+              (static_cast<uint8_t>(scale) << 4) + static_cast<uint8_t>(odr));
+  m_accLowPower = isLowPower(odr);
 
   // set lpf
-  uint8_t lpf_reg = 0;
-  uint8_t mask = 0b1111'1000;
-  I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_CTRL5, &lpf_reg,
-                   I2Cdev::readTimeout, m_wire);
-
   if (lpf == AccLPF::ACC_LPF_DISABLED)
-
-    lpf_reg = (lpf_reg & mask) | (0b000);
+    setRegister(QMI8658C_REG_CTRL5, 0b0000'0111, 0b000);
   else
-    lpf_reg = (lpf_reg & mask) | (static_cast<uint8_t>(lpf) << 1) | (0b1);
+    setRegister(QMI8658C_REG_CTRL5, 0b0000'0111,
+                (static_cast<uint8_t>(lpf) << 1) | (0b1));
 
-  I2Cdev::writeByte(m_i2cAddress, QMI8658C_REG_CTRL5, lpf_reg, m_wire);
+  commit();
+  applyCalibration();  // offsets follow the new scale
 }
 
 void QMI8658C::configureGyro() {
@@ -194,6 +326,14 @@ void QMI8658C::configureGyro(GyroScale scale, GyroODR odr) {
 }
 
 void QMI8658C::configureGyro(GyroScale scale, GyroODR odr, GyroLPF lpf) {
+  m_gyroScale = scale;
+  m_gyroOdr = odr;
+  m_gyroLpf = lpf;
+
+  writeGyroConfig(scale, odr, lpf);
+}
+
+void QMI8658C::writeGyroConfig(GyroScale scale, GyroODR odr, GyroLPF lpf) {
   // set the lsb sensitivity based on the scale
   switch (scale) {
     case GyroScale::GYRO_SCALE_16DPS:
@@ -222,24 +362,91 @@ void QMI8658C::configureGyro(GyroScale scale, GyroODR odr, GyroLPF lpf) {
       break;
   };
 
+  // scale, ODR and lpf go out together
+  beginBatch();
+
   // set scale and ODR
-  I2Cdev::writeByte(
-      m_i2cAddress, QMI8658C_REG_CTRL3,
-      (static_cast<uint8_t>(scale) << 4) + static_cast<uint8_t>(odr), m_wire);
+  setRegister(QMI8658C_REG_CTRL3, 0xff,
+              (static_cast<uint8_t>(scale) << 4) + static_cast<uint8_t>(odr));
 
   // set lpf
-  uint8_t lpf_reg = 0;
-  uint8_t mask = 0b1000'1111;
-  I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_CTRL5, &lpf_reg,
-                   I2Cdev::readTimeout, m_wire);
-
   if (lpf == GyroLPF::GYRO_LPF_DISABLED)
+    setRegister(QMI8658C_REG_CTRL5, 0b0111'0000, 0b000 << 4);
+  else
+    setRegister(QMI8658C_REG_CTRL5, 0b0111'0000,
+                (static_cast<uint8_t>(lpf) << 5) | (0b1 << 4));
+
+  commit();
+  applyCalibration();  // offsets follow the new scale
+}
+
+bool QMI8658C::enableWakeOnMotion(uint8_t threshold_mg,
+                                  WomPin pin,
+                                  WomLevel level,
+                                  AccODR odr,
+                                  uint8_t blanking_samples) {
+  if (threshold_mg == 0)
+    return false;
+
+  // 1. all sensors off, 2. accelerometer only; the scale does not matter
+  // for the threshold
+  beginBatch();
+  enable(false, false);
+  writeAccConfig(AccScale::ACC_SCALE_2G, odr, AccLPF::ACC_LPF_DISABLED);
+  if (!commit())
+    return false;
+
+  // 3. threshold, interrupt pin and its initial level, and blanking time
+  const uint8_t select =
+      static_cast<uint8_t>(pin) | static_cast<uint8_t>(level);
+  uint8_t cal[2] = {threshold_mg,
+                    static_cast<uint8_t>((select << 6) |
+                                         (blanking_samples &
+                                          QMI8658C_WOM_BLANKING_MASK))};
+  if (!I2Cdev::writeBytes(m_i2cAddress, QMI8658C_REG_CAL1_L, 2, cal, m_wire))
+    return false;
+  if (!ctrl9Command(QMI8658C_CTRL9_CMD_WRITE_WOM_SETTING))
+    return false;
+
+  // 4. route the interrupt to the pin, 5. start the accelerometer; WoM arms
+  // after the blanking samples
+  beginBatch();
+  setRegister(QMI8658C_REG_CTRL1,
+              QMI8658C_CTRL1_INT1_EN | QMI8658C_CTRL1_INT2_EN,
+              pin == WomPin::WOM_INT1 ? QMI8658C_CTRL1_INT1_EN
+                                      : QMI8658C_CTRL1_INT2_EN);
+  enable(false, true);
+  m_powerMode = PowerMode::WAKE_ON_MOTION;
+  return commit();
+}
 
-    lpf_reg = (lpf_reg & mask) | (0b000 << 4);
+bool QMI8658C::disableWakeOnMotion() {
+  beginBatch();
+  enable(false, false);
+  setRegister(QMI8658C_REG_CTRL1,
+              QMI8658C_CTRL1_INT1_EN | QMI8658C_CTRL1_INT2_EN, 0);
+  bool ok = commit();
+
+  // a threshold of 0 disables WoM; if it did not reach CAL1 the command
+  // would re-apply whatever threshold is still there
+  uint8_t cal[2] = {0, 0};
+  if (I2Cdev::writeBytes(m_i2cAddress, QMI8658C_REG_CAL1_L, 2, cal, m_wire))
+    ok &= ctrl9Command(QMI8658C_CTRL9_CMD_WRITE_WOM_SETTING);
   else
-    lpf_reg = (lpf_reg & mask) | (static_cast<uint8_t>(lpf) << 5) | (0b1 << 4);
+    ok = false;
 
-  I2Cdev::writeByte(m_i2cAddress, QMI8658C_REG_CTRL5, lpf_reg, m_wire);
+  m_powerMode = PowerMode::POWER_DOWN;
+  return ok;
+}
+
+bool QMI8658C::readWakeOnMotion(bool* triggered) {
+  uint8_t status = 0;
+  if (I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_STATUS1, &status,
+                       I2Cdev::readTimeout, m_wire) <= 0)
+    return false;
+
+  *triggered = status & QMI8658C_STATUS1_WOM;
+  return true;
 }
 
 bool QMI8658C::readTemperature(float* degrees) {
@@ -254,46 +461,229 @@ bool QMI8658C::readTemperature(float* degrees) {
   return true;
 }
 
-bool QMI8658C::readAccelerometer(float* ax, float* ay, float* az) {
+bool QMI8658C::readAccelerometerRaw(int16_t* xyz) {
   uint8_t result[QMI8658C_BUFSIZE_REG_ACC_XYZ] = {};
 
+  if (!m_accEnabled)
+    return false;
+
   if (i2cReadRegisterBlock(QMI8658C_REG_AX_L, QMI8658C_BUFSIZE_REG_ACC_XYZ,
                            result) != QMI8658C_BUFSIZE_REG_ACC_XYZ)
     return false;
 
-  // combine h/l byte to uint16_t and divide by LSB sensitivy to get the actual
-  // value
-  *ax = static_cast<int16_t>(static_cast<uint16_t>(result[1] << 8) |
-                             (result[0])) /
-        m_accelerometerLsbSensitivity;
-  *ay = static_cast<int16_t>(static_cast<uint16_t>(result[3] << 8) |
-                             (result[2])) /
-        m_accelerometerLsbSensitivity;
-  *az = static_cast<int16_t>(static_cast<uint16_t>(result[5] << 8) |
-                             (result[4])) /
-        m_accelerometerLsbSensitivity;
+  // combine h/l byte to int16_t
+  for (int i = 0; i < 3; i++)
+    xyz[i] = static_cast<int16_t>(
+        static_cast<uint16_t>(result[2 * i + 1] << 8) | result[2 * i]);
 
   return true;
 }
 
-bool QMI8658C::readGyroscope(float* gx, float* gy, float* gz) {
+bool QMI8658C::readGyroscopeRaw(int16_t* xyz) {
   uint8_t result[QMI8658C_BUFSIZE_REG_GYRO_XYZ] = {};
 
+  // off on the device, or still inside its turn-on time: no valid output
+  const uint8_t ctrl7 = m_reg[QMI8658C_REG_CTRL7 - QMI8658C_REG_CTRL1];
+  if (!(ctrl7 & QMI8658C_CTRL7_GYRO_EN) ||
+      millis() - m_gyroOnMs < QMI8658C_GYRO_STARTUP_MS)
+    return false;
+
   if (i2cReadRegisterBlock(QMI8658C_REG_GX_L, QMI8658C_BUFSIZE_REG_GYRO_XYZ,
                            result) != QMI8658C_BUFSIZE_REG_GYRO_XYZ)
     return false;
 
-  // combine h/l byte to uint16_t and divide by LSB sensitivy to get the actual
-  // value
-  *gx = static_cast<int16_t>(static_cast<uint16_t>(result[1] << 8) |
-                             (result[0])) /
-        m_gyroscopeLsbSensitivity;
-  *gy = static_cast<int16_t>(static_cast<uint16_t>(result[3] << 8) |
-                             (result[2])) /
-        m_gyroscopeLsbSensitivity;
-  *gz = static_cast<int16_t>(static_cast<uint16_t>(result[5] << 8) |
-                             (result[4])) /
-        m_gyroscopeLsbSensitivity;
+  // combine h/l byte to int16_t
+  for (int i = 0; i < 3; i++)
+    xyz[i] = static_cast<int16_t>(
+        static_cast<uint16_t>(result[2 * i + 1] << 8) | result[2 * i]);
+
+  return true;
+}
+
+bool QMI8658C::readAccelerometerQ16(int32_t* ax, int32_t* ay, int32_t* az) {
+  int16_t raw[3];
+
+  if (!readAccelerometerRaw(raw))
+    return false;
+
+  // (counts - offset) · gain · 65536 / LSB; the LSB is 16384 >> shift, so
+  // the factor is gain(Q14) << shift and the product is shifted down by 12
+  int32_t* out[3] = {ax, ay, az};
+  for (int i = 0; i < 3; i++)
+    *out[i] = static_cast<int32_t>(
+        (static_cast<int64_t>(raw[i] - m_accOff[i]) * m_accK[i]) >> 12);
+
+  return true;
+}
+
+bool QMI8658C::readAccelerometer(float* ax, float* ay, float* az) {
+  int32_t q[3];
+
+  if (!readAccelerometerQ16(&q[0], &q[1], &q[2]))
+    return false;
+
+  *ax = q[0] / 65536.0f;
+  *ay = q[1] / 65536.0f;
+  *az = q[2] / 65536.0f;
+
+  return true;
+}
+
+bool QMI8658C::readGyroscope(float* gx, float* gy, float* gz) {
+  int16_t raw[3];
+
+  if (!readGyroscopeRaw(raw))
+    return false;
+
+  // remove the offset and divide by LSB sensitivy to get the actual value
+  *gx = (raw[0] - m_gyroOff[0]) / m_gyroscopeLsbSensitivity;
+  *gy = (raw[1] - m_gyroOff[1]) / m_gyroscopeLsbSensitivity;
+  *gz = (raw[2] - m_gyroOff[2]) / m_gyroscopeLsbSensitivity;
+
+  return true;
+}
+
+bool QMI8658C::readGyroscopeQ16(int32_t* gx, int32_t* gy, int32_t* gz) {
+  int16_t raw[3];
+
+  if (!readGyroscopeRaw(raw))
+    return false;
+
+  // 65536 / LSB with LSB = 2048 >> shift
+  const int shift = 5 + gyroScaleShift();
+  *gx = static_cast<int32_t>(raw[0] - m_gyroOff[0]) << shift;
+  *gy = static_cast<int32_t>(raw[1] - m_gyroOff[1]) << shift;
+  *gz = static_cast<int32_t>(raw[2] - m_gyroOff[2]) << shift;
+
+  return true;
+}
+
+// ------------------ AttitudeEngine ------------------
+
+void QMI8658C::enableAttitudeEngine(AeODR odr) {
+  beginBatch();
+  setRegister(QMI8658C_REG_CTRL6, 0b0000'0111, static_cast<uint8_t>(odr));
+  setRegister(QMI8658C_REG_CTRL7, QMI8658C_CTRL7_AE_EN, QMI8658C_CTRL7_AE_EN);
+  commit();
+}
+
+void QMI8658C::disableAttitudeEngine() {
+  setRegister(QMI8658C_REG_CTRL7, QMI8658C_CTRL7_AE_EN, 0);
+}
+
+bool QMI8658C::readRotationIncrement(int16_t* dq) {
+  uint8_t result[QMI8658C_BUFSIZE_REG_DQ] = {};
+
+  const uint8_t ctrl7 = m_reg[QMI8658C_REG_CTRL7 - QMI8658C_REG_CTRL1];
+  if (!(ctrl7 & QMI8658C_CTRL7_AE_EN) || !m_accEnabled || !m_gyroEnabled)
+    return false;
+
+  // the registers keep the last increment: only a new one counts (reading
+  // STATUS0 clears the flag)
+  uint8_t status = 0;
+  if (I2Cdev::readByte(m_i2cAddress, QMI8658C_REG_STATUS0, &status,
+                       I2Cdev::readTimeout, m_wire) <= 0 ||
+      !(status & QMI8658C_STATUS0_AE_DA))
+    return false;
+
+  if (i2cReadRegisterBlock(QMI8658C_REG_DQW_L, QMI8658C_BUFSIZE_REG_DQ,
+                           result) != QMI8658C_BUFSIZE_REG_DQ)
+    return false;
+
+  for (int i = 0; i < 4; i++)
+    dq[i] = static_cast<int16_t>(
+        static_cast<uint16_t>(result[2 * i + 1] << 8) | result[2 * i]);
+
+  return true;
+}
+
+// ------------------ calibration ------------------
+
+static int16_t clampI16(int32_t v) {
+  return v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v);
+}
+
+void QMI8658C::applyCalibration() {
+  const int acc_shift = accScaleShift();
+  const int gyro_shift = gyroScaleShift();
+
+  for (int i = 0; i < 3; i++) {
+    m_accOff[i] = m_cal.accOffset[i] / (1 << acc_shift);
+    m_gyroOff[i] = m_cal.gyroOffset[i] / (1 << gyro_shift);
+    m_accK[i] = static_cast<int32_t>(m_cal.accGain[i]) << acc_shift;
+  }
+}
+
+void QMI8658C::setCalibration(const Calibration& cal) {
+  m_cal = cal;
+  applyCalibration();
+}
+
+void QMI8658C::clearCalibration() {
+  setCalibration({{0, 0, 0},
+                  {0, 0, 0},
+                  {QMI8658C_CAL_GAIN_ONE, QMI8658C_CAL_GAIN_ONE,
+                   QMI8658C_CAL_GAIN_ONE}});
+}
+
+bool QMI8658C::calibrate(uint16_t samples) {
+  // low-power rates have no gyro, and the gyro needs its turn-on time
+  if (!m_accEnabled || !m_gyroEnabled || m_accLowPower || samples == 0)
+    return false;
+
+  int32_t acc_sum[3] = {}, gyro_sum[3] = {};
+  int16_t acc_min[3] = {INT16_MAX, INT16_MAX, INT16_MAX};
+  int16_t acc_max[3] = {INT16_MIN, INT16_MIN, INT16_MIN};
+
+  const uint32_t start = millis();
+  const uint32_t timeout =
+      QMI8658C_GYRO_STARTUP_MS + 2u * samples * (QMI8658C_CAL_INTERVAL_MS + 1);
+  uint16_t n = 0;
+  while (n < samples) {
+    if (millis() - start > timeout)
+      return false;
+
+    int16_t acc[3], gyro[3];
+    if (!readAccelerometerRaw(acc) || !readGyroscopeRaw(gyro)) {
+      delay(1);
+      continue;
+    }
+    for (int i = 0; i < 3; i++) {
+      acc_sum[i] += acc[i];
+      gyro_sum[i] += gyro[i];
+      acc_min[i] = acc[i] < acc_min[i] ? acc[i] : acc_min[i];
+      acc_max[i] = acc[i] > acc_max[i] ? acc[i] : acc_max[i];
+    }
+    n++;
+    delay(QMI8658C_CAL_INTERVAL_MS);
+  }
+
+  // the device has to rest: any axis moving more than the spread limit
+  const int32_t lsb = static_cast<int32_t>(m_accelerometerLsbSensitivity);
+  const int32_t max_spread = lsb * QMI8658C_CAL_MAX_SPREAD_MG / 1000;
+  for (int i = 0; i < 3; i++)
+    if (acc_max[i] - acc_min[i] > max_spread)
+      return false;
+
+  // level: z carries gravity, |z| has to be within ±0.5 g of 1 g; the z
+  // deviation is taken as gain error, x and y as offsets
+  const int32_t acc_z = acc_sum[2] / n;
+  const int32_t abs_z = acc_z < 0 ? -acc_z : acc_z;
+  if (abs_z < lsb / 2 || abs_z > lsb * 3 / 2)
+    return false;
+
+  const int acc_shift = accScaleShift();
+  const int gyro_shift = gyroScaleShift();
+
+  Calibration cal = m_cal;
+  for (int i = 0; i < 3; i++)
+    cal.gyroOffset[i] = clampI16((gyro_sum[i] / n) * (1 << gyro_shift));
+  cal.accOffset[0] = clampI16((acc_sum[0] / n) * (1 << acc_shift));
+  cal.accOffset[1] = clampI16((acc_sum[1] / n) * (1 << acc_shift));
+  cal.accOffset[2] = 0;
+  cal.accGain[0] = cal.accGain[1] = QMI8658C_CAL_GAIN_ONE;
+  cal.accGain[2] = static_cast<uint16_t>(QMI8658C_CAL_GAIN_ONE * lsb / abs_z);
 
+  setCalibration(cal);
   return true;
 }
@@ -3,6 +3,8 @@
 #include <Arduino.h>
 #include <Wire.h>
 
+#include "imu_source.hpp"
+
 // constants
 
 #define QMI8658C_I2C_ADDRESS_DEFAULT \
@@ -11,6 +13,13 @@
   (0x6b)  // QMI8658C I2C device address when SA0 is pulled up
 
 #define QMI8658C_TEMP_LSB_SENSITIVITY (256.0f)
+#define QMI8658C_GYRO_STARTUP_MS 60  // gyro turn-on time, output invalid before
+
+// calibration
+#define QMI8658C_CAL_GAIN_ONE 16384    // accelerometer gain 1.0 (Q14)
+#define QMI8658C_CAL_SAMPLES 64        // default sample count of calibrate()
+#define QMI8658C_CAL_INTERVAL_MS 4     // pause between calibration samples
+#define QMI8658C_CAL_MAX_SPREAD_MG 50  // acc min/max spread: device moved
 
 // settings registers (RW)
 
@@ -30,10 +39,30 @@
 #define QMI8658C_REG_CTRL8 0x09  // Reserved: Not Used
 #define QMI8658C_REG_CTRL9 0x0a  // Host Commands
 
+#define QMI8658C_CTRL1_ADDR_AI (1 << 6)  // register address auto increment
+#define QMI8658C_CTRL1_INT1_EN (1 << 3)  // INT1 pin output enable
+#define QMI8658C_CTRL1_INT2_EN (1 << 4)  // INT2 pin output enable
+#define QMI8658C_CTRL7_GYRO_EN (1 << 1)  // gyroscope enable
+#define QMI8658C_CTRL7_AE_EN (1 << 3)    // AttitudeEngine enable
+
+// CTRL1..CTRL8 are cached in the driver (CTRL9 is a command register)
+#define QMI8658C_SHADOW_COUNT (QMI8658C_REG_CTRL8 - QMI8658C_REG_CTRL1 + 1)
+
+// CTRL9 host commands
+
+#define QMI8658C_CTRL9_CMD_ACK 0x00
+#define QMI8658C_CTRL9_CMD_WRITE_WOM_SETTING 0x08
+#define QMI8658C_CTRL9_TIMEOUT_MS 10
+
 // status registers (R)
 
-#define QMI8658C_REG_STATUS0 0x46
-#define QMI8658C_REG_STATUS1 0x47
+#define QMI8658C_REG_STATUS_INT 0x2d
+#define QMI8658C_REG_STATUS0 0x2e
+#define QMI8658C_REG_STATUS1 0x2f
+
+#define QMI8658C_STATUS_INT_CMD_DONE (1 << 7)  // CTRL9 command executed
+#define QMI8658C_STATUS0_AE_DA (1 << 3)        // new AttitudeEngine sample
+#define QMI8658C_STATUS1_WOM (1 << 2)          // Wake on Motion event
 
 // calibration registers (RW)
 
@@ -46,6 +75,16 @@
 #define QMI8658C_REG_CAL4_L 0x11
 #define QMI8658C_REG_CAL4_H 0x12
 
+// CAL1_H of CTRL9 WRITE_WOM_SETTING: bits 7:6 select the interrupt pin and
+// its initial level, bits 5:0 the blanking time in accelerometer samples
+#define QMI8658C_WOM_BLANKING_MASK 0b0011'1111
+
+// AttitudeEngine data registers (R)
+
+#define QMI8658C_REG_DQW_L 0x49  // quaternion increment w, x, y, z (Q14)
+#define QMI8658C_REG_DVX_L 0x51  // velocity increment x, y, z
+#define QMI8658C_BUFSIZE_REG_DQ (QMI8658C_REG_DVX_L - QMI8658C_REG_DQW_L)
+
 // temperature sensor data registers (R)
 
 #define QMI8658C_REG_TEMP_L 0x33
@@ -77,14 +116,36 @@
 /**
  * QMI8658C 6-Axis IMU I2C device driver.
  *
- * Open ToDos:
- * - calibration. documentation page 37-39 describe the process.
- * - figure out how the accelerometer low power modes work.
- *   it seems that when waiting for the INT2 interrupt, it only happens once in
- *   this mode. also, there were some weird quirks resulting in the temp sensor
- *   reading about 80 degrees.
- *   also, maybe just don't allow them.
- * - have a look into the AttitudeEngine stuff and maybe make it work
+ * Power modes (`setPowerMode()`):
+ *
+ *   POWER_DOWN       both sensors off
+ *   ACC_LOW_POWER    accelerometer only, at one of the ACC_ODR_LP_* rates
+ *   ACC_ONLY         accelerometer only, at the active rate
+ *   ACC_GYRO         both sensors at the active rates (default after begin)
+ *   WAKE_ON_MOTION   entered with `enableWakeOnMotion()`
+ *
+ * The "active" configuration is whatever was last passed to `configureAcc()`
+ * (normal rates only) and `configureGyro()`; every mode change re-applies it,
+ * so leaving a low-power mode needs no reconfiguration by the caller.
+ *
+ * The low-power accelerometer rates only exist in accelerometer-only mode.
+ * With the gyroscope running the accelerometer follows the gyro rate, which
+ * is where the odd readings (e.g. ~80 °C temperature) came from; `enable()`
+ * and `configureAcc()` therefore never combine the two. In Wake on Motion
+ * mode the INT pin toggles on every event instead of pulsing, so wait for
+ * an edge, not a level.
+ *
+ * Samples are corrected by a `Calibration` (offsets and accelerometer gain)
+ * before they are returned; `readAccelerometerQ16()` does this in integer
+ * arithmetic only. `calibrate()` measures the correction with the device
+ * resting level, the application is responsible for persisting it.
+ *
+ * The AttitudeEngine (`enableAttitudeEngine()`) fuses both sensors on the
+ * chip and outputs one quaternion increment per AE sample. The registers
+ * hold only the latest increment: `readRotationIncrement()` returns it once
+ * (STATUS0 data ready) and fails until the next sample. Poll at more than
+ * twice the AE rate so that no increment is overwritten unread; a consumer
+ * can then tell a missed sample from the time between increments.
  *
  * For reference, see the following URLs:
  *
@@ -96,7 +157,7 @@
  *
  * @author Philipp Molitor <philipp@molitor-consulting.com>
  */
-class QMI8658C {
+class QMI8658C : public ImuSource {
  private:
   TwoWire* m_wire;
   uint8_t m_i2cAddress;
@@ -107,6 +168,7 @@ class QMI8658C {
   float m_gyroscopeLsbSensitivity;
 
   bool detectDevice();
+  bool ctrl9Command(uint8_t command);
   bool i2cReadU16(uint8_t register_l, uint8_t register_h, uint16_t* buffer);
   uint8_t i2cReadRegisterBlock(uint8_t start_register,
                                uint8_t length,
@@ -147,11 +209,8 @@ class QMI8658C {
     ACC_ODR_31_25HZ = 0b1000,
 
     /*
-     * low power modes
-     * disabled for now, as they behave weirdly in a normal IMU setup
-     * with gyro+acc enabled.
+     * low power modes: accelerometer-only, the gyroscope must be disabled
      */
-    /*
     /// 128Hz, low-power mode, 100% duty cycle
     ACC_ODR_LP_128HZ = 0b1100,
     /// 21Hz, low-power mode, 58% duty cycle
@@ -160,7 +219,6 @@ class QMI8658C {
     ACC_ODR_LP_11HZ = 0b1110,
     /// 3Hz, low-power mode, 8.5% duty cycle
     ACC_ODR_LP_3HZ = 0b1111,
-    */
   };
 
   /// Accelerometer low pass filter
@@ -233,15 +291,77 @@ class QMI8658C {
     GYRO_LPF_DISABLED = 0b1111'1111,
   };
 
+  /// Sensor power state, see the table above
+  enum class PowerMode : uint8_t {
+    POWER_DOWN,
+    ACC_LOW_POWER,
+    ACC_ONLY,
+    ACC_GYRO,
+    WAKE_ON_MOTION,
+  };
+
+  static bool isLowPower(AccODR odr) {
+    return static_cast<uint8_t>(odr) >= 0b1100;
+  }
+
   bool begin();
   bool begin(TwoWire* wire);
   bool begin(uint8_t device_address);
   bool begin(TwoWire* wire, uint8_t device_address);
   bool deviceInfo(uint8_t* device_id, uint8_t* device_revision);
 
-  // void calibrate();
-  // void calibrate(int samples);
+  /// AttitudeEngine output data rate in Hz
+  enum class AeODR : uint8_t {
+    AE_ODR_1HZ = 0b000,
+    AE_ODR_2HZ = 0b001,
+    AE_ODR_4HZ = 0b010,
+    AE_ODR_8HZ = 0b011,
+    AE_ODR_16HZ = 0b100,
+    AE_ODR_32HZ = 0b101,
+    AE_ODR_64HZ = 0b110,
+  };
+
+  /// Offset/scale correction applied to every sample. Offsets are kept at
+  /// the finest scale (±2 g, ±16 dps) so they stay valid when the scale
+  /// changes. Plain data: store and restore it as a whole.
+  struct Calibration {
+    int16_t accOffset[3];   // 1/16384 g
+    int16_t gyroOffset[3];  // 1/2048 dps
+    uint16_t accGain[3];    // Q14, `QMI8658C_CAL_GAIN_ONE` = 1.0
+  };
+
+  /// @brief measures the gyroscope offsets, the x/y accelerometer offsets and
+  /// the z accelerometer gain. The device has to rest level (z axis vertical)
+  /// with both sensors running at a normal rate; takes about
+  /// `samples * QMI8658C_CAL_INTERVAL_MS` ms.
+  /// @return `false` if the device moved, was not level or reads failed; the
+  /// previous calibration is kept then
+  bool calibrate(uint16_t samples = QMI8658C_CAL_SAMPLES);
+  const Calibration& calibration() const { return m_cal; }
+  void setCalibration(const Calibration& cal);
+  /// @brief back to zero offsets and unit gain
+  void clearCalibration();
+
+  /// @brief switches the sensors on/off. Enabling the gyroscope while the
+  /// accelerometer runs at a low-power rate restores the active rate first;
+  /// gyro reads fail for `QMI8658C_GYRO_STARTUP_MS` after the commit that
+  /// actually switches it on (an off/on pair inside a batch does not).
   void enable(bool enable_gyro, bool enable_acc);
+  /// @brief defers control register writes until the matching `commit()`;
+  /// batches nest. Wake on Motion changes are always written immediately.
+  void beginBatch() { m_batch++; }
+  /// @brief writes the pending control register changes: nothing if no
+  /// register changed, otherwise one auto-increment burst (preceded by a
+  /// single CTRL7 write when sensors are being switched off)
+  /// @return `false` if a bus write failed; the change stays pending
+  bool commit();
+
+  /// @brief moves to `mode`, re-applying the active configuration
+  /// @param lp_odr rate for ACC_LOW_POWER, must be one of ACC_ODR_LP_*
+  /// @return `false` if `lp_odr` is not a low-power rate
+  bool setPowerMode(PowerMode mode,
+                    AccODR lp_odr = AccODR::ACC_ODR_LP_21HZ);
+  PowerMode powerMode() const { return m_powerMode; }
   void configureHsClock(bool enable);
   void configureAcc();
   void configureAcc(AccScale scale);
@@ -252,6 +372,40 @@ class QMI8658C {
   void configureGyro(GyroScale scale, GyroODR odr);
   void configureGyro(GyroScale scale, GyroODR odr, GyroLPF lpf);
 
+  /// Interrupt pin used by Wake on Motion (CAL1_H bit 7)
+  enum class WomPin : uint8_t {
+    WOM_INT1 = 0b10,
+    WOM_INT2 = 0b00,
+  };
+  /// Level of the Wake on Motion pin when armed (CAL1_H bit 6)
+  enum class WomLevel : uint8_t {
+    WOM_INITIAL_LOW = 0b00,
+    WOM_INITIAL_HIGH = 0b01,
+  };
+
+  /// @brief puts the device into Wake on Motion mode: gyroscope off,
+  /// accelerometer only, and the selected INT pin starts at `level` and
+  /// toggles whenever any axis changes by more than `threshold_mg`. With the
+  /// default initial low level the first motion produces a rising edge.
+  /// @param threshold_mg motion threshold in mg (1 mg/LSB, 0 is invalid)
+  /// @param pin interrupt pin to signal on
+  /// @param level level of `pin` until the first motion
+  /// @param odr accelerometer rate while waiting; lower saves power but
+  /// increases the detection latency
+  /// @param blanking_samples accelerometer samples ignored after arming
+  /// @return `false` if a bus write failed or the device did not
+  /// acknowledge the command
+  bool enableWakeOnMotion(uint8_t threshold_mg,
+                          WomPin pin = WomPin::WOM_INT1,
+                          WomLevel level = WomLevel::WOM_INITIAL_LOW,
+                          AccODR odr = AccODR::ACC_ODR_LP_21HZ,
+                          uint8_t blanking_samples = 4);
+  /// @brief leaves Wake on Motion mode and releases the INT pin; the device
+  /// is left in POWER_DOWN until `setPowerMode()` is called
+  bool disableWakeOnMotion();
+  /// @brief reads and clears the Wake on Motion event flag
+  bool readWakeOnMotion(bool* triggered);
+
   /// @brief reads out the internal temperature sensor
   /// @param degrees
   /// @return `true` if the read operation was successful
@@ -261,11 +415,77 @@ class QMI8658C {
   /// @param ay y-axis value in g
   /// @param az z-axis value in g
   /// @return `true` on success, `false` if the read operation failed
-  bool readAccelerometer(float* ax, float* ay, float* az);
+  bool readAccelerometer(float* ax, float* ay, float* az) override;
   /// @brief reads out the current gyroscope values
   /// @param gx x-axis rotation in dps (degrees per second)
   /// @param gy y-axis rotation in dps (degrees per second)
   /// @param gz z-axis rotation in dps (degrees per second)
   /// @return `true` on success, `false` if the read operation failed
-  bool readGyroscope(float* gx, float* gy, float* gz);
+  bool readGyroscope(float* gx, float* gy, float* gz) override;
+  /// @brief reads the calibrated accelerometer values in Q16.16 g without
+  /// any floating point work
+  bool readAccelerometerQ16(int32_t* ax, int32_t* ay, int32_t* az) override;
+  /// @brief reads the calibrated gyroscope values in Q16.16 dps without any
+  /// floating point work
+  bool readGyroscopeQ16(int32_t* gx, int32_t* gy, int32_t* gz) override;
+  /// @brief starts the AttitudeEngine; needs both sensors running
+  /// (`PowerMode::ACC_GYRO`)
+  void enableAttitudeEngine(AeODR odr = AeODR::AE_ODR_32HZ);
+  void disableAttitudeEngine();
+  /// @brief reads the latest AttitudeEngine quaternion increment (w, x, y, z)
+  /// in Q14, once per AE sample
+  /// @return `false` if the AttitudeEngine is off, there is no new sample
+  /// since the last read, or the read failed
+  bool readRotationIncrement(int16_t* dq) override;
+  /// @brief reads the uncorrected accelerometer output registers (x, y, z)
+  bool readAccelerometerRaw(int16_t* xyz);
+  /// @brief reads the uncorrected gyroscope output registers (x, y, z)
+  bool readGyroscopeRaw(int16_t* xyz);
+
+ private:
+  // active configuration, re-applied on every power mode change
+  AccScale m_accScale = AccScale::ACC_SCALE_2G;
+  AccODR m_accOdr = AccODR::ACC_ODR_8000HZ;
+  AccLPF m_accLpf = AccLPF::ACC_LPF_DISABLED;
+  GyroScale m_gyroScale = GyroScale::GYRO_SCALE_512DPS;
+  GyroODR m_gyroOdr = GyroODR::GYRO_ODR_8000HZ;
+  GyroLPF m_gyroLpf = GyroLPF::GYRO_LPF_DISABLED;
+
+  PowerMode m_powerMode = PowerMode::POWER_DOWN;
+  bool m_accEnabled = false;
+  bool m_gyroEnabled = false;
+  bool m_accLowPower = false;  // CTRL2 currently holds an LP rate
+  uint32_t m_gyroOnMs = 0;
+
+  // calibration, and its form at the current scales: offsets in counts and
+  // acc factors counts → Q16 g (gain << scale shift, see applyCalibration)
+  Calibration m_cal = {{0, 0, 0},
+                       {0, 0, 0},
+                       {QMI8658C_CAL_GAIN_ONE, QMI8658C_CAL_GAIN_ONE,
+                        QMI8658C_CAL_GAIN_ONE}};
+  int16_t m_accOff[3] = {};
+  int16_t m_gyroOff[3] = {};
+  int32_t m_accK[3] = {};
+
+  void applyCalibration();
+  // the scale fields of CTRL2/CTRL3 are the log2 steps away from the finest
+  // scale (±2 g, ±16 dps) the calibration is kept at
+  int accScaleShift() const {
+    return (m_next[QMI8658C_REG_CTRL2 - QMI8658C_REG_CTRL1] >> 4) & 0b011;
+  }
+  int gyroScaleShift() const {
+    return (m_next[QMI8658C_REG_CTRL3 - QMI8658C_REG_CTRL1] >> 4) & 0b111;
+  }
+
+  // control register shadows: what the device holds / what it should hold
+  uint8_t m_reg[QMI8658C_SHADOW_COUNT] = {};
+  uint8_t m_next[QMI8658C_SHADOW_COUNT] = {};
+  uint8_t m_batch = 0;
+
+  void loadShadow();
+  void setRegister(uint8_t address, uint8_t mask, uint8_t value);
+  bool flushShadow();
+
+  void writeAccConfig(AccScale scale, AccODR odr, AccLPF lpf);
+  void writeGyroConfig(GyroScale scale, GyroODR odr, GyroLPF lpf);
 };
@@ -3,41 +3,81 @@
 #include "battery.hpp"
 
 Battery::Battery() {
-  m_percentageLambda = BATTERY_LAMBDA_PERCENTAGE_LIPO;
+  updateScale();
 }
 
 void Battery::begin(pin_size_t adc_pin) {
   m_adcPin = adc_pin;
+  analogReadResolution(12);
+  m_mvQ8 = 0;
 }
 
 void Battery::setVoltageRef(float voltage) {
   m_voltageRef = voltage;
+  updateScale();
 }
 
 void Battery::setVoltageDivider(float divisor) {
   if (divisor <= 0.0f)
     return;
   m_voltageDivider = divisor;
+  updateScale();
 }
 
-void Battery::setPercentageCalculator(battery_percentage_lambda_t calculator) {
-  m_percentageLambda = calculator;
+void Battery::setDischargeCurve(const BatteryCurvePoint* curve, int count) {
+  if (!curve || count < 2)
+    return;
+  m_curve = curve;
+  m_curveCount = count;
+}
+
+void Battery::updateScale() {
+  // map the sum of the adc values to mV by reference and voltage divider
+  m_mvPerCountQ16 = static_cast<uint32_t>(
+      m_voltageRef * 1000.0f / m_voltageDivider / 4095.0f /
+          BATTERY_OVERSAMPLE * 65536.0f +
+      0.5f);
 }
 
 void Battery::update() {
-  analogReadResolution(12);
-  m_adcValue = analogRead(m_adcPin);
+  uint32_t sum = 0;
+  for (int i = 0; i < BATTERY_OVERSAMPLE; i++)
+    sum += analogRead(m_adcPin);
+  const uint32_t mvQ8 = static_cast<uint32_t>(
+      (static_cast<uint64_t>(sum) * m_mvPerCountQ16) >> 8);
+
+  if (m_mvQ8 == 0)
+    m_mvQ8 = mvQ8;
+  else
+    m_mvQ8 += (static_cast<int32_t>(mvQ8 - m_mvQ8)) >> BATTERY_IIR_SHIFT;
+}
+
+uint8_t Battery::percent() const {
+  const uint16_t mv = millivolts();
+  if (mv <= m_curve[0].mv)
+    return m_curve[0].percent;
+  for (int i = 1; i < m_curveCount; i++) {
+    const BatteryCurvePoint& hi = m_curve[i];
+    if (mv < hi.mv) {
+      const BatteryCurvePoint& lo = m_curve[i - 1];
+      return lo.percent + (mv - lo.mv) * (hi.percent - lo.percent) /
+                              (hi.mv - lo.mv);
+    }
+  }
+  return m_curve[m_curveCount - 1].percent;
 }
 
 void Battery::voltage(float* value) {
-  // map adc value to voltage by reference and divide by voltage divider
-  *value =
-      mapf(m_adcValue, 0.0f, 4095.0f, 0.0f, m_voltageRef) / m_voltageDivider;
+  *value = millivolts() / 1000.0f;
 }
 
 void Battery::percentage(float* value) {
-  float v = 0.0f;
-  voltage(&v);
+  *value = percent() / 100.0f;
+}
 
-  *value = constrain(m_percentageLambda(v), 0.0f, 1.0f);
+uint32_t Battery::runtimeMinutes(float draw_ma) const {
+  if (draw_ma <= 0.0f)
+    return 0;
+  return static_cast<uint32_t>(BATTERY_CAPACITY_MAH * percent() / 100.0f /
+                               draw_ma * 60.0f);
 }
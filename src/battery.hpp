@@ -1,33 +1,43 @@
 #pragma once
 
 #include <Arduino.h>
-#include <functional>
 
-inline float mapf(float x,
-                  float in_min,
-                  float in_max,
-                  float out_min,
-                  float out_max) {
-  return constrain(
-      (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min, out_min,
-      out_max);
-}
+/// Sampling
+#define BATTERY_OVERSAMPLE 16  // ADC reads averaged per update
+#define BATTERY_IIR_SHIFT 3    // voltage low pass: weight 1/8 per update
 
-#define BATTERY_LAMBDA_PERCENTAGE_LIPO \
-  [](float v) { return mapf(v, 3.5f, 4.2f, 0.0f, 1.0f); }
-#define BATTERY_LAMBDA_PERCENTAGE_LIION \
-  [](float v) { return mapf(v, 3.0f, 4.2f, 0.0f, 1.0f); }
+#define BATTERY_CAPACITY_MAH 500
 
-typedef std::function<float(float voltage)> battery_percentage_lambda_t;
+/// One point of a discharge curve: open circuit voltage → state of charge
+struct BatteryCurvePoint {
+  uint16_t mv;
+  uint8_t percent;
+};
+
+/// LiPo pouch cell under very low draw, ascending
+static const BatteryCurvePoint battery_curve_lipo[] = {
+    {3300, 0},  {3500, 5},  {3600, 10}, {3700, 25}, {3750, 40},  {3790, 50},
+    {3830, 60}, {3870, 70}, {3950, 80}, {4060, 90}, {4200, 100},
+};
+/// Li-ion cylindrical cell, discharged down to 3.0 V, ascending
+static const BatteryCurvePoint battery_curve_liion[] = {
+    {3000, 0},  {3300, 5},  {3500, 12}, {3600, 22}, {3700, 40},
+    {3800, 58}, {3900, 73}, {4000, 85}, {4100, 94}, {4200, 100},
+};
 
 class Battery {
  private:
   pin_size_t m_adcPin;
-  unsigned int m_adcValue = 0;
+  uint32_t m_mvQ8 = 0;  // filtered voltage, mV Q8; 0 = no sample yet
 
   float m_voltageRef = 3.30f;
   float m_voltageDivider = 0.5;
-  battery_percentage_lambda_t m_percentageLambda;
+  uint32_t m_mvPerCountQ16 = 0;  // sum of BATTERY_OVERSAMPLE reads → mV
+
+  const BatteryCurvePoint* m_curve = battery_curve_lipo;
+  int m_curveCount = sizeof(battery_curve_lipo) / sizeof(battery_curve_lipo[0]);
+
+  void updateScale();
 
  public:
   Battery();
@@ -36,17 +46,30 @@ class Battery {
 
   void setVoltageRef(float voltage);
   void setVoltageDivider(float divisor);
-  void setPercentageCalculator(battery_percentage_lambda_t calculator);
+  /// piecewise linear discharge curve, ascending in voltage; the table is
+  /// not copied
+  void setDischargeCurve(const BatteryCurvePoint* curve, int count);
 
-  /// read out the ADC pin of the voltage sensor
+  /// read out the ADC pin of the voltage sensor (BATTERY_OVERSAMPLE reads)
+  /// and feed the low pass filter; the first update sets the filter directly
   void update();
+  /// forget the filtered voltage, e.g. after a long sleep
+  void reset() { m_mvQ8 = 0; }
+
+  /// filtered power source voltage in mV
+  uint16_t millivolts() const { return m_mvQ8 >> 8; }
+  /// state of charge from the discharge curve, 0..100
+  uint8_t percent() const;
+
   /// calculate the power source voltage in relation to the voltage reference,
   /// divided by the voltage divider.
-  /// invoke `Battery::read()` beforehand so the value is up to date.
+  /// invoke `Battery::update()` beforehand so the value is up to date.
   void voltage(float* value);
-  /// calculate the battery capacity percentage based on the percentage
-  /// calculator. the default profile estimates a LiPo battery under very low
-  /// amp draw.
-  /// invoke `Battery::read()` beforehand so the value is up to date.
+  /// calculate the battery capacity percentage from the discharge curve.
+  /// the default curve estimates a LiPo battery under very low amp draw.
+  /// invoke `Battery::update()` beforehand so the value is up to date.
   void percentage(float* value);
+
+  /// remaining runtime in minutes at `draw_ma` (e.g. from an EnergyMeter)
+  uint32_t runtimeMinutes(float draw_ma) const;
 };
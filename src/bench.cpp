@@ -0,0 +1,81 @@
+/******************************************************************
+ *  bench.cpp  ――  模拟引擎基准 (pio run -e bench)
+ *    FLIP vs MLS-MPM vs PB-SPH：100 / 500 / 1000 粒子
+ *    · 每粒子耗时（µs）
+ *    · 稳定性：静置后的平均 / 最大速度（越小越稳），越界粒子数
+ ******************************************************************/
+#include <Arduino.h>
+#include "MpmSimulation.hpp"
+#include "ParticleSimulation.hpp"
+#include "SphSimulation.hpp"
+
+/* ────── 基准参数 ──────────────────────────── */
+static constexpr float BENCH_DT = 1.f / 30.f;
+static constexpr int WARMUP_FRAMES = 150;   // 自由落体 + 沉降
+static constexpr int MEASURE_FRAMES = 90;   // 计时与稳定性统计
+static constexpr int COUNTS[] = {100, 500, 1000};
+
+static ParticleSimulation flip;
+static MpmSimulation mpm;
+static SphSimulation sph;
+
+static void runCase(FluidSimulation& sim, int count) {
+  sim.setParticleCount(count);
+  sim.setSeed(count);  // 同一粒子数 ⇒ 同一初始状态，结果可逐位复现
+  sim.setStagePrint(false);
+  sim.begin(nullptr);
+  sim.setGravity(0.f, 10.f * GRAVITY_MODIFIER);  // 平放、屏幕朝上
+
+  for (int f = 0; f < WARMUP_FRAMES; ++f)
+    sim.simulate(BENCH_DT);
+
+  uint32_t us = 0;
+  float sumSpeed = 0.f, maxSpeed = 0.f;
+  for (int f = 0; f < MEASURE_FRAMES; ++f) {
+    uint32_t t0 = micros();
+    sim.simulate(BENCH_DT);
+    us += micros() - t0;
+
+    const Particle* P = sim.data();
+    for (int i = 0; i < sim.particleCount(); ++i) {
+      float sp = sqrtf(P[i].vx * P[i].vx + P[i].vy * P[i].vy);
+      sumSpeed += sp;
+      maxSpeed = sp > maxSpeed ? sp : maxSpeed;
+    }
+  }
+
+  // 越界：跑出圆容器或出现 NaN
+  int escaped = 0;
+  const Particle* P = sim.data();
+  for (int i = 0; i < sim.particleCount(); ++i) {
+    float dx = P[i].x - 0.5f, dy = P[i].y - 0.5f;
+    if (!(dx * dx + dy * dy <= 0.25f))
+      ++escaped;
+  }
+
+  const int n = sim.particleCount();
+  const float frameUs = float(us) / MEASURE_FRAMES;
+  Serial.printf("%-8s %5d %9.0f %8.2f %9.4f %8.3f %6d\r\n", sim.name(), n,
+                frameUs, frameUs / n, sumSpeed / (MEASURE_FRAMES * n), maxSpeed,
+                escaped);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10);
+
+  Serial.printf("engine   count  us/frame  us/part  mean|v|    max|v|  escaped\r\n");
+  for (int count : COUNTS) {
+    if (count > FluidSimulation::PC_MAX) {
+      Serial.printf("skip %d (MAX_PARTICLES=%d)\r\n", count,
+                    FluidSimulation::PC_MAX);
+      continue;
+    }
+    runCase(flip, count);
+    runCase(mpm, count);
+    runCase(sph, count);
+  }
+}
+
+void loop() {}
@@ -83,4 +83,10 @@ class LGFX_GC9A01 : public lgfx::LGFX_Device {
 
     return lgfx::LGFX_Device::begin();
   }
+
+  // 系统时钟变化后 clk_peri 随之变化：按配置频率重算 SPI 与背光 PWM 分频
+  inline void refreshClocks() {
+    _bus_instance.config(_bus_instance.config());
+    _light_instance.init(getBrightness());
+  }
 };
\ No newline at end of file
@@ -1,10 +1,18 @@
 /******************************************************************
  *  main.cpp  ――  Fluid-SIM + 低功耗状态机 (RP2040)
  ******************************************************************/
+#include <EEPROM.h>
 #include <Wire.h>
+#include <pico/time.h>
+#include "EnergyMeter.hpp"
 #include "FluidRenderer.hpp"
+#include "GravityFilter.hpp"
 #include "LowPowerRP2040.h"  // ★ 低功耗库
+#include "MpmSimulation.hpp"
 #include "ParticleSimulation.hpp"
+#include "SecondaryPool.hpp"
+#include "SphSimulation.hpp"
+#include "battery.hpp"
 #include "lgfx_gc9a01.hpp"
 #include "qmi8658c.hpp"
 
@@ -13,24 +21,140 @@ using namespace low_power;
 /* ────── 硬件/模块 ─────────────────────────── */
 static LGFX_GC9A01 display;
 static QMI8658C imu;
+#if FLUID_ENGINE == FLUID_ENGINE_MPM
+static MpmSimulation sim;  // -D FLUID_ENGINE=FLUID_ENGINE_MPM
+#elif FLUID_ENGINE == FLUID_ENGINE_SPH
+static SphSimulation sim;  // -D FLUID_ENGINE=FLUID_ENGINE_SPH
+#else
 static ParticleSimulation sim;
+#endif
+static SecondaryPool spray;  // 泡沫 / 飞沫 / 气泡
 static FluidRenderer renderer(&display, &sim);
 static ArduinoLowPowerRP2040 lp;  // ★ 低功耗对象
+static DvfsGovernorRP2040 dvfs;   // 按每帧负载调频调压
+static Battery battery;
+static EnergyMeter energy;        // 按状态 / 工作点 / 阶段记账
+
+/* ────── IMU 中断脚（WoM 唤醒）：板级未定义时用 GP23 ── */
+#ifndef PIN_IMU_INT1
+#define PIN_IMU_INT1 23
+#endif
+
+/* ────── 电池分压 ADC 脚：板级未定义时用 GP29（1/3 分压） ── */
+#ifndef PIN_BAT_ADC
+#define PIN_BAT_ADC 29
+#endif
+
+/* ────── 诊断输出：录制轨迹时 Serial 只留给二进制数据，一律静音 ── */
+#ifdef IMU_TRACE_RECORD
+// 参数照常参与编译（不报未使用），调用本身被优化掉
+#define LOGF(...)                 \
+  do {                            \
+    if (0)                        \
+      Serial.printf(__VA_ARGS__); \
+  } while (0)
+#else
+#define LOGF(...) Serial.printf(__VA_ARGS__)
+#endif
+
+/* ────── 液面快照：放在不清零的 RAM，复位后仍在 ─── */
+static uint8_t __uninitialized_ram(s_snapshot)[FluidSimulation::SNAPSHOT_MAX];
+
+/* ────── IMU 校准：存 EEPROM（flash 仿真），串口发 'c' 平放重新校准 ── */
+#define IMU_CAL_MAGIC 0x4C414349u  // "ICAL"（小端）
+struct StoredCalibration {
+  uint32_t magic;
+  uint32_t size;  // 结构变化即失效
+  QMI8658C::Calibration cal;
+};
+
+static void loadCalibration() {
+  StoredCalibration s;
+  EEPROM.get(0, s);
+  if (s.magic == IMU_CAL_MAGIC && s.size == sizeof(s.cal)) {
+    imu.setCalibration(s.cal);
+    LOGF("imu calibration loaded\r\n");
+  }
+}
+
+#ifndef IMU_TRACE_RECORD  // 录制时串口命令不可用（见 loop）
+static void calibrateImu() {
+  if (!imu.calibrate()) {
+    LOGF("imu calibration failed: keep the device level and still\r\n");
+    return;
+  }
+  StoredCalibration s{IMU_CAL_MAGIC, sizeof(s.cal), imu.calibration()};
+  EEPROM.put(0, s);
+  EEPROM.commit();
+  const QMI8658C::Calibration& c = s.cal;
+  LOGF("imu calibrated: acc off %d %d gain z %u, gyro off %d %d %d\r\n",
+       c.accOffset[0], c.accOffset[1], c.accGain[2], c.gyroOffset[0],
+       c.gyroOffset[1], c.gyroOffset[2]);
+}
+#endif
+
+/* ────── IMU 数据源：直连或经录制器（-D IMU_TRACE_RECORD） ── */
+#ifdef IMU_TRACE_RECORD
+#include "ImuTrace.hpp"
+static ImuTraceRecorder imuTrace;  // 二进制轨迹经 Serial 流出
+static ImuSource* imuSrc = &imuTrace;
+#else
+static ImuSource* imuSrc = &imu;
+#endif
+// 重力方向：陀螺仪 + 加速度计互补滤波，抖动与线加速度不再直接进流体
+static GravityFilter gravity;
 
 /* ────── 运行参数 ──────────────────────────── */
 static constexpr float TARGET_FPS = 30.f;
 static constexpr float FIXED_DT = 1.f / TARGET_FPS;
 static constexpr float TIME_MULTIPLIER = 1.0f;
+static constexpr uint32_t FRAME_US = uint32_t(1e6f / TARGET_FPS);  // 帧期限
+static uint32_t frameUs = FRAME_US;  // 低电量时放宽
+// AttitudeEngine 8 Hz：帧率（低电量时 20 fps）超过其两倍，增量不会被覆盖
+static constexpr uint32_t AE_PERIOD_US = 1000000 / 8;
+
+/* ────── 低电量策略 ────────────────────────── */
+static constexpr uint32_t BATTERY_UPDATE_MS = 1000;      // 采样周期
+static constexpr uint32_t BATTERY_REPORT_MS = 60000;     // 串口报告周期
+static constexpr uint8_t BATTERY_LOW_PERCENT = 20;       // 低于此降帧率
+static constexpr uint8_t BATTERY_CRITICAL_PERCENT = 10;  // 低于此再减粒子
+static constexpr uint8_t BATTERY_HYSTERESIS = 5;         // 回升这么多才恢复
+static constexpr uint32_t LOW_BATTERY_FRAME_US = uint32_t(1e6f / 20.f);
+static constexpr int CRITICAL_PARTICLE_PERCENT = 60;  // 保留的粒子比例
+
+enum class BatteryLevel { NORMAL, REDUCED_FPS, REDUCED_PARTICLES };
+static BatteryLevel batteryLevel = BatteryLevel::NORMAL;
+static int fullParticles = 0;  // begin() 时的粒子数
 
 /* ────── 运动检测参数 ──────────────────────── */
 static constexpr float GYRO_EPS = 10.0f;     // Δ阈值
 static constexpr uint32_t STILL_MS = 30000;  // 判静止时间
-static constexpr uint32_t DETECT_MS = 1000;  // 判静止时间
+static constexpr uint8_t WOM_THRESHOLD_MG = 60;  // 运动唤醒阈值 (mg)
+static constexpr float FLUID_CALM_SPEED = 1.0f;  // 液面平均速度低于此值才算静止
 
 /* ────── 状态机枚举 ────────────────────────── */
-enum class AppState { RUNNING, GO_SLEEP, SLEEP_POLL };
+enum class AppState { RUNNING, GO_SLEEP, SLEEP_DORMANT };
 static AppState state = AppState::RUNNING;
 
+/* ────── 功耗模型：各状态除内核以外的电流，内核按工作点与负载另算 ── */
+static const EnergyStateModel ENERGY_STATES[] = {
+    {"running", 22000, true},   // 背光全亮，IMU 250 Hz
+    {"go-sleep", 22000, true},  // 同上，只停留一帧
+    {"dormant", 1500, false},   // 背光关，IMU WoM，RP2040 时钟全停
+};
+// 记账阶段：模拟引擎各阶段 + 飞沫 + 渲染
+static const char* stageNames[FluidSimulation::STAGE_MAX + 2];
+static int simStages = 0;
+
+static void setState(AppState s) {
+  state = s;
+  energy.setState(int(s), time_us_64());
+}
+
+/* ────── 唤醒延迟测量（µs，0 = 未在测） ─────── */
+static uint32_t wakeUs = 0;
+static uint32_t wakeClockUs = 0, wakePeriphUs = 0, wakeImuUs = 0;
+
 /* ────── 陀螺仪监视变量 ────────────────────── */
 static float prevGx = 0, prevGy = 0;
 static uint32_t stillTimer = 0;
@@ -38,7 +162,7 @@ static uint32_t stillTimer = 0;
 /* ────── 辅助：读取陀螺仪 Δ ─────────────────── */
 static bool gyroMoving(float& dxdy) {
   float gx, gy, gz;
-  if (!imu.readGyroscope(&gx, &gy, &gz))
+  if (!gravity.readGyroscope(&gx, &gy, &gz))  // 本帧滤波用过的同一采样
     return true;  // 读失败视为运动
 
   dxdy = hypotf(gx - prevGx, gy - prevGy);  // √Δx²+Δy²
@@ -47,6 +171,94 @@ static bool gyroMoving(float& dxdy) {
   return dxdy > GYRO_EPS;
 }
 
+/* ────── 辅助：IMU 运行配置（上电 / WoM 唤醒后） ── */
+static void configureImu() {
+  // MCU 复位不影响 IMU，WoM 可能仍在；WoM 设置不走批处理，先单独写出
+  imu.disableWakeOnMotion();
+  // 其余寄存器攒成一批，commit() 时一次突发写出
+  imu.beginBatch();
+  // 6DOF 模式下加速度计跟随陀螺仪速率，两者取同一 ODR
+  imu.configureAcc(QMI8658C::AccScale::ACC_SCALE_2G,
+                   QMI8658C::AccODR::ACC_ODR_250HZ);
+  imu.configureGyro(QMI8658C::GyroScale::GYRO_SCALE_256DPS,
+                    QMI8658C::GyroODR::GYRO_ODR_250HZ);
+  imu.setPowerMode(QMI8658C::PowerMode::ACC_GYRO);
+#ifdef IMU_ATTITUDE_ENGINE
+  imu.enableAttitudeEngine(QMI8658C::AeODR::AE_ODR_8HZ);  // AE_PERIOD_US
+#endif
+  imu.commit();
+}
+
+/* ────── 辅助：调频后重算外设分频（clk_peri 跟随 clk_sys） ── */
+static void onClockChange(uint32_t khz) {
+  display.refreshClocks();
+  Wire1.setClock(400000);
+  energy.setClock(khz, time_us_64());
+}
+
+/* ────── 辅助：剩余运行时间（当前功耗状态 + 实测帧负载） ── */
+static void reportBattery(AppState s) {
+  // 运行：按记账得出的平均电流（含实测负载与调频）；休眠：模型电流
+  const float ma = s == AppState::RUNNING
+                       ? energy.averageMilliamps(time_us_64())
+                       : energy.modelMilliamps(int(s), 0, 0.f);
+  const uint16_t mv = battery.millivolts();
+  LOGF("battery %u.%02u V %u%%, %s %.1f mA, ~%lu min\r\n", mv / 1000,
+       mv % 1000 / 10, battery.percent(), ENERGY_STATES[int(s)].name, ma,
+       battery.runtimeMinutes(ma));
+}
+
+/* ────── 辅助：本帧记账（忙碌时间 + 各阶段） ── */
+static void accountFrame(uint32_t busyUs, uint32_t sprayUs, uint32_t renderUs) {
+  energy.addBusy(busyUs);
+  for (int i = 0; i < simStages; ++i)
+    energy.addStage(i, sim.stageUs(i));
+  energy.addStage(simStages, sprayUs);
+  energy.addStage(simStages + 1, renderUs);
+}
+
+/* ────── 辅助：电量采样 + 低电量降级（降帧率 → 减粒子） ── */
+static void updateBattery() {
+  static uint32_t sampleMs = 0, reportMs = 0;
+  const uint32_t ms = millis();
+  if (ms - sampleMs < BATTERY_UPDATE_MS)
+    return;
+  sampleMs = ms;
+  battery.update();
+  energy.setBattery(battery.millivolts(), battery.percent(), time_us_64());
+
+  // 进入立即生效，恢复要多回升 BATTERY_HYSTERESIS，避免在阈值附近来回切
+  const uint8_t pct = battery.percent();
+  const BatteryLevel prev = batteryLevel;
+  const uint8_t crit =
+      BATTERY_CRITICAL_PERCENT +
+      (prev == BatteryLevel::REDUCED_PARTICLES ? BATTERY_HYSTERESIS : 0);
+  const uint8_t low = BATTERY_LOW_PERCENT +
+                      (prev != BatteryLevel::NORMAL ? BATTERY_HYSTERESIS : 0);
+  if (pct < crit)
+    batteryLevel = BatteryLevel::REDUCED_PARTICLES;
+  else if (pct < low)
+    batteryLevel = BatteryLevel::REDUCED_FPS;
+  else
+    batteryLevel = BatteryLevel::NORMAL;
+
+  if (batteryLevel != prev) {
+    frameUs = batteryLevel == BatteryLevel::NORMAL ? FRAME_US
+                                                   : LOW_BATTERY_FRAME_US;
+    dvfs.setDeadline(frameUs);  // 帧期限放宽后调频器自然降到更低工作点
+    sim.setParticleCount(batteryLevel == BatteryLevel::REDUCED_PARTICLES
+                             ? fullParticles * CRITICAL_PARTICLE_PERCENT / 100
+                             : fullParticles);
+    LOGF("battery %u%%: %lu us/frame, %d particles\r\n", pct, frameUs,
+         sim.particleCount());
+  }
+
+  if (ms - reportMs >= BATTERY_REPORT_MS) {
+    reportMs = ms;
+    reportBattery(AppState::RUNNING);
+  }
+}
+
 /* ────── 初始化 ────────────────────────────── */
 void setup() {
   Serial.begin(115200);
@@ -60,15 +272,57 @@ void setup() {
   Wire1.setClock(400000);
   Wire1.begin();
   imu.begin(&Wire1, QMI8658C_I2C_ADDRESS_PULLUP);
-  imu.configureGyro(QMI8658C::GyroScale::GYRO_SCALE_256DPS,
-                    QMI8658C::GyroODR::GYRO_ODR_250HZ);
+  configureImu();
+  EEPROM.begin(256);
+  loadCalibration();
 
-  sim.begin(&imu);
+  gravity.begin(imuSrc);
+#ifdef IMU_ATTITUDE_ENGINE
+  // 片上 AttitudeEngine 代替陀螺积分，漏掉的增量由陀螺补上
+  gravity.setUseRotationIncrement(true, AE_PERIOD_US);
+#endif
+  sim.begin(&gravity);
+#if defined(SIM_DEMO_BODY) && FLUID_ENGINE == FLUID_ENGINE_FLIP
+  sim.addRigidBody(0.5f, 0.3f, 0.06f, 0.08f);  // 演示：漂浮的小胶囊
+#endif
+  // 意外复位后恢复上次液面；冷启动时内容随机，校验失败即保持新播种
+  fullParticles = sim.particleCount();
+  if (sim.load(s_snapshot, sizeof(s_snapshot))) {
+    // 快照可能是减粒子时存的：batteryLevel 从 NORMAL 开始，不会再调回，
+    // 这里先恢复全部粒子（其余粒子在刚播种的位置），电量低时首次评估再减
+    sim.setParticleCount(fullParticles);
+    LOGF("fluid state restored\r\n");
+  }
+
+#ifdef IMU_TRACE_RECORD
+  sim.setStagePrint(false);  // Serial 只留给轨迹数据
+  imuTrace.begin(&imu, &Serial);
+#endif
   renderer.setGridSolidColor(TFT_DARKGREY);
-  renderer.setGridFluidColor(TFT_BLUE);
+  spray.clear(sim.seed());
+  renderer.setSecondary(&spray);
+
+  // 休眠 = dormant，直到 IMU 的 WoM 中断拉出上升沿；SRAM 保持，
+  // 醒来后 lp.sleep() 恢复时钟并返回，液面原地继续
+  pinMode(PIN_IMU_INT1, INPUT);
+  lp.setSleepMode(sleep_mode_enum_t::deepSleep);
+  lp.addWakeupPin(PIN_IMU_INT1, pin_change_t::on_high);
+  lp.setRestart(false);
+
+  simStages = sim.stageCount();
+  for (int i = 0; i < simStages; ++i)
+    stageNames[i] = sim.stageName(i);
+  stageNames[simStages] = "spray";
+  stageNames[simStages + 1] = "render";
+  energy.begin(ENERGY_STATES, sizeof(ENERGY_STATES) / sizeof(ENERGY_STATES[0]),
+               stageNames, simStages + 2, time_us_64(), int(state),
+               clock_get_hz(clk_sys) / 1000);
+  energy.setCapacity(BATTERY_CAPACITY_MAH);
 
-  lp.setSleepMode(sleep_mode_enum_t::lightSleep);
-  lp.setRestart(false);  // 醒来不复位
+  dvfs.begin(FRAME_US, onClockChange);
+
+  battery.begin(PIN_BAT_ADC);
+  battery.setVoltageDivider(1.0f / 3.0f);
 }
 
 /* ────── 主循环 ────────────────────────────── */
@@ -89,38 +343,90 @@ void loop() {
   switch (state) {
     /* ――― 正常运行 ――― */
     case AppState::RUNNING: {
+#ifndef IMU_TRACE_RECORD
+      // 串口命令：c = IMU 校准，e = 功耗报告（录制时 Serial 只出轨迹数据）
+      switch (Serial.available() ? Serial.read() : -1) {
+        case 'c':
+          calibrateImu();
+          break;
+        case 'e':
+          energy.report(Serial, time_us_64());
+          break;
+      }
+#endif
+      updateBattery();
+
       /* 物理 & 渲染 */
       sim.simulate(dt);  // ← 改这里
+      uint32_t tSpray = micros();
+      spray.update(sim, dt);
+      uint32_t tRender = micros();
       renderer.render(FluidRenderer::PARTIAL_GRID);
+      uint32_t tEnd = micros();
 
-      /* 运动检测 */
+      /* 唤醒后第一帧：报告唤醒 → 出帧延迟 */
+      if (wakeUs) {
+        LOGF("wake to first frame %lu us (clocks %lu, periph %lu, imu %lu)\r\n",
+             micros() - wakeUs, wakeClockUs, wakePeriphUs, wakeImuUs);
+        wakeUs = 0;
+      }
+
+      /* 本帧忙碌时间 → 记账 → 调频；余下时间空闲到帧期限。
+         先记账：调频会在 onClockChange 里结束当前记账区间 */
+      uint32_t busyUs = micros() - nowUs;
+      accountFrame(busyUs, tRender - tSpray, tEnd - tRender);
+      dvfs.update(busyUs);
+      if (busyUs < frameUs)
+        sleep_us(frameUs - busyUs);
+
+      /* 运动检测：设备在动，或液面还在晃（模拟端逐格统计） */
       bool moving = gyroMoving(dG);
+      moving |= sim.cellStats().meanSpeed > uint16_t(FLUID_CALM_SPEED * 256);
       if (moving) {
         stillTimer = millis();  // 重置静止计时
       } else if (millis() - stillTimer > STILL_MS) {
-        state = AppState::GO_SLEEP;
+        setState(AppState::GO_SLEEP);
       }
       break;
     }
 
     /* ――― 进入休眠前的一次性收尾 ――― */
     case AppState::GO_SLEEP: {
+      sim.save(s_snapshot, sizeof(s_snapshot));  // 兜底：休眠中意外复位
+      if (!imu.enableWakeOnMotion(WOM_THRESHOLD_MG)) {
+        LOGF("WoM not acknowledged, staying awake\r\n");
+        configureImu();
+        stillTimer = millis();
+        setState(AppState::RUNNING);
+        break;
+      }
       display.setBrightness(0);
-      state = AppState::SLEEP_POLL;
+      reportBattery(AppState::SLEEP_DORMANT);
+      setState(AppState::SLEEP_DORMANT);
       break;
     }
 
-    /* ――― Deep-sleep 轮询 ――― */
-    case AppState::SLEEP_POLL: {
-      lp.sleepFor(DETECT_MS, time_unit_t::ms);
+    /* ――― Dormant：等待 IMU 运动中断，醒来原地继续 ――― */
+    case AppState::SLEEP_DORMANT: {
+      lp.sleep();  // 返回时 PLL 与休眠前的工作点已恢复
 
-      bool moving = gyroMoving(dG);
-      if (moving) {
-        stillTimer = millis();
-        state = AppState::RUNNING;
-        display.setBrightness(255);
-        prevUs = micros();  // 重置基准，避免第一帧 dt 过大
-      }
+      // 最短恢复序列：外设分频 → IMU → 背光；显存与模拟状态都还在
+      uint32_t t0 = micros();
+      onClockChange(dvfs.getKhz());
+      uint32_t t1 = micros();
+      configureImu();
+      gravity.reset();
+      uint32_t t2 = micros();
+      display.setBrightness(255);
+
+      wakeUs = lp.getWakeMicros();
+      wakeClockUs = t0 - wakeUs;
+      wakePeriphUs = t1 - t0;
+      wakeImuUs = t2 - t1;
+
+      stillTimer = millis();
+      setState(AppState::RUNNING);
+      prevUs = micros();  // 重置基准，避免第一帧 dt 过大
       break;
     }
   }
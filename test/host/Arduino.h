@@ -0,0 +1,132 @@
+#pragma once
+
+/*
+ * Host shim of the Arduino-Pico core: just enough of the API for the
+ * libraries under lib/ to compile and run in the host tests.
+ *
+ * Time is a fake clock that only moves when a test advances it (or when the
+ * code under test calls delay()), so every run is reproducible.
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+typedef uint8_t pin_size_t;
+typedef bool boolean;
+
+#define constrain(amt, low, high) \
+  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ─── clock ───────────────────────────────────────
+namespace host {
+extern uint64_t clockUs;
+inline void advanceUs(uint64_t us) {
+  clockUs += us;
+}
+}  // namespace host
+
+inline unsigned long micros() {
+  return static_cast<unsigned long>(static_cast<uint32_t>(host::clockUs));
+}
+inline unsigned long millis() {
+  return static_cast<unsigned long>(
+      static_cast<uint32_t>(host::clockUs / 1000));
+}
+inline void delay(unsigned long ms) {
+  host::advanceUs(ms * 1000ull);
+}
+inline void delayMicroseconds(unsigned int us) {
+  host::advanceUs(us);
+}
+
+// ─── pins ────────────────────────────────────────
+enum PinMode { INPUT, OUTPUT, INPUT_PULLUP, INPUT_PULLDOWN };
+enum PinStatus { LOW, HIGH, CHANGE, FALLING, RISING };
+
+namespace host {
+extern int adcValue;                 // analogRead() of every pin
+extern void (*pinCallback)();        // last attachInterrupt() callback
+}  // namespace host
+
+inline int analogRead(pin_size_t) {
+  return host::adcValue;
+}
+inline void analogReadResolution(int) {}
+inline void pinMode(pin_size_t, int) {}
+inline int digitalRead(pin_size_t) {
+  return LOW;
+}
+inline void digitalWrite(pin_size_t, int) {}
+inline int digitalPinToInterrupt(pin_size_t pin) {
+  return pin;
+}
+inline void attachInterrupt(int, void (*callback)(), int) {
+  host::pinCallback = callback;
+}
+inline void detachInterrupt(int) {
+  host::pinCallback = nullptr;
+}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// ─── Print / Serial ──────────────────────────────
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+  size_t write(uint8_t c) { return write(&c, 1); }
+
+  size_t print(const char* s) {
+    return write(reinterpret_cast<const uint8_t*>(s), strlen(s));
+  }
+  size_t println(const char* s = "") { return print(s) + print("\r\n"); }
+  // no format attribute: uint32_t is unsigned long on the RP2040 (%lu)
+  // but unsigned int on the host
+  size_t printf(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n < 0)
+      return 0;
+    return write(reinterpret_cast<const uint8_t*>(buf),
+                 min(static_cast<size_t>(n), sizeof(buf) - 1));
+  }
+};
+
+class HardwareSerial : public Print {
+ public:
+  using Print::write;
+  void begin(unsigned long) {}
+  void end() {}
+  void flush() { fflush(stdout); }
+  int available() { return 0; }
+  int read() { return -1; }
+  explicit operator bool() { return true; }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    return fwrite(buffer, 1, size, stdout);
+  }
+};
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+// ─── RP2040 ──────────────────────────────────────
+#define __uninitialized_ram(group) group
+
+class RP2040 {
+ public:
+  void reboot() {}
+};
+extern RP2040 rp2040;
@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+ * Host shim of I2Cdevlib-Core: one fake device behind a 256-byte register
+ * map. Reads come from the map, writes go into it and are logged, so tests
+ * can check both the resulting register state and the bus traffic.
+ *
+ * `onWrite` lets a test emulate device behaviour (e.g. a command register
+ * that sets a status bit); `failWrites` makes writes touching one register
+ * fail as a NACK would.
+ */
+
+#include <Arduino.h>
+
+#include <vector>
+
+namespace host {
+struct I2cWrite {
+  uint8_t reg;                 // first register of the transfer
+  std::vector<uint8_t> data;   // one byte per register, auto-increment
+};
+
+struct I2cDevice {
+  uint8_t regs[256] = {};
+  std::vector<I2cWrite> log;
+  int failWrites = -1;  // register whose writes fail; -1 = none
+  void (*onWrite)(uint8_t reg, uint8_t value) = nullptr;
+
+  void reset() { *this = I2cDevice(); }
+};
+extern I2cDevice i2c;
+}  // namespace host
+
+class I2Cdev {
+ public:
+  static inline uint16_t readTimeout = 1000;
+
+  static int8_t readByte(uint8_t dev,
+                         uint8_t reg,
+                         uint8_t* data,
+                         uint16_t timeout = readTimeout,
+                         void* wire = nullptr) {
+    return readBytes(dev, reg, 1, data, timeout, wire);
+  }
+  static int8_t readBytes(uint8_t,
+                          uint8_t reg,
+                          uint8_t length,
+                          uint8_t* data,
+                          uint16_t = readTimeout,
+                          void* = nullptr) {
+    for (uint8_t i = 0; i < length; i++)
+      data[i] = host::i2c.regs[uint8_t(reg + i)];
+    return length;
+  }
+
+  static bool writeByte(uint8_t dev, uint8_t reg, uint8_t data,
+                        void* wire = nullptr) {
+    return writeBytes(dev, reg, 1, &data, wire);
+  }
+  static bool writeBytes(uint8_t,
+                         uint8_t reg,
+                         uint8_t length,
+                         uint8_t* data,
+                         void* = nullptr) {
+    host::I2cDevice& d = host::i2c;
+    if (d.failWrites >= reg && d.failWrites < reg + length)
+      return false;
+    d.log.push_back({reg, std::vector<uint8_t>(data, data + length)});
+    for (uint8_t i = 0; i < length; i++) {
+      d.regs[uint8_t(reg + i)] = data[i];
+      if (d.onWrite)
+        d.onWrite(uint8_t(reg + i), data[i]);
+    }
+    return true;
+  }
+};
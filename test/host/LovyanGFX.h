@@ -0,0 +1,139 @@
+#pragma once
+
+/*
+ * Host shim of LovyanGFX: an in-memory RGB565 framebuffer with the drawing
+ * calls FluidRenderer uses. Every pixel write inside the clip rectangle is
+ * counted in `pixelsPushed`, which stands in for the SPI traffic of the
+ * panel.
+ */
+
+#include <Arduino.h>
+
+#include <vector>
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_BLUE 0x001F
+#define TFT_CYAN 0x07FF
+#define TFT_WHITE 0xFFFF
+#define TFT_DARKGREY 0x7BEF
+
+namespace lgfx {
+
+constexpr uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+}
+
+class LovyanGFX {
+ public:
+  virtual ~LovyanGFX() = default;
+
+  static constexpr uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+    return lgfx::color565(r, g, b);
+  }
+
+  int32_t width() const { return m_width; }
+  int32_t height() const { return m_height; }
+
+  void startWrite() {}
+  void endWrite() {}
+
+  void setClipRect(int32_t x, int32_t y, int32_t w, int32_t h) {
+    m_clipX0 = max(0, x);
+    m_clipY0 = max(0, y);
+    m_clipX1 = min(m_width - 1, x + w - 1);
+    m_clipY1 = min(m_height - 1, y + h - 1);
+  }
+  void clearClipRect() { setClipRect(0, 0, m_width, m_height); }
+
+  void drawPixel(int32_t x, int32_t y, uint16_t color) {
+    if (x < m_clipX0 || y < m_clipY0 || x > m_clipX1 || y > m_clipY1)
+      return;
+    m_buffer[y * m_width + x] = color;
+    pixelsPushed++;
+  }
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) {
+    for (int32_t j = y; j < y + h; j++)
+      for (int32_t i = x; i < x + w; i++)
+        drawPixel(i, j, color);
+  }
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint16_t color) {
+    fillRect(x, y, w, 1, color);
+  }
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint16_t color) {
+    fillRect(x, y, 1, h, color);
+  }
+  void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y + 1, h - 2, color);
+    drawFastVLine(x + w - 1, y + 1, h - 2, color);
+  }
+  void fillScreen(uint16_t color) { fillRect(0, 0, m_width, m_height, color); }
+
+  // midpoint circle, one span per row
+  void fillCircle(int32_t x, int32_t y, int32_t r, uint16_t color) {
+    for (int32_t dy = -r; dy <= r; dy++) {
+      int32_t dx = 0;
+      while ((dx + 1) * (dx + 1) + dy * dy <= r * r)
+        dx++;
+      drawFastHLine(x - dx, y + dy, 2 * dx + 1, color);
+    }
+  }
+  void drawCircle(int32_t x, int32_t y, int32_t r, uint16_t color) {
+    int32_t dx = r, dy = 0, err = 1 - r;
+    while (dx >= dy) {
+      const int32_t px[8] = {dx, dy, -dy, -dx, -dx, -dy, dy, dx};
+      const int32_t py[8] = {dy, dx, dx, dy, -dy, -dx, -dx, -dy};
+      for (int i = 0; i < 8; i++)
+        drawPixel(x + px[i], y + py[i], color);
+      dy++;
+      if (err < 0) {
+        err += 2 * dy + 1;
+      } else {
+        dx--;
+        err += 2 * (dy - dx) + 1;
+      }
+    }
+  }
+
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h,
+                 const uint16_t* data) {
+    for (int32_t j = 0; j < h; j++)
+      for (int32_t i = 0; i < w; i++)
+        drawPixel(x + i, y + j, data[j * w + i]);
+  }
+
+  /// RGB565 framebuffer, row-major
+  const uint16_t* buffer() const { return m_buffer.data(); }
+  uint16_t pixel(int32_t x, int32_t y) const {
+    return m_buffer[y * m_width + x];
+  }
+
+  uint64_t pixelsPushed = 0;
+
+ protected:
+  int32_t m_width = 0;
+  int32_t m_height = 0;
+  int32_t m_clipX0 = 0, m_clipY0 = 0, m_clipX1 = -1, m_clipY1 = -1;
+  std::vector<uint16_t> m_buffer;
+};
+
+class LGFX_Sprite : public LovyanGFX {
+ public:
+  explicit LGFX_Sprite(LovyanGFX* parent = nullptr) {}
+
+  void setColorDepth(int) {}
+  void* createSprite(int32_t w, int32_t h) {
+    m_width = w;
+    m_height = h;
+    m_buffer.assign(w * h, TFT_BLACK);
+    clearClipRect();
+    return m_buffer.data();
+  }
+  void* getBuffer() { return m_buffer.data(); }
+};
+
+}  // namespace lgfx
+
+using lgfx::LGFX_Sprite;
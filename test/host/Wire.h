@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire {
+ public:
+  void begin() {}
+  void end() {}
+  void setSDA(pin_size_t) {}
+  void setSCL(pin_size_t) {}
+  void setClock(uint32_t) {}
+};
+extern TwoWire Wire;
+extern TwoWire Wire1;
@@ -0,0 +1,40 @@
+#pragma once
+
+// Host shim of hardware/clocks.h: clk_sys is a plain variable; changing it
+// calls host::onSysClock first, so tests can check what else (e.g. the core
+// voltage) was in place at that moment.
+
+#include <Arduino.h>
+
+enum clock_index {
+  clk_gpout0,
+  clk_gpout1,
+  clk_gpout2,
+  clk_gpout3,
+  clk_ref,
+  clk_sys,
+  clk_peri,
+  clk_usb,
+  clk_adc,
+  clk_rtc,
+  CLK_COUNT
+};
+
+namespace host {
+extern uint32_t sysKhz;
+extern uint32_t sysClockChanges;
+extern bool (*onSysClock)(uint32_t khz);  // false: not reachable
+}  // namespace host
+
+inline uint32_t clock_get_hz(clock_index clk) {
+  return clk == clk_sys ? host::sysKhz * 1000 : 48000000;
+}
+
+inline bool set_sys_clock_khz(uint32_t khz, bool) {
+  if (host::onSysClock && !host::onSysClock(khz))
+    return false;
+  if (khz != host::sysKhz)
+    host::sysClockChanges++;
+  host::sysKhz = khz;
+  return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Host shim of hardware/rtc.h: the RTC is a plain datetime that only moves
+// when a test (or the sleep fake) sets it. An armed alarm is kept for the
+// test to inspect; it fires only when the sleep fake ends a sleep with it.
+
+#include "pico.h"
+
+typedef struct {
+  int16_t year;
+  int8_t month;
+  int8_t day;
+  int8_t dotw;
+  int8_t hour;
+  int8_t min;
+  int8_t sec;
+} datetime_t;
+
+typedef void (*rtc_callback_t)(void);
+
+namespace host {
+struct Rtc {
+  bool running = false;
+  datetime_t now = {};
+  bool alarmArmed = false;
+  datetime_t alarm = {};
+  rtc_callback_t callback = nullptr;
+  int inits = 0;  // rtc_init() calls
+
+  void reset() { *this = Rtc(); }
+};
+extern Rtc rtc;
+}  // namespace host
+
+inline void rtc_init(void) {
+  host::rtc.inits++;
+}
+inline bool rtc_running(void) {
+  return host::rtc.running;
+}
+inline bool rtc_set_datetime(datetime_t* t) {
+  host::rtc.now = *t;
+  host::rtc.running = true;
+  return true;
+}
+inline bool rtc_get_datetime(datetime_t* t) {
+  *t = host::rtc.now;
+  return host::rtc.running;
+}
+inline void rtc_set_alarm(datetime_t* t, rtc_callback_t user_callback) {
+  host::rtc.alarm = *t;
+  host::rtc.callback = user_callback;
+  host::rtc.alarmArmed = true;
+}
+inline void rtc_disable_alarm(void) {
+  host::rtc.alarmArmed = false;
+}
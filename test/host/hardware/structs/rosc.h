@@ -0,0 +1,23 @@
+#pragma once
+
+// Host shim of the ROSC registers, for the inline helpers in pico_rosc.h.
+
+#include <stdint.h>
+
+typedef volatile uint32_t io_rw_32;
+
+#define ROSC_STATUS_BADWRITE_BITS (1u << 24)
+
+struct rosc_hw_t {
+  io_rw_32 status = 0;
+};
+
+namespace host {
+extern rosc_hw_t roscHw;
+}  // namespace host
+
+#define rosc_hw (&host::roscHw)
+
+inline void hw_clear_bits(io_rw_32* addr, uint32_t mask) {
+  *addr &= ~mask;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Host shim of the VREG_AND_CHIP_RESET registers: the regulator is always
+// in regulation (ROK set); VSEL follows vreg_set_voltage().
+
+#include <stdint.h>
+
+#define VREG_AND_CHIP_RESET_VREG_ROK_BITS (1u << 12)
+#define VREG_AND_CHIP_RESET_VREG_VSEL_BITS (0xfu << 4)
+#define VREG_AND_CHIP_RESET_VREG_VSEL_LSB 4
+
+struct vreg_and_chip_reset_hw_t {
+  // 1.10 V, the reset value
+  volatile uint32_t vreg = VREG_AND_CHIP_RESET_VREG_ROK_BITS |
+                           (0b1011u << VREG_AND_CHIP_RESET_VREG_VSEL_LSB);
+};
+
+namespace host {
+extern vreg_and_chip_reset_hw_t vregHw;
+}  // namespace host
+
+#define vreg_and_chip_reset_hw (&host::vregHw)
@@ -0,0 +1,6 @@
+#pragma once
+
+// Host shim of hardware/sync.h: WFI returns at once. The sleep fake
+// (pico/sleep.h) has already delivered the wake interrupt by then.
+
+inline void __wfi() {}
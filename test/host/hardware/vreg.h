@@ -0,0 +1,31 @@
+#pragma once
+
+// Host shim of hardware/vreg.h: the core voltage is a plain variable, also
+// mirrored into the VSEL field of the regulator register.
+
+#include "hardware/structs/vreg_and_chip_reset.h"
+
+enum vreg_voltage {
+  VREG_VOLTAGE_0_85 = 0b0110,
+  VREG_VOLTAGE_0_90 = 0b0111,
+  VREG_VOLTAGE_0_95 = 0b1000,
+  VREG_VOLTAGE_1_00 = 0b1001,
+  VREG_VOLTAGE_1_05 = 0b1010,
+  VREG_VOLTAGE_1_10 = 0b1011,
+  VREG_VOLTAGE_1_15 = 0b1100,
+  VREG_VOLTAGE_1_20 = 0b1101,
+  VREG_VOLTAGE_1_25 = 0b1110,
+  VREG_VOLTAGE_1_30 = 0b1111,
+  VREG_VOLTAGE_DEFAULT = VREG_VOLTAGE_1_10,
+};
+
+namespace host {
+extern vreg_voltage vregVoltage;
+}  // namespace host
+
+inline void vreg_set_voltage(vreg_voltage voltage) {
+  host::vregVoltage = voltage;
+  host::vregHw.vreg =
+      (host::vregHw.vreg & ~VREG_AND_CHIP_RESET_VREG_VSEL_BITS) |
+      (uint32_t(voltage) << VREG_AND_CHIP_RESET_VREG_VSEL_LSB);
+}
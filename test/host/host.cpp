@@ -0,0 +1,32 @@
+// Definitions behind the host shims.
+
+#include <Arduino.h>
+#include <I2Cdev.h>
+#include <Wire.h>
+
+#include "hardware/clocks.h"
+#include "hardware/rtc.h"
+#include "hardware/structs/rosc.h"
+#include "hardware/structs/vreg_and_chip_reset.h"
+#include "hardware/vreg.h"
+
+namespace host {
+uint64_t clockUs = 0;
+int adcValue = 0;
+void (*pinCallback)() = nullptr;
+I2cDevice i2c;
+uint32_t sysKhz = 125000;
+uint32_t sysClockChanges = 0;
+bool (*onSysClock)(uint32_t khz) = nullptr;
+vreg_voltage vregVoltage = VREG_VOLTAGE_DEFAULT;
+vreg_and_chip_reset_hw_t vregHw;
+Rtc rtc;
+rosc_hw_t roscHw;
+}  // namespace host
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+TwoWire Wire;
+TwoWire Wire1;
+RP2040 rp2040;
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host shim of pico.h: the base types the pico-sdk headers use.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+ * Host fake behind drivers/rp2040/pico_sleep.h (pico-extras pico/sleep.h).
+ * It records what the code under test asked for and ends every sleep at
+ * once, either with the RTC alarm or with the pin interrupt, as the test
+ * picks:
+ * - sleep_run_from_*() drops clk_sys to the oscillator, sleep_power_up()
+ *   brings it back to the SDK default (125 MHz) through host::onSysClock,
+ *   and notes the core voltage it did that at
+ * - sleep_goto_sleep_until*() arms the RTC alarm, then fires it (the RTC
+ *   jumps to the alarm time) or, for the _or_gpio variant with
+ *   `wake = Wake::pin`, calls the attachInterrupt() callback instead
+ * - sleep_goto_dormant_until_pin() returns as if the edge had come
+ */
+
+#include <Arduino.h>
+
+#include "drivers/rp2040/pico_sleep.h"
+#include "hardware/vreg.h"
+
+namespace host {
+enum class Wake { alarm, pin };
+
+struct Sleep {
+  Wake wake = Wake::alarm;  // what ends sleep_goto_sleep_until_or_gpio()
+  dormant_source_t source = DORMANT_SOURCE_NONE;
+  int sleeps = 0;            // sleep_goto_sleep_until*() calls
+  bool gpioClocked = false;  // the last one kept the IO bank running
+  int dormants = 0;          // sleep_goto_dormant_until_pin() calls
+  int dormantPin = -1;
+  bool dormantEdge = false;
+  bool dormantHigh = false;
+  int powerUps = 0;  // sleep_power_up() calls
+  vreg_voltage powerUpVoltage = VREG_VOLTAGE_DEFAULT;  // at the last one
+
+  void reset() { *this = Sleep(); }
+};
+extern Sleep sleepState;
+}  // namespace host
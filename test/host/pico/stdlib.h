@@ -0,0 +1,5 @@
+#pragma once
+
+// Host shim of pico/stdlib.h: nothing beyond the base types is used.
+
+#include "pico.h"
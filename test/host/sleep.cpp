@@ -0,0 +1,64 @@
+// Definitions behind the sleep fake (pico/sleep.h).
+
+#include "pico/sleep.h"
+
+#include "drivers/rp2040/pico_rosc.h"
+#include "hardware/clocks.h"
+#include "hardware/rtc.h"
+
+namespace host {
+Sleep sleepState;
+}  // namespace host
+
+namespace {
+
+void wake(bool gpio) {
+  if (gpio && host::sleepState.wake == host::Wake::pin &&
+      host::pinCallback) {
+    host::pinCallback();
+    return;
+  }
+  host::rtc.now = host::rtc.alarm;
+  if (host::rtc.callback)
+    host::rtc.callback();
+}
+
+}  // namespace
+
+void processor_deep_sleep(void) {}
+
+void sleep_run_from_dormant_source(dormant_source_t dormant_source) {
+  host::sleepState.source = dormant_source;
+  host::sysKhz = dormant_source == DORMANT_SOURCE_XOSC ? 12000 : 6500;
+}
+
+void sleep_power_up(void) {
+  host::sleepState.powerUps++;
+  host::sleepState.powerUpVoltage = host::vregVoltage;
+  if (host::onSysClock)
+    host::onSysClock(125000);
+  host::sysKhz = 125000;
+}
+
+void sleep_goto_sleep_until(datetime_t* t, rtc_callback_t callback) {
+  host::sleepState.sleeps++;
+  host::sleepState.gpioClocked = false;
+  rtc_set_alarm(t, callback);
+  wake(false);
+}
+
+void sleep_goto_sleep_until_or_gpio(datetime_t* t, rtc_callback_t callback) {
+  host::sleepState.sleeps++;
+  host::sleepState.gpioClocked = true;
+  rtc_set_alarm(t, callback);
+  wake(true);
+}
+
+void sleep_goto_dormant_until_pin(uint gpio_pin, bool edge, bool high) {
+  host::sleepState.dormants++;
+  host::sleepState.dormantPin = gpio_pin;
+  host::sleepState.dormantEdge = edge;
+  host::sleepState.dormantHigh = high;
+}
+
+void rosc_enable(void) {}
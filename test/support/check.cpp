@@ -0,0 +1,57 @@
+#include "check.hpp"
+
+#include <string.h>
+
+#include <vector>
+
+namespace check {
+
+struct Case {
+  const char* name;
+  CaseFn fn;
+};
+
+static std::vector<Case>& cases() {
+  static std::vector<Case> c;
+  return c;
+}
+
+static int s_failures = 0;
+
+Registrar::Registrar(const char* name, CaseFn fn) {
+  cases().push_back({name, fn});
+}
+
+void fail(const char* file, int line, const char* message) {
+  fprintf(stderr, "%s:%d: failed: %s\n", file, line, message);
+  s_failures++;
+}
+
+void failValues(const char* file, int line, const char* expr, double a,
+                double b) {
+  fprintf(stderr, "%s:%d: failed: %s with %.9g vs %.9g\n", file, line, expr, a,
+          b);
+  s_failures++;
+}
+
+}  // namespace check
+
+int main(int argc, char** argv) {
+  const char* filter = argc > 1 ? argv[1] : nullptr;
+  int run = 0, failed = 0;
+  for (const check::Case& c : check::cases()) {
+    if (filter && !strstr(c.name, filter))
+      continue;
+    const int before = check::s_failures;
+    c.fn();
+    run++;
+    if (check::s_failures != before) {
+      failed++;
+      fprintf(stderr, "[FAIL] %s\n", c.name);
+    } else {
+      printf("[ OK ] %s\n", c.name);
+    }
+  }
+  printf("%d/%d cases passed\n", run - failed, run);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ * Minimal test registry for the host tests.
+ *
+ *   TEST_CASE(name) { CHECK(x == 1); CHECK_EQ(a, b); CHECK_NEAR(f, 1.0, 1e-3); }
+ *
+ * Each test file is one executable (one ctest entry); a failed check is
+ * reported with file and line and the case continues, so one run shows all
+ * failures. An optional command line argument runs only the cases whose
+ * name contains it.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+namespace check {
+
+using CaseFn = void (*)();
+
+struct Registrar {
+  Registrar(const char* name, CaseFn fn);
+};
+
+void fail(const char* file, int line, const char* message);
+void failValues(const char* file, int line, const char* expr, double a,
+                double b);
+
+}  // namespace check
+
+#define TEST_CASE(name)                                         \
+  static void name();                                           \
+  static const check::Registrar name##_registrar(#name, name); \
+  static void name()
+
+#define CHECK(cond)                                   \
+  do {                                                \
+    if (!(cond))                                      \
+      check::fail(__FILE__, __LINE__, "CHECK(" #cond ")"); \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                      \
+  do {                                                                      \
+    const auto check_a_ = (a);                                              \
+    const auto check_b_ = (b);                                              \
+    if (!(check_a_ == check_b_))                                            \
+      check::failValues(__FILE__, __LINE__, "CHECK_EQ(" #a ", " #b ")",     \
+                        static_cast<double>(check_a_),                      \
+                        static_cast<double>(check_b_));                     \
+  } while (0)
+
+#define CHECK_NEAR(a, b, eps)                                               \
+  do {                                                                      \
+    const double check_a_ = (a);                                            \
+    const double check_b_ = (b);                                            \
+    if (!(fabs(check_a_ - check_b_) <= (eps)))                              \
+      check::failValues(__FILE__, __LINE__,                                 \
+                        "CHECK_NEAR(" #a ", " #b ", " #eps ")", check_a_,   \
+                        check_b_);                                          \
+  } while (0)
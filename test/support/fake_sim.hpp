@@ -0,0 +1,69 @@
+#pragma once
+
+// 手工摆放的「模拟」：粒子与逐格统计由测试直接写入，simulate() 不做任何事。
+// 用于与物理无关、须逐位精确的渲染测试（调色板、抖动、脏区）。
+
+#include "FluidSimulation.hpp"
+
+class FakeSimulation : public FluidSimulation {
+ public:
+  FakeSimulation() {
+    m_numParticles = 0;
+    memset(m_particles, 0, sizeof(m_particles));
+  }
+
+  void begin(ImuSource* imu) override { m_imu = imu; }
+  void simulate(float dt) override {}
+  const char* name() const override { return "fake"; }
+  uint8_t engineId() const override { return 0xFF; }
+  int stageCount() const override { return 0; }
+  const char* stageName(int i) const override { return ""; }
+
+  const Particle* data() const override { return m_particles; }
+  bool isSolid(int gx, int gy) const override {
+    return outsideContainer((gx + 0.5f) * CELL, (gy + 0.5f) * CELL);
+  }
+
+  // 追加一个粒子（归一化位置与速度）
+  void addParticle(float x, float y, float vx = 0.0f, float vy = 0.0f) {
+    if (m_numParticles == PC_MAX)
+      return;
+    m_particles[m_numParticles++] = {x, y, vx, vy, 0.0f, 0.0f, 0.0f};
+  }
+  void clearParticles() { m_numParticles = 0; }
+
+  // 静止圆盘刚体（只供渲染读取，不参与任何物理）
+  void addBody(float x, float y, float radius) {
+    if (m_numBodies == SIM_RIGID_MAX)
+      return;
+    RigidBody& b = m_bodies[m_numBodies++];
+    b = RigidBody{};
+    b.x = x;
+    b.y = y;
+    b.ux = 1.0f;
+    b.radius = radius;
+  }
+  void clearBodies() { m_numBodies = 0; }
+  int rigidCount() const override { return m_numBodies; }
+  const RigidBody* rigidBodies() const override { return m_bodies; }
+
+  // 逐格统计可直接改写；refreshStats() 按粒子重算
+  CellStats& stats() { return m_stats; }
+  void refreshStats() { updateCellStats(); }
+  // 所有模拟格同一占有量（Q8）与速度（Q8）
+  void fillStats(uint16_t occ, uint16_t speed) {
+    m_stats = CellStats{};
+    for (int i = 0; i < GC; ++i) {
+      m_stats.occ[i] = occ;
+      m_stats.speed[i] = speed;
+    }
+  }
+
+ protected:
+  Particle* particles() override { return m_particles; }
+
+ private:
+  Particle m_particles[PC_MAX];
+  RigidBody m_bodies[SIM_RIGID_MAX];
+  int m_numBodies = 0;
+};
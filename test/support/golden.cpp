@@ -0,0 +1,247 @@
+#include "golden.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <filesystem>
+
+#ifndef GOLDEN_DIR
+#error "GOLDEN_DIR must point at the fixture directory"
+#endif
+#ifndef GOLDEN_OUT_DIR
+#define GOLDEN_OUT_DIR "golden_out"
+#endif
+
+namespace golden {
+
+// ─── RGB565 <-> RGB888 ───────────────────────────
+static void toRgb888(uint16_t c, uint8_t* rgb) {
+  const uint8_t r = c >> 11, g = (c >> 5) & 0x3f, b = c & 0x1f;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+static uint16_t toRgb565(const uint8_t* rgb) {
+  return ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3);
+}
+
+// ─── PNG ─────────────────────────────────────────
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G',
+                                         '\r', '\n', 0x1a, '\n'};
+
+static void putU32(std::vector<uint8_t>& out, uint32_t v) {
+  out.push_back(v >> 24);
+  out.push_back(v >> 16);
+  out.push_back(v >> 8);
+  out.push_back(v);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+         (uint32_t(p[2]) << 8) | p[3];
+}
+
+static void putChunk(std::vector<uint8_t>& out, const char* type,
+                     const uint8_t* data, uint32_t length) {
+  putU32(out, length);
+  const size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + length);
+  putU32(out, crc32(0, out.data() + start, length + 4));
+}
+
+bool writePng(const std::string& path, int w, int h, const uint16_t* rgb565) {
+  // rows with filter type 0, then one zlib stream
+  std::vector<uint8_t> raw;
+  raw.reserve(size_t(h) * (1 + 3 * w));
+  for (int y = 0; y < h; y++) {
+    raw.push_back(0);
+    for (int x = 0; x < w; x++) {
+      uint8_t rgb[3];
+      toRgb888(rgb565[y * w + x], rgb);
+      raw.insert(raw.end(), rgb, rgb + 3);
+    }
+  }
+  uLongf zlen = compressBound(raw.size());
+  std::vector<uint8_t> z(zlen);
+  if (compress2(z.data(), &zlen, raw.data(), raw.size(), 9) != Z_OK)
+    return false;
+
+  std::vector<uint8_t> png(PNG_SIGNATURE, PNG_SIGNATURE + 8);
+  std::vector<uint8_t> ihdr;
+  putU32(ihdr, w);
+  putU32(ihdr, h);
+  ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0});  // 8 bit, RGB, no interlace
+  putChunk(png, "IHDR", ihdr.data(), ihdr.size());
+  putChunk(png, "IDAT", z.data(), zlen);
+  putChunk(png, "IEND", nullptr, 0);
+
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f)
+    return false;
+  const bool ok = fwrite(png.data(), 1, png.size(), f) == png.size();
+  return fclose(f) == 0 && ok;
+}
+
+static uint8_t paeth(int a, int b, int c) {
+  const int p = a + b - c;
+  const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  if (pa <= pb && pa <= pc)
+    return a;
+  return pb <= pc ? b : c;
+}
+
+bool readPng(const std::string& path, int* w, int* h,
+             std::vector<uint16_t>* rgb565) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f)
+    return false;
+  std::vector<uint8_t> png;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    png.insert(png.end(), buf, buf + n);
+  fclose(f);
+
+  if (png.size() < 8 || memcmp(png.data(), PNG_SIGNATURE, 8) != 0)
+    return false;
+
+  std::vector<uint8_t> z;
+  bool header = false;
+  for (size_t pos = 8; pos + 12 <= png.size();) {
+    const uint32_t length = getU32(&png[pos]);
+    if (pos + 12 + length > png.size())
+      return false;
+    const uint8_t* type = &png[pos + 4];
+    const uint8_t* data = &png[pos + 8];
+    if (!memcmp(type, "IHDR", 4)) {
+      *w = getU32(data);
+      *h = getU32(data + 4);
+      // only what writePng() produces
+      if (data[8] != 8 || data[9] != 2 || data[12] != 0)
+        return false;
+      header = true;
+    } else if (!memcmp(type, "IDAT", 4)) {
+      z.insert(z.end(), data, data + length);
+    } else if (!memcmp(type, "IEND", 4)) {
+      break;
+    }
+    pos += 12 + length;
+  }
+  if (!header)
+    return false;
+
+  const size_t stride = size_t(*w) * 3;
+  std::vector<uint8_t> raw(size_t(*h) * (stride + 1));
+  uLongf rawlen = raw.size();
+  if (uncompress(raw.data(), &rawlen, z.data(), z.size()) != Z_OK ||
+      rawlen != raw.size())
+    return false;
+
+  // undo the per-row filters in place
+  std::vector<uint8_t> prev(stride, 0);
+  rgb565->resize(size_t(*w) * *h);
+  for (int y = 0; y < *h; y++) {
+    const uint8_t filter = raw[y * (stride + 1)];
+    uint8_t* row = &raw[y * (stride + 1) + 1];
+    for (size_t i = 0; i < stride; i++) {
+      const int a = i >= 3 ? row[i - 3] : 0;
+      const int b = prev[i];
+      const int c = i >= 3 ? prev[i - 3] : 0;
+      switch (filter) {
+        case 0:
+          break;
+        case 1:
+          row[i] += a;
+          break;
+        case 2:
+          row[i] += b;
+          break;
+        case 3:
+          row[i] += (a + b) / 2;
+          break;
+        case 4:
+          row[i] += paeth(a, b, c);
+          break;
+        default:
+          return false;
+      }
+    }
+    for (int x = 0; x < *w; x++)
+      (*rgb565)[y * *w + x] = toRgb565(&row[x * 3]);
+    memcpy(prev.data(), row, stride);
+  }
+  return true;
+}
+
+// ─── comparison ──────────────────────────────────
+static int channelDiff(uint16_t a, uint16_t b) {
+  uint8_t ca[3], cb[3];
+  toRgb888(a, ca);
+  toRgb888(b, cb);
+  int d = 0;
+  for (int i = 0; i < 3; i++)
+    d = std::max(d, abs(ca[i] - cb[i]));
+  return d;
+}
+
+bool matches(const char* name, int w, int h, const uint16_t* rgb565,
+             Tolerance tolerance) {
+  const std::string fixture = std::string(GOLDEN_DIR "/") + name + ".png";
+
+  const char* update = getenv("GOLDEN_UPDATE");
+  if (update && *update && strcmp(update, "0") != 0) {
+    if (!writePng(fixture, w, h, rgb565)) {
+      fprintf(stderr, "golden %s: cannot write %s\n", name, fixture.c_str());
+      return false;
+    }
+    printf("golden %s: updated\n", name);
+    return true;
+  }
+
+  int ew = 0, eh = 0;
+  std::vector<uint16_t> expected;
+  if (!readPng(fixture, &ew, &eh, &expected)) {
+    fprintf(stderr,
+            "golden %s: cannot read %s (GOLDEN_UPDATE=1 creates it)\n", name,
+            fixture.c_str());
+    return false;
+  }
+  if (ew != w || eh != h) {
+    fprintf(stderr, "golden %s: size %dx%d, fixture %dx%d\n", name, w, h, ew,
+            eh);
+    return false;
+  }
+
+  uint32_t differing = 0;
+  int worst = 0;
+  std::vector<uint16_t> diff(size_t(w) * h);
+  for (int i = 0; i < w * h; i++) {
+    const int d = channelDiff(rgb565[i], expected[i]);
+    worst = std::max(worst, d);
+    if (d > tolerance.channel) {
+      differing++;
+      diff[i] = 0xF800;
+    } else {
+      // expected frame at quarter brightness
+      diff[i] = (expected[i] >> 2) & 0x39E7;
+    }
+  }
+  if (differing <= tolerance.maxPixels)
+    return true;
+
+  std::filesystem::create_directories(GOLDEN_OUT_DIR);
+  const std::string out = std::string(GOLDEN_OUT_DIR "/") + name;
+  writePng(out + ".actual.png", w, h, rgb565);
+  writePng(out + ".diff.png", w, h, diff.data());
+  fprintf(stderr,
+          "golden %s: %u pixels differ (allowed %u, largest channel "
+          "difference %d), see %s.diff.png\n",
+          name, differing, tolerance.maxPixels, worst, out.c_str());
+  return false;
+}
+
+}  // namespace golden
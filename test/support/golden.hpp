@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+ * Golden-frame comparison for RGB565 framebuffers.
+ *
+ * Fixtures are 8-bit RGB PNGs in test/golden/<name>.png. RGB565 is widened
+ * by bit replication (r8 = r5 << 3 | r5 >> 2), which is exact both ways, so
+ * a fixture reproduces the 565 framebuffer bit for bit.
+ *
+ * On a mismatch the actual frame and a diff image (differing pixels red,
+ * the rest the expected frame at quarter brightness) are written to the
+ * output directory as <name>.actual.png and <name>.diff.png.
+ *
+ * Running a test with GOLDEN_UPDATE=1 in the environment rewrites the
+ * fixtures from the current output instead of comparing.
+ */
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace golden {
+
+struct Tolerance {
+  int channel;        // largest per-channel difference (0..255) still equal
+  uint32_t maxPixels;  // differing pixels allowed
+};
+
+/// bit-exact: for frames that only depend on integer/fixed-point code
+constexpr Tolerance EXACT = {0, 0};
+/// for frames driven by the float simulation, where another compiler or
+/// libm may move single particles by a pixel
+constexpr Tolerance SIM = {0, 240 * 240 / 100};
+
+/// PNG I/O (8-bit RGB, non-interlaced) of an RGB565 image
+bool writePng(const std::string& path, int w, int h, const uint16_t* rgb565);
+bool readPng(const std::string& path, int* w, int* h,
+             std::vector<uint16_t>* rgb565);
+
+/// compares `rgb565` with the fixture `name`; prints the reason and writes
+/// the diff images on failure
+bool matches(const char* name, int w, int h, const uint16_t* rgb565,
+             Tolerance tolerance = EXACT);
+
+}  // namespace golden
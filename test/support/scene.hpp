@@ -0,0 +1,58 @@
+#pragma once
+
+// 确定性场景：固定种子、固定重力序列与步长，宿主机逐帧可复现
+
+#include <LovyanGFX.h>
+
+#include <memory>
+
+#include "FluidRenderer.hpp"
+#include "FluidSimulation.hpp"
+
+namespace scene {
+
+constexpr float DT = 1.0f / 30.0f;
+
+// 内存 RGB565 帧缓冲，尺寸同面板
+struct Frame : LGFX_Sprite {
+  Frame() { createSprite(SCREEN_WIDTH, SCREEN_HEIGHT); }
+  bool operator==(const Frame& o) const {
+    return memcmp(buffer(), o.buffer(),
+                  SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint16_t)) == 0;
+  }
+};
+
+inline void begin(FluidSimulation& sim) {
+  sim.setSeed(SIM_DEFAULT_SEED);
+  sim.setStagePrint(false);
+  sim.setGravity(0.0f, 10.0f);
+  sim.begin(nullptr);
+}
+
+// 第 f 帧的重力：静置 → 向右倾 → 猛晃向左上 → 回正（只用常数，不依赖 libm）
+inline void gravityAt(FluidSimulation& sim, int f) {
+  if (f < 30)
+    sim.setGravity(0.0f, 10.0f);
+  else if (f < 60)
+    sim.setGravity(7.0f, 7.0f);
+  else if (f < 75)
+    sim.setGravity(-9.0f, -4.0f);
+  else
+    sim.setGravity(0.0f, 10.0f);
+}
+
+inline void step(FluidSimulation& sim, int f) {
+  gravityAt(sim, f);
+  sim.simulate(DT);
+}
+
+// 全新渲染器整屏重绘当前模拟状态：局部刷新累积结果的参照
+inline std::unique_ptr<Frame> fullRedraw(const FluidSimulation& sim,
+                                         FluidRenderer::Mode mode) {
+  auto frame = std::make_unique<Frame>();
+  auto renderer = std::make_unique<FluidRenderer>(frame.get(), &sim);
+  renderer->render(mode);
+  return frame;
+}
+
+}  // namespace scene
@@ -0,0 +1,113 @@
+// Battery host tests: ADC scaling, the voltage low pass, the discharge
+// curve lookup and the runtime estimate, on the fake ADC.
+
+#include <Arduino.h>
+
+#include "battery.hpp"
+#include "check.hpp"
+
+namespace {
+
+// 4.095 V reference, no divider: one ADC count is exactly 1 mV
+Battery unitBattery() {
+  Battery b;
+  b.begin(29);
+  b.setVoltageRef(4.095f);
+  b.setVoltageDivider(1.0f);
+  return b;
+}
+
+uint8_t percentAt(Battery& b, int mv) {
+  host::adcValue = mv;
+  b.reset();
+  b.update();
+  return b.percent();
+}
+
+}  // namespace
+
+// the board's 1/3 divider and 3.3 V reference: within one ADC step
+TEST_CASE(scales_by_reference_and_divider) {
+  Battery b;
+  b.begin(29);
+  b.setVoltageDivider(1.0f / 3.0f);
+  host::adcValue = 1531;  // 3.700 V / 3 on 12 bit at 3.3 V
+  b.update();
+  CHECK_NEAR(b.millivolts(), 3700, 3);
+  float v;
+  b.voltage(&v);
+  CHECK_NEAR(v, 3.700f, 0.003f);
+
+  // a divider of 0 or less is ignored
+  b.setVoltageDivider(0.0f);
+  b.reset();
+  b.update();
+  CHECK_NEAR(b.millivolts(), 3700, 3);
+}
+
+// the first update sets the filter, later ones move 1/2^IIR_SHIFT of the way
+TEST_CASE(low_pass_follows_a_step) {
+  Battery b = unitBattery();
+  host::adcValue = 4000;
+  b.update();
+  CHECK_EQ(b.millivolts(), 4000);
+
+  host::adcValue = 3600;
+  b.update();
+  CHECK_EQ(b.millivolts(), 4000 - 400 / (1 << BATTERY_IIR_SHIFT));
+
+  float expected = 4000.0f - 400.0f / (1 << BATTERY_IIR_SHIFT);
+  for (int i = 1; i < 16; i++) {
+    b.update();
+    expected -= (expected - 3600.0f) / (1 << BATTERY_IIR_SHIFT);
+  }
+  CHECK_NEAR(b.millivolts(), expected, 2.0f);
+
+  // converged, and reset() takes the next sample directly again
+  for (int i = 0; i < 100; i++)
+    b.update();
+  CHECK_NEAR(b.millivolts(), 3600, 1);
+  host::adcValue = 3900;
+  b.reset();
+  b.update();
+  CHECK_EQ(b.millivolts(), 3900);
+}
+
+// table points exactly, linear in between, clamped outside
+TEST_CASE(lipo_curve_lookup) {
+  Battery b = unitBattery();
+  CHECK_EQ(percentAt(b, 3790), 50);
+  CHECK_EQ(percentAt(b, 3810), 55);
+  CHECK_EQ(percentAt(b, 3650), 17);  // 10 + 50 * 15 / 100
+  CHECK_EQ(percentAt(b, 3300), 0);
+  CHECK_EQ(percentAt(b, 3000), 0);
+  CHECK_EQ(percentAt(b, 4200), 100);
+  CHECK_EQ(percentAt(b, 4300), 100);
+
+  float p;
+  percentAt(b, 3790);
+  b.percentage(&p);
+  CHECK_NEAR(p, 0.50f, 1e-6f);
+}
+
+// the curve can be swapped; a table of fewer than two points is ignored
+TEST_CASE(liion_curve_lookup) {
+  Battery b = unitBattery();
+  const int n =
+      sizeof(battery_curve_liion) / sizeof(battery_curve_liion[0]);
+  b.setDischargeCurve(battery_curve_liion, n);
+  CHECK_EQ(percentAt(b, 3000), 0);
+  CHECK_EQ(percentAt(b, 3700), 40);
+  CHECK_EQ(percentAt(b, 3750), 49);
+  b.setDischargeCurve(battery_curve_lipo, 1);
+  CHECK_EQ(percentAt(b, 3700), 40);
+}
+
+// 50 % of 500 mAh at 100 mA: 150 min; no draw: no estimate
+TEST_CASE(runtime_estimate) {
+  Battery b = unitBattery();
+  percentAt(b, 3790);
+  CHECK_EQ(b.runtimeMinutes(100.0f), 150u);
+  CHECK_EQ(b.runtimeMinutes(0.0f), 0u);
+  CHECK_EQ(b.runtimeMinutes(-1.0f), 0u);
+}
@@ -0,0 +1,136 @@
+// 逐格统计 CellStats：三种引擎导出的定点统计与粒子数据自洽
+
+#include <math.h>
+#include <string.h>
+
+#include <memory>
+
+#include "FluidSimulation.hpp"
+#include "MpmSimulation.hpp"
+#include "ParticleSimulation.hpp"
+#include "SphSimulation.hpp"
+#include "check.hpp"
+#include "fake_sim.hpp"
+#include "scene.hpp"
+
+static constexpr int GS = FluidSimulation::GS;
+
+// 逐粒子重算（与 updateCellStats 同一定点约定）后对照导出的统计
+static void checkConsistent(const FluidSimulation& sim) {
+  const CellStats& st = sim.cellStats();
+  const Particle* P = sim.data();
+  const int n = sim.particleCount();
+
+  // 占有量守恒：每个粒子分摊 256，权重截断每粒子最多丢 4
+  uint32_t occSum = 0;
+  for (int i = 0; i < GS * GS; ++i)
+    occSum += st.occ[i];
+  CHECK(occSum <= uint32_t(n) * 256);
+  CHECK(occSum + uint32_t(n) * 4 >= uint32_t(n) * 256);
+
+  // 汇总计数与逐格数据一致
+  int fluid = 0, foam = 0;
+  for (int gx = 0; gx < GS; ++gx) {
+    foam += __builtin_popcount(st.foam[gx]);
+    for (int gy = 0; gy < GS; ++gy) {
+      if (st.occ[gx * GS + gy] >= 128)
+        fluid++;
+      if (st.isFoam(gx, gy))
+        CHECK(st.occ[gx * GS + gy] > 0);
+    }
+  }
+  CHECK_EQ(st.fluidCells, fluid);
+  CHECK_EQ(st.foamCells, foam);
+
+  // 平均 / 最大速度：分量截断到 Q8，模长取整数平方根后求和
+  uint32_t total = 0, vmax = 0;
+  for (int p = 0; p < n; ++p) {
+    const double qx = int32_t(P[p].vx * 256.f), qy = int32_t(P[p].vy * 256.f);
+    const uint32_t s = uint32_t(floor(sqrt(qx * qx + qy * qy)));
+    total += s;
+    vmax = s > vmax ? s : vmax;
+  }
+  CHECK(st.meanSpeed <= st.maxSpeed);
+  CHECK_EQ(st.meanSpeed, n ? total / n : 0);
+  CHECK_EQ(st.maxSpeed, vmax);
+}
+
+// 统计有自己的计时阶段，进分阶段打印与功耗记账
+template <typename Sim>
+static void runEngine() {
+  auto sim = std::make_unique<Sim>();
+  const int last = sim->stageCount() - 1;
+  CHECK(last < FluidSimulation::STAGE_MAX);
+  CHECK_EQ(strcmp(sim->stageName(last), "Stat"), 0);
+  scene::begin(*sim);
+  for (int f = 0; f < 90; f++) {
+    scene::step(*sim, f);
+    if (f % 15 == 14)
+      checkConsistent(*sim);
+  }
+}
+
+TEST_CASE(flip_stats_are_consistent) { runEngine<ParticleSimulation>(); }
+TEST_CASE(mpm_stats_are_consistent) { runEngine<MpmSimulation>(); }
+TEST_CASE(sph_stats_are_consistent) { runEngine<SphSimulation>(); }
+
+// ─── 手工摆放 ─────────────────────────────────────
+// 粒子正好在格心：整格 256，邻格为 0
+TEST_CASE(particle_on_cell_center_fills_one_cell) {
+  FakeSimulation sim;
+  sim.addParticle((8 + 0.5f) / GS, (10 + 0.5f) / GS);
+  sim.refreshStats();
+  const CellStats& st = sim.cellStats();
+  CHECK_EQ(st.occ[8 * GS + 10], 256);
+  CHECK_EQ(st.occ[9 * GS + 10], 0);
+  CHECK_EQ(st.occ[8 * GS + 11], 0);
+  CHECK_EQ(st.fluidCells, 1);
+}
+
+// 液面上孤立的快粒子是泡沫候选；同速度但埋在液体里（占有量高）的不是
+TEST_CASE(foam_needs_speed_and_low_occupancy) {
+  const float fast = SIM_FOAM_SPEED * 2.0f;
+  FakeSimulation lone;
+  lone.addParticle((4 + 0.5f) / GS, (6 + 0.5f) / GS, fast, 0.0f);
+  lone.refreshStats();
+  CHECK(lone.cellStats().isFoam(4, 6));
+  CHECK_EQ(lone.cellStats().foamCells, 1);
+
+  FakeSimulation slow;
+  slow.addParticle((4 + 0.5f) / GS, (6 + 0.5f) / GS, SIM_FOAM_SPEED * 0.5f,
+                   0.0f);
+  slow.refreshStats();
+  CHECK_EQ(slow.cellStats().foamCells, 0);
+
+  FakeSimulation buried;
+  for (int i = 0; i < 4; ++i)
+    buried.addParticle((4 + 0.5f) / GS, (6 + 0.5f) / GS, fast, 0.0f);
+  buried.refreshStats();
+  CHECK_EQ(buried.cellStats().occ[4 * GS + 6], 4 * 256);
+  CHECK(!buried.cellStats().isFoam(4, 6));
+  CHECK_EQ(buried.cellStats().speed[4 * GS + 6], uint16_t(fast * 256));
+}
+
+// 同样快、同样稀的格：浪尖（只有下方一排液体）是候选，平直液面
+// （左右也是液体）与液体包围中的空洞不是
+TEST_CASE(foam_needs_a_convex_surface) {
+  const float fast = SIM_FOAM_SPEED * 2.0f;
+  auto surface = [&](bool sides, bool above) {
+    auto sim = std::make_unique<FakeSimulation>();
+    sim->addParticle((4 + 0.5f) / GS, (6 + 0.5f) / GS, fast, 0.0f);
+    for (int gx = 3; gx <= 5; ++gx) {
+      sim->addParticle((gx + 0.5f) / GS, (7 + 0.5f) / GS);
+      if (above)
+        sim->addParticle((gx + 0.5f) / GS, (5 + 0.5f) / GS);
+    }
+    if (sides) {
+      sim->addParticle((3 + 0.5f) / GS, (6 + 0.5f) / GS);
+      sim->addParticle((5 + 0.5f) / GS, (6 + 0.5f) / GS);
+    }
+    sim->refreshStats();
+    return sim->cellStats().isFoam(4, 6);
+  };
+  CHECK(surface(false, false));
+  CHECK(!surface(true, false));
+  CHECK(!surface(true, true));
+}
@@ -0,0 +1,150 @@
+// DvfsGovernorRP2040 host tests: step-up / step-down thresholds, the
+// down-step delay, and voltage-before-clock ordering, on the clock and
+// regulator shims.
+
+#include <Arduino.h>
+
+#include "LowPowerDvfsRP2040.h"
+#include "check.hpp"
+
+using namespace low_power;
+
+namespace {
+
+constexpr uint32_t FRAME_US = 33333;  // 30 fps
+
+int callbacks = 0;
+uint32_t lastCallbackKhz = 0;
+void onClock(uint32_t khz) {
+  callbacks++;
+  lastCallbackKhz = khz;
+}
+
+// busy time of a frame of `cycles` at the current clock
+uint32_t busyUs(uint64_t cycles) {
+  return uint32_t(cycles * 1000 / (clock_get_hz(clk_sys) / 1000));
+}
+
+// runs `frames` frames of `cycles`; returns the number of point changes
+int run(DvfsGovernorRP2040& g, uint64_t cycles, int frames) {
+  int changes = 0;
+  for (int i = 0; i < frames; i++)
+    changes += g.update(busyUs(cycles));
+  return changes;
+}
+
+int indexOf(uint32_t khz) {
+  for (int i = 0; i < 6; i++)
+    if (rp2040_operating_points[i].khz == khz)
+      return i;
+  return -1;
+}
+
+// the voltage in place when the clock changes has to cover the faster of
+// the old and the new frequency
+bool voltageCovers(uint32_t khz) {
+  const uint32_t top = khz > host::sysKhz ? khz : host::sysKhz;
+  const int i = indexOf(top);
+  CHECK(i >= 0);
+  CHECK(host::vregVoltage >= rp2040_operating_points[i].voltage);
+  return true;
+}
+
+DvfsGovernorRP2040 started() {
+  host::onSysClock = voltageCovers;
+  callbacks = 0;
+  DvfsGovernorRP2040 g;
+  CHECK(g.begin(FRAME_US, onClock));
+  return g;
+}
+
+}  // namespace
+
+TEST_CASE(begins_at_the_top_point) {
+  host::sysKhz = 125000;
+  host::vregVoltage = VREG_VOLTAGE_1_00;
+  DvfsGovernorRP2040 g = started();
+  CHECK_EQ(g.getIndex(), 5);
+  CHECK_EQ(g.getKhz(), 240000u);
+  CHECK_EQ(host::sysKhz, 240000u);
+  CHECK_EQ(host::vregVoltage, VREG_VOLTAGE_1_10);
+  CHECK_EQ(callbacks, 1);
+  CHECK_EQ(lastCallbackKhz, 240000u);
+}
+
+// 2.4 M cycles: 10 ms at 240 MHz. The lowest point under 70 % of the frame
+// is 125 MHz (19.2 ms); it is taken after DVFS_DOWN_FRAMES frames, not
+// before
+TEST_CASE(steps_down_after_the_delay) {
+  DvfsGovernorRP2040 g = started();
+  CHECK_EQ(run(g, 2400000, DVFS_DOWN_FRAMES - 1), 0);
+  CHECK_EQ(g.getIndex(), 5);
+  CHECK_EQ(run(g, 2400000, 1), 1);
+  CHECK_EQ(g.getKhz(), 125000u);
+  CHECK_EQ(host::vregVoltage, VREG_VOLTAGE_1_00);
+  CHECK_EQ(lastCallbackKhz, 125000u);
+
+  // settled: no further changes
+  CHECK_EQ(run(g, 2400000, 100), 0);
+  CHECK_EQ(g.getCycles(), 2400000u);
+}
+
+// a heavier frame that would miss 90 % of the deadline moves up at once,
+// straight to the lowest point that fits it
+TEST_CASE(steps_up_immediately) {
+  DvfsGovernorRP2040 g = started();
+  run(g, 2400000, DVFS_DOWN_FRAMES);
+  CHECK_EQ(g.getKhz(), 125000u);
+
+  // 5 M cycles: 40 ms at 125 MHz, 25 ms at 200 MHz
+  CHECK_EQ(run(g, 5000000, 1), 1);
+  CHECK_EQ(g.getKhz(), 200000u);
+  CHECK_EQ(host::vregVoltage, VREG_VOLTAGE_1_10);
+}
+
+// between the two thresholds nothing moves: 3 M cycles take 24 ms at
+// 125 MHz (72 %, under UP_LOAD) and 31 ms at 96 MHz (over DOWN_LOAD)
+TEST_CASE(holds_between_thresholds) {
+  DvfsGovernorRP2040 g = started();
+  run(g, 2400000, DVFS_DOWN_FRAMES);
+  CHECK_EQ(g.getKhz(), 125000u);
+  CHECK_EQ(run(g, 3000000, 200), 0);
+  CHECK_EQ(g.getKhz(), 125000u);
+}
+
+// a frame over UP_LOAD restarts the down-step delay (a merely busier frame
+// does not: the decision to go down follows the average)
+TEST_CASE(down_delay_restarts_on_an_overloaded_frame) {
+  DvfsGovernorRP2040 g = started();
+  run(g, 2400000, DVFS_DOWN_FRAMES - 1);
+  run(g, 8000000, 1);  // 33 ms at 240 MHz, over 90 % even at the top
+  CHECK_EQ(g.getIndex(), 5);
+  CHECK_EQ(run(g, 2400000, DVFS_DOWN_FRAMES - 1), 0);
+  CHECK_EQ(g.getIndex(), 5);
+}
+
+// a longer deadline (low battery: 20 fps) lets the same work run slower
+TEST_CASE(longer_deadline_allows_a_lower_point) {
+  DvfsGovernorRP2040 g = started();
+  run(g, 2400000, DVFS_DOWN_FRAMES);
+  CHECK_EQ(g.getKhz(), 125000u);
+  g.setDeadline(50000);
+  CHECK_EQ(g.getDeadline(), 50000u);
+  run(g, 2400000, DVFS_DOWN_FRAMES);
+  CHECK_EQ(g.getKhz(), 96000u);  // 25 ms ≤ 35 ms
+}
+
+// a frequency the PLL cannot make: nothing changes, the point stays
+TEST_CASE(unreachable_point_is_not_applied) {
+  DvfsGovernorRP2040 g = started();
+  host::onSysClock = [](uint32_t khz) { return khz != 125000; };
+  const int before = callbacks;
+  CHECK_EQ(run(g, 2400000, DVFS_DOWN_FRAMES), 0);
+  CHECK_EQ(g.getIndex(), 5);
+  CHECK_EQ(host::sysKhz, 240000u);
+  CHECK_EQ(host::vregVoltage, VREG_VOLTAGE_1_10);
+  CHECK_EQ(callbacks, before);
+  CHECK(!g.setIndex(2));
+  CHECK(g.setIndex(1));
+  CHECK_EQ(host::sysKhz, 96000u);
+}
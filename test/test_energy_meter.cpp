@@ -0,0 +1,189 @@
+// EnergyMeter host tests: the ledger per state, operating point and stage,
+// the current model and the report, on hand-picked timestamps.
+
+#include <Arduino.h>
+
+#include <string>
+
+#include "EnergyMeter.hpp"
+#include "check.hpp"
+
+namespace {
+
+enum { RUN, DORMANT };
+const EnergyStateModel STATES[] = {
+    {"running", 10000, true},
+    {"dormant", 100, false},
+};
+const char* const STAGES[] = {"sim", "render"};
+
+constexpr uint64_t S = 1000000;  // µs
+
+EnergyMeter started() {
+  EnergyMeter m;
+  m.begin(STATES, 2, STAGES, 2, 0, RUN, 100000);
+  return m;
+}
+
+struct Capture : Print {
+  std::string text;
+  size_t write(const uint8_t* buffer, size_t size) override {
+    text.append(reinterpret_cast<const char*>(buffer), size);
+    return size;
+  }
+};
+
+bool contains(const std::string& s, const char* part) {
+  return s.find(part) != std::string::npos;
+}
+
+}  // namespace
+
+// 1 s running at 100 MHz, 25 % busy, then 9 s dormant: cycles at the clock
+// they ran at, base current × time, entries per state
+TEST_CASE(state_ledger) {
+  EnergyMeter m = started();
+  m.addBusy(250000);
+  m.setState(DORMANT, 1 * S);
+  m.setState(RUN, 10 * S);
+
+  const EnergyMeter::Slot& run = m.stateSlot(RUN);
+  CHECK_EQ(run.us, 1 * S);
+  CHECK_EQ(run.busy_cycles, 25000000u);
+  CHECK_EQ(run.idle_cycles, 75000000u);
+  CHECK_EQ(run.base_ua_us, 10000 * S);
+  CHECK_EQ(run.entries, 2u);
+
+  const EnergyMeter::Slot& dormant = m.stateSlot(DORMANT);
+  CHECK_EQ(dormant.us, 9 * S);
+  CHECK_EQ(dormant.busy_cycles, 0u);
+  CHECK_EQ(dormant.idle_cycles, 0u);
+  CHECK_EQ(dormant.base_ua_us, 100 * 9 * S);
+  CHECK_EQ(dormant.entries, 1u);
+
+  // (1e10 + 25e6·90 + 75e6·25) µA·µs running + 9e8 dormant
+  CHECK_NEAR(m.chargeMicroAh(10 * S), 14.125e9f / 3.6e9f + 0.25f, 1e-4f);
+  CHECK_NEAR(m.averageMilliamps(10 * S), (14.125e9f + 9e8f) / 10e6f / 1000,
+             1e-4f);
+
+  // a repeated or unknown state is not an entry
+  m.setState(RUN, 11 * S);
+  m.setState(5, 11 * S);
+  CHECK_EQ(m.stateSlot(RUN).entries, 2u);
+}
+
+// time splits by operating point; dormant time has no point (core off)
+TEST_CASE(operating_point_ledger) {
+  EnergyMeter m = started();
+  m.setClock(50000, S / 2);
+  m.setClock(50000, S);  // unchanged: no new interval
+  m.setState(DORMANT, 2 * S);
+  m.setClock(100000, 3 * S);
+  m.setState(RUN, 4 * S);
+  m.chargeMicroAh(5 * S);
+
+  const EnergyMeter::Slot* fast = m.pointSlot(100000);
+  const EnergyMeter::Slot* slow = m.pointSlot(50000);
+  CHECK(fast && slow);
+  CHECK(m.pointSlot(125000) == nullptr);
+  CHECK_EQ(fast->us, S / 2 + 1 * S);
+  CHECK_EQ(fast->entries, 2u);
+  CHECK_EQ(slow->us, 3 * S / 2);
+  CHECK_EQ(slow->entries, 1u);
+  CHECK_EQ(slow->idle_cycles, 75000000u);  // 1.5 s at 50 MHz, all idle
+  CHECK_EQ(m.stateSlot(DORMANT).us, 2 * S);
+}
+
+// busy time over the interval counts as the whole interval, not more
+TEST_CASE(busy_is_capped_by_the_interval) {
+  EnergyMeter m = started();
+  m.addBusy(3 * S);
+  m.chargeMicroAh(1 * S);
+  CHECK_EQ(m.stateSlot(RUN).busy_cycles, 100000000u);
+  CHECK_EQ(m.stateSlot(RUN).idle_cycles, 0u);
+}
+
+// I = base + f · (busy · load + idle · (1 − load)); no core term when off
+TEST_CASE(current_model) {
+  EnergyMeter m = started();
+  CHECK_NEAR(m.modelMilliamps(RUN, 100000, 0.5f), 15.75f, 1e-4f);
+  CHECK_NEAR(m.modelMilliamps(RUN, 100000, 2.0f), 19.0f, 1e-4f);
+  CHECK_NEAR(m.modelMilliamps(DORMANT, 100000, 1.0f), 0.1f, 1e-6f);
+  CHECK_EQ(m.modelMilliamps(2, 100000, 0.5f), 0.0f);
+
+  m.setCoreModel(100, 0);
+  CHECK_NEAR(m.modelMilliamps(RUN, 100000, 0.5f), 15.0f, 1e-4f);
+}
+
+// reset() forgets the ledger and the battery reference
+TEST_CASE(reset_clears_the_ledger) {
+  EnergyMeter m = started();
+  m.addBusy(1000);
+  m.setState(DORMANT, S);
+  m.setBattery(4000, 80, S);
+  m.reset(2 * S);
+  CHECK_EQ(m.stateSlot(RUN).us, 0u);
+  CHECK_EQ(m.stateSlot(DORMANT).us, 0u);
+  // the state and point it resets in are entered again
+  CHECK_EQ(m.stateSlot(DORMANT).entries, 1u);
+  CHECK_EQ(m.stateSlot(RUN).entries, 0u);
+  const EnergyMeter::Slot* point = m.pointSlot(100000);
+  CHECK(point && point->us == 0 && point->entries == 1);
+  CHECK_EQ(m.chargeMicroAh(2 * S), 0.0f);
+  Capture out;
+  m.setBattery(3900, 70, 3 * S);
+  m.report(out, 3 * S);
+  CHECK(!contains(out.text, "battery"));  // one sample since the reset
+}
+
+// report: the tables, stage rows and the measured drain next to the model;
+// no dormant note without a dormant entry
+TEST_CASE(report_shows_model_and_battery) {
+  EnergyMeter m = started();
+  m.setCapacity(500);
+  m.setBattery(4000, 80, 0);
+  m.addBusy(S / 2);
+  m.addStage(0, S / 4);
+  m.addStage(1, S / 4);
+  m.addStage(2, S);  // unknown stage: ignored
+  m.setBattery(3900, 70, 3600 * S);
+
+  Capture out;
+  m.report(out, 3600 * S);
+  CHECK(contains(out.text, "energy: 3600.0 s"));
+  CHECK(contains(out.text, "running"));
+  CHECK(contains(out.text, "  100 "));
+  CHECK(contains(out.text, "sim"));
+  CHECK(contains(out.text, "render"));
+  // 10 % of 500 mAh in one hour
+  CHECK(contains(out.text, "battery 4000 -> 3900 mV, 80 -> 70%"));
+  CHECK(contains(out.text, "50.00 mAh per hour measured"));
+  CHECK(!contains(out.text, "timer stops"));
+}
+
+// the timer stops in dormant: the drop across a dormant interval is not
+// divided by awake time, the reference restarts with the first sample after
+// the wake, and the report says dormant time is not measured
+TEST_CASE(dormant_restarts_the_battery_reference) {
+  EnergyMeter m = started();
+  m.setCapacity(500);
+  m.setBattery(4000, 90, 0);
+  m.setBattery(3990, 89, 600 * S);
+  m.setState(DORMANT, 600 * S);
+  m.setState(RUN, 601 * S);  // hours asleep, barely any timer time
+
+  Capture asleep;
+  m.setBattery(3900, 70, 601 * S);
+  m.report(asleep, 601 * S);
+  CHECK(!contains(asleep.text, "battery 4000"));
+  CHECK(!contains(asleep.text, "measured"));  // one sample since the wake
+  CHECK(contains(asleep.text, "dormant: timer stops, its time is not counted"));
+
+  // 10 % of 500 mAh in the hour after the wake
+  Capture awake;
+  m.setBattery(3800, 60, 601 * S + 3600 * S);
+  m.report(awake, 601 * S + 3600 * S);
+  CHECK(contains(awake.text, "battery 3900 -> 3800 mV, 70 -> 60%"));
+  CHECK(contains(awake.text, "50.00 mAh per hour measured"));
+}
+
@@ -0,0 +1,257 @@
+// GravityFilter host tests: fixed-point gyro / quaternion propagation (with
+// missed increments), accelerometer correction and its rejection of shaking,
+// on the fake clock.
+
+#include <Arduino.h>
+
+#include <math.h>
+
+#include "GravityFilter.hpp"
+#include "check.hpp"
+
+namespace {
+
+constexpr float DEG = 3.14159265f / 180.0f;
+constexpr uint32_t STEP_US = 4000;  // 250 Hz
+
+// a device turning about its x axis; acc = gravity + shake along x. With an
+// AE period it also has an AttitudeEngine: one increment per period, kept
+// until the next one overwrites it, readable once.
+struct Turntable : ImuSource {
+  float angle = 0.0f;      // rad, gravity is (0, sin, cos) in the sensor frame
+  float rate = 0.0f;       // dps
+  float shake = 0.0f;      // g, added to x
+  float gyroError = 0.0f;  // dps, added to the gyro output only
+  uint32_t aePeriodUs = 0;  // 0: no AttitudeEngine
+  bool aeStalled = false;
+  uint32_t aeUs = 0;        // time since the last AE sample
+  float aeAngle = 0.0f;     // angle at the last AE sample
+  float aeDelta = 0.0f;     // its increment
+  bool aeNew = false;
+  int gyroReads = 0;
+
+  bool readAccelerometer(float* ax, float* ay, float* az) override {
+    *ax = shake;
+    *ay = sinf(angle);
+    *az = cosf(angle);
+    return true;
+  }
+  bool readGyroscope(float* gx, float* gy, float* gz) override {
+    gyroReads++;
+    *gx = rate + gyroError;
+    *gy = 0.0f;
+    *gz = 0.0f;
+    return true;
+  }
+  bool readRotationIncrement(int16_t* dq) override {
+    if (!aeNew)
+      return false;
+    aeNew = false;
+    dq[0] = int16_t(lroundf(cosf(aeDelta / 2) * 16384));
+    dq[1] = int16_t(lroundf(sinf(aeDelta / 2) * 16384));
+    dq[2] = dq[3] = 0;
+    return true;
+  }
+
+  void step(uint32_t us) {
+    host::advanceUs(us);
+    angle += rate * DEG * us * 1e-6f;
+    if (!aePeriodUs)
+      return;
+    for (aeUs += us; aeUs >= aePeriodUs; aeUs -= aePeriodUs) {
+      // the sample fell aeUs − period before now
+      const float at = angle - rate * DEG * (aeUs - aePeriodUs) * 1e-6f;
+      aeDelta = at - aeAngle;
+      aeAngle = at;
+      aeNew = !aeStalled;
+    }
+  }
+};
+
+float norm(const int32_t* g) {
+  const float x = g[0] / 65536.0f, y = g[1] / 65536.0f, z = g[2] / 65536.0f;
+  return sqrtf(x * x + y * y + z * z);
+}
+
+// estimated tilt about x, rad
+float tilt(const GravityFilter& f) {
+  return atan2f(f.gravityQ16()[1], f.gravityQ16()[2]);
+}
+
+// 90 °/s for about a second, then still; the tilt error at the end
+float turnAndStop(Turntable& t, GravityFilter& f, uint32_t step_us) {
+  f.begin(&t);
+  f.update();
+  t.rate = 90.0f;
+  for (uint32_t us = 0; us < 1000000; us += step_us) {
+    t.step(step_us);
+    f.update();
+  }
+  t.rate = 0.0f;
+  for (uint32_t us = 0; us < 200000; us += step_us) {
+    t.step(step_us);
+    f.update();
+  }
+  return tilt(f) - t.angle;
+}
+
+}  // namespace
+
+// the first update takes the accelerometer, normalised to 1 g
+TEST_CASE(starts_from_normalised_acc) {
+  Turntable t;
+  t.angle = 30 * DEG;
+  t.shake = 0.1f;
+  GravityFilter f;
+  f.begin(&t);
+  CHECK(f.update());
+  CHECK_NEAR(norm(f.gravityQ16()), 1.0f, 0.002f);
+  CHECK_NEAR(tilt(f), 30 * DEG, 0.002f);
+}
+
+// 90 °/s for one second, gyro only: the estimate follows within a degree
+TEST_CASE(gyro_propagation_tracks_rotation) {
+  Turntable t;
+  GravityFilter f;
+  f.begin(&t);
+  f.update();
+
+  t.rate = 90.0f;
+  float worst = 0.0f;
+  for (int i = 0; i < 250; i++) {
+    t.step(STEP_US);
+    f.update();
+    worst = fmaxf(worst, fabsf(tilt(f) - t.angle));
+  }
+  CHECK_NEAR(t.angle, 90 * DEG, 0.001f);
+  CHECK(worst < 1.0f * DEG);
+  CHECK_NEAR(norm(f.gravityQ16()), 1.0f, 0.005f);
+}
+
+// the same rotation from AttitudeEngine increments instead of the gyro
+TEST_CASE(quaternion_propagation_tracks_rotation) {
+  Turntable t;
+  t.aePeriodUs = STEP_US;
+  GravityFilter f;
+  f.begin(&t);
+  f.setUseRotationIncrement(true, STEP_US);
+  f.update();
+
+  t.rate = 90.0f;
+  float worst = 0.0f;
+  for (int i = 0; i < 250; i++) {
+    t.step(STEP_US);
+    f.update();
+    worst = fmaxf(worst, fabsf(tilt(f) - t.angle));
+  }
+  CHECK(worst < 1.0f * DEG);
+  CHECK_NEAR(norm(f.gravityQ16()), 1.0f, 0.005f);
+}
+
+// a wrong estimate is pulled to the acc with time constant TAU
+TEST_CASE(acc_correction_has_time_constant) {
+  Turntable t;
+  GravityFilter f;
+  f.begin(&t);
+  f.update();  // g = (0, 0, 1)
+
+  t.angle = 20 * DEG;  // tilted without the gyro noticing
+  const int tau_steps = GRAVITY_FILTER_TAU_MS * 1000 / STEP_US;
+  for (int i = 0; i < tau_steps; i++) {
+    t.step(STEP_US);
+    f.update();
+  }
+  // 1 − e⁻¹ of the way there
+  CHECK_NEAR(tilt(f), 20 * DEG * 0.632f, 1.0f * DEG);
+  for (int i = 0; i < 4 * tau_steps; i++) {
+    t.step(STEP_US);
+    f.update();
+  }
+  CHECK_NEAR(tilt(f), 20 * DEG, 0.5f * DEG);
+}
+
+// |a| far from 1 g: no correction, and the shake shows as linear acceleration
+TEST_CASE(shaking_does_not_leak_into_gravity) {
+  Turntable t;
+  GravityFilter f;
+  f.begin(&t);
+  f.update();
+
+  float worst = 0.0f;
+  for (int i = 0; i < 200; i++) {
+    t.shake = (i & 1) ? 0.8f : -0.8f;
+    t.step(STEP_US);
+    f.update();
+    worst = fmaxf(worst, fabsf(f.gravityQ16()[0] / 65536.0f));
+    CHECK_NEAR(f.linearAccelerationQ16()[0] / 65536.0f, t.shake, 0.01f);
+  }
+  CHECK(worst < 0.001f);
+}
+
+// a gap longer than MAX_DT restarts from the accelerometer
+TEST_CASE(long_gap_restarts_from_acc) {
+  Turntable t;
+  GravityFilter f;
+  f.begin(&t);
+  f.update();
+
+  t.angle = 45 * DEG;
+  host::advanceUs((GRAVITY_FILTER_MAX_DT_MS + 1) * 1000u);
+  f.update();
+  CHECK_NEAR(tilt(f), 45 * DEG, 0.002f);
+
+  // reset() does the same without the gap
+  t.angle = -30 * DEG;
+  f.reset();
+  t.step(STEP_US);
+  f.update();
+  CHECK_NEAR(tilt(f), -30 * DEG, 0.002f);
+}
+
+// a gyro read after an update returns that step's sample without a new read
+TEST_CASE(gyro_read_reuses_the_filter_sample) {
+  Turntable t;
+  t.rate = 12.5f;
+  GravityFilter f;
+  f.begin(&t);
+  float ax, ay, az, gx, gy, gz;
+  CHECK(f.readAccelerometer(&ax, &ay, &az));
+  CHECK_EQ(t.gyroReads, 1);
+  CHECK(f.readGyroscope(&gx, &gy, &gz));
+  CHECK_EQ(t.gyroReads, 1);
+  CHECK_NEAR(gx, 12.5f, 0.001f);
+  // a second read without an update goes to the source
+  CHECK(f.readGyroscope(&gx, &gy, &gz));
+  CHECK_EQ(t.gyroReads, 2);
+}
+
+// polled faster than the AE rate: every increment is applied exactly once
+// and the (here wrong) gyro is not used
+TEST_CASE(each_increment_is_applied_once) {
+  Turntable t;
+  t.aePeriodUs = 31250;  // 32 Hz
+  t.gyroError = 30.0f;
+  GravityFilter f;
+  f.setUseRotationIncrement(true, t.aePeriodUs);
+  CHECK_NEAR(turnAndStop(t, f, STEP_US), 0.0f, 1.0f * DEG);
+}
+
+// polled slower than the AE rate: increments are overwritten unread, the
+// gyro covers the time instead of dropping it
+TEST_CASE(missed_increments_fall_back_to_the_gyro) {
+  Turntable t;
+  t.aePeriodUs = STEP_US;
+  GravityFilter f;
+  f.setUseRotationIncrement(true, STEP_US);
+  CHECK_NEAR(turnAndStop(t, f, 2 * STEP_US + 500), 0.0f, 1.0f * DEG);
+}
+
+// no increments at all (engine stalled or off): the gyro takes over
+TEST_CASE(stalled_engine_falls_back_to_the_gyro) {
+  Turntable t;
+  t.aePeriodUs = 31250;
+  t.aeStalled = true;
+  GravityFilter f;
+  f.setUseRotationIncrement(true, t.aePeriodUs);
+  CHECK_NEAR(turnAndStop(t, f, STEP_US), 0.0f, 1.0f * DEG);
+}
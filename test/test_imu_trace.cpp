@@ -0,0 +1,194 @@
+// ImuTrace host tests: recorder framing and replay timing, including the
+// loop wrap and the overshoot carried across it.
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "ImuTrace.hpp"
+#include "check.hpp"
+
+namespace {
+
+struct Buffer : Print {
+  std::vector<uint8_t> bytes;
+  using Print::write;
+  size_t write(const uint8_t* b, size_t n) override {
+    bytes.insert(bytes.end(), b, b + n);
+    return n;
+  }
+};
+
+// record i carries ax = i g; dt in 100 µs units
+std::vector<uint8_t> makeTrace(std::initializer_list<uint16_t> dts) {
+  Buffer out;
+  ImuTraceHeader header = {IMU_TRACE_MAGIC, IMU_TRACE_VERSION,
+                           sizeof(ImuTraceRecord), IMU_TRACE_ACC_UNIT_UG,
+                           IMU_TRACE_GYRO_UNIT_MDPS};
+  out.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+  int16_t i = 0;
+  for (uint16_t dt : dts) {
+    ImuTraceRecord r = {dt, {int16_t(i * 1000), 0, 1000}, {0, 0, 0}};
+    out.write(reinterpret_cast<const uint8_t*>(&r), sizeof(r));
+    i++;
+  }
+  return out.bytes;
+}
+
+int recordAt(ImuTraceReplay& replay) {
+  float ax, ay, az;
+  CHECK(replay.readAccelerometer(&ax, &ay, &az));
+  return int(lroundf(ax));
+}
+
+// a moving source: every read returns a new value
+struct Ramp : ImuSource {
+  int n = 0;
+  bool readAccelerometer(float* ax, float* ay, float* az) override {
+    *ax = 0.01f * n;
+    *ay = -0.5f;
+    *az = 1.0f;
+    return true;
+  }
+  bool readGyroscope(float* gx, float* gy, float* gz) override {
+    *gx = 1.5f * n++;
+    *gy = 0.0f;
+    *gz = -2.0f;
+    return true;
+  }
+};
+
+}  // namespace
+
+// records 0, 1, 2 start at 0, 10 and 30 ms
+TEST_CASE(step_mode_follows_record_intervals) {
+  auto trace = makeTrace({0, 100, 200});
+  ImuTraceReplay replay;
+  CHECK(replay.begin(trace.data(), trace.size(), false));
+  CHECK_EQ(replay.recordCount(), 3u);
+
+  CHECK_EQ(recordAt(replay), 0);
+  replay.advance(9999);
+  CHECK_EQ(recordAt(replay), 0);
+  replay.advance(1);
+  CHECK_EQ(recordAt(replay), 1);
+  replay.advance(19999);
+  CHECK_EQ(recordAt(replay), 1);
+  CHECK(!replay.finished());
+  replay.advance(1);
+  CHECK_EQ(recordAt(replay), 2);
+  CHECK(replay.finished());
+
+  // the final sample is held
+  replay.advance(1000000);
+  CHECK_EQ(recordAt(replay), 2);
+}
+
+// one big step crosses several records at once
+TEST_CASE(step_mode_skips_records_in_one_advance) {
+  auto trace = makeTrace({0, 100, 100, 100});
+  ImuTraceReplay replay;
+  CHECK(replay.begin(trace.data(), trace.size(), false));
+  replay.advance(25000);
+  CHECK_EQ(recordAt(replay), 2);
+}
+
+// the last record lasts as long as the interval before it, then record 0
+TEST_CASE(loop_holds_last_record_for_its_interval) {
+  auto trace = makeTrace({0, 100, 200});  // period 10 + 20 + 20 ms
+  ImuTraceReplay replay;
+  CHECK(replay.begin(trace.data(), trace.size(), false));
+  replay.setLoop(true);
+
+  replay.advance(30000);
+  CHECK_EQ(recordAt(replay), 2);
+  replay.advance(19999);
+  CHECK_EQ(recordAt(replay), 2);
+  replay.advance(1);
+  CHECK_EQ(recordAt(replay), 0);
+  CHECK(!replay.finished());
+}
+
+// advancing past the wrap keeps the overshoot: 50 ms period, step to 58 ms
+TEST_CASE(loop_keeps_overshoot_across_wrap) {
+  auto trace = makeTrace({0, 100, 200});
+  ImuTraceReplay replay;
+  CHECK(replay.begin(trace.data(), trace.size(), false));
+  replay.setLoop(true);
+
+  replay.advance(30000);
+  CHECK_EQ(recordAt(replay), 2);
+  replay.advance(28000);  // 8 ms into the second pass
+  CHECK_EQ(recordAt(replay), 0);
+  replay.advance(2000);  // 10 ms into the second pass
+  CHECK_EQ(recordAt(replay), 1);
+
+  // many periods in one step land on the same phase
+  replay.advance(50000 * 7 + 20000);  // 30 ms into a pass
+  CHECK_EQ(recordAt(replay), 2);
+}
+
+// realtime mode reads micros(); the rebased start keeps the phase
+TEST_CASE(realtime_loop_follows_the_clock) {
+  auto trace = makeTrace({0, 100, 200});
+  ImuTraceReplay replay;
+  CHECK(replay.begin(trace.data(), trace.size(), true));
+  replay.setLoop(true);
+
+  host::advanceUs(12000);
+  CHECK_EQ(recordAt(replay), 1);
+  host::advanceUs(45000);  // 57 ms: 7 ms into the second pass
+  CHECK_EQ(recordAt(replay), 0);
+  host::advanceUs(3000);
+  CHECK_EQ(recordAt(replay), 1);
+  host::advanceUs(20000);
+  CHECK_EQ(recordAt(replay), 2);
+}
+
+// a one-record trace has no period; looping holds it
+TEST_CASE(single_record_loop_holds) {
+  auto trace = makeTrace({0});
+  ImuTraceReplay replay;
+  CHECK(replay.begin(trace.data(), trace.size(), false));
+  replay.setLoop(true);
+  replay.advance(1000000);
+  CHECK_EQ(recordAt(replay), 0);
+}
+
+TEST_CASE(rejects_bad_header) {
+  auto trace = makeTrace({0, 100});
+  ImuTraceReplay replay;
+  CHECK(!replay.begin(trace.data(), sizeof(ImuTraceHeader) - 1, false));
+  trace[0] ^= 1;
+  CHECK(!replay.begin(trace.data(), trace.size(), false));
+}
+
+// acc + gyro reads of one frame share a record; dt follows micros()
+TEST_CASE(recorder_round_trips_through_replay) {
+  Ramp source;
+  Buffer out;
+  ImuTraceRecorder recorder;
+  recorder.begin(&source, &out);
+
+  float x, y, z;
+  for (int i = 0; i < 4; i++) {
+    host::advanceUs(10000);
+    recorder.readAccelerometer(&x, &y, &z);
+    recorder.readGyroscope(&x, &y, &z);
+  }
+  recorder.end();
+  CHECK_EQ(recorder.records(), 4u);
+  CHECK_EQ(out.bytes.size(),
+           sizeof(ImuTraceHeader) + 4 * sizeof(ImuTraceRecord));
+
+  ImuTraceReplay replay;
+  CHECK(replay.begin(out.bytes.data(), out.bytes.size(), false));
+  for (int i = 1; i < 4; i++) {
+    replay.advance(10000);
+    CHECK(replay.readAccelerometer(&x, &y, &z));
+    CHECK_NEAR(x, 0.01f * i, 0.001f);
+    CHECK(replay.readGyroscope(&x, &y, &z));
+    CHECK_NEAR(x, 1.5f * i, 0.1f);
+    CHECK_NEAR(z, -2.0f, 0.1f);
+  }
+}
@@ -0,0 +1,194 @@
+// ArduinoLowPowerRP2040 deepSleep host tests: wake source selection (pin,
+// RTC alarm, both), wake reasons, the alarm time and clock restore (with the
+// voltage ahead of the clock), on the fake sleep / RTC layer.
+
+#include <Arduino.h>
+
+#include "LowPowerRP2040.h"
+#include "check.hpp"
+#include "pico/sleep.h"
+
+using namespace low_power;
+
+namespace {
+
+constexpr int WAKE_PIN = 7;
+
+// awake at 150 MHz / 1.05 V: deepSleep has to come back to exactly this
+void resetHost() {
+  host::rtc.reset();
+  host::sleepState.reset();
+  host::pinCallback = nullptr;
+  host::onSysClock = nullptr;
+  host::sysKhz = 150000;
+  vreg_set_voltage(VREG_VOLTAGE_1_05);
+}
+
+int secondsOfDay(const datetime_t& t) {
+  return t.hour * 3600 + t.min * 60 + t.sec;
+}
+
+// every clock change must find a voltage the operating point table allows
+// for it; clocks below the table (the crystal) need none
+bool underVolted = false;
+bool checkVoltage(uint32_t khz) {
+  for (const OperatingPoint& p : rp2040_operating_points)
+    if (p.khz >= khz) {
+      underVolted |= host::vregVoltage < p.voltage;
+      break;
+    }
+  return true;
+}
+
+void checkAwakePoint() {
+  CHECK_EQ(host::sysKhz, 150000u);
+  CHECK_EQ(host::vregVoltage, VREG_VOLTAGE_1_05);
+  CHECK_EQ(host::sleepState.powerUps, 1);
+  CHECK_EQ(host::sleepState.source, DORMANT_SOURCE_XOSC);
+}
+
+}  // namespace
+
+// nothing to wake up on: no sleep at all
+TEST_CASE(no_source_does_not_sleep) {
+  resetHost();
+  ArduinoLowPowerRP2040 lp;
+  CHECK(!lp.sleep());
+  CHECK(lp.getWakeReason() == wake_reason_t::none);
+  CHECK_EQ(host::sleepState.sleeps, 0);
+  CHECK_EQ(host::sleepState.dormants, 0);
+  CHECK_EQ(host::sysKhz, 150000u);
+}
+
+// a pin only: dormant until its edge, the RTC is left alone
+TEST_CASE(pin_only_goes_dormant) {
+  resetHost();
+  ArduinoLowPowerRP2040 lp;
+  CHECK(lp.addWakeupPin(WAKE_PIN, pin_change_t::on_high));
+  CHECK(lp.sleep());
+  CHECK(lp.getWakeReason() == wake_reason_t::pin);
+  CHECK_EQ(host::sleepState.dormants, 1);
+  CHECK_EQ(host::sleepState.dormantPin, WAKE_PIN);
+  CHECK(host::sleepState.dormantEdge);
+  CHECK(host::sleepState.dormantHigh);
+  CHECK_EQ(host::sleepState.sleeps, 0);
+  CHECK(!host::rtc.running);
+  CHECK(!host::rtc.alarmArmed);
+  checkAwakePoint();
+
+  // falling edge
+  resetHost();
+  ArduinoLowPowerRP2040 low;
+  low.addWakeupPin(WAKE_PIN, pin_change_t::on_low);
+  CHECK(low.sleep());
+  CHECK(host::sleepState.dormantEdge);
+  CHECK(!host::sleepState.dormantHigh);
+}
+
+// a sleep time only: the RTC is started if needed and the alarm is set to
+// the time rounded up to whole seconds
+TEST_CASE(rtc_only_sleeps_until_the_alarm) {
+  resetHost();
+  ArduinoLowPowerRP2040 lp;
+  CHECK(lp.setSleepTime(2500, time_unit_t::ms));
+  CHECK(lp.sleep());
+  CHECK(lp.getWakeReason() == wake_reason_t::timer);
+  CHECK_EQ(host::rtc.inits, 1);
+  CHECK(host::rtc.running);
+  CHECK_EQ(host::rtc.alarm.year, 2024);
+  CHECK_EQ(secondsOfDay(host::rtc.alarm), 3);
+  CHECK(!host::rtc.alarmArmed);  // disabled after the wake
+  CHECK_EQ(host::sleepState.sleeps, 1);
+  CHECK_EQ(host::sleepState.dormants, 0);
+  CHECK(host::pinCallback == nullptr);
+  checkAwakePoint();
+
+  // the RTC keeps running: the next alarm counts from where it is
+  CHECK(lp.setSleepTime(90, time_unit_t::sec));
+  CHECK(lp.sleep());
+  CHECK_EQ(host::rtc.inits, 1);
+  CHECK_EQ(secondsOfDay(host::rtc.alarm), 3 + 90);
+}
+
+// pin and sleep time: the RTC sleep with the pin interrupt attached;
+// whichever fires first is the wake reason
+TEST_CASE(pin_and_rtc_race) {
+  resetHost();
+  ArduinoLowPowerRP2040 lp;
+  CHECK(lp.addWakeupPin(WAKE_PIN, pin_change_t::on_high));
+  CHECK(lp.setSleepTime(10, time_unit_t::sec));
+
+  host::sleepState.wake = host::Wake::pin;
+  CHECK(lp.sleep());
+  CHECK(lp.getWakeReason() == wake_reason_t::pin);
+  CHECK_EQ(host::sleepState.sleeps, 1);
+  CHECK(host::sleepState.gpioClocked);
+  CHECK_EQ(host::sleepState.dormants, 0);
+  CHECK(host::pinCallback == nullptr);  // detached after the wake
+  CHECK(!host::rtc.alarmArmed);
+  checkAwakePoint();
+
+  host::sleepState.wake = host::Wake::alarm;
+  CHECK(lp.sleep());
+  CHECK(lp.getWakeReason() == wake_reason_t::timer);
+  CHECK_EQ(host::sleepState.sleeps, 2);
+  CHECK(host::pinCallback == nullptr);
+}
+
+// only one wake pin is supported in deepSleep
+TEST_CASE(second_pin_is_rejected) {
+  resetHost();
+  ArduinoLowPowerRP2040 lp;
+  CHECK(lp.addWakeupPin(WAKE_PIN, pin_change_t::on_high));
+  CHECK(!lp.addWakeupPin(WAKE_PIN + 1, pin_change_t::on_high));
+  CHECK(!lp.sleep());
+  CHECK(lp.getWakeReason() == wake_reason_t::none);
+  CHECK_EQ(host::sleepState.dormants, 0);
+}
+
+// 0 is no sleep time; long times do not overflow; units round up to the
+// RTC's whole seconds
+TEST_CASE(set_sleep_time) {
+  resetHost();
+  ArduinoLowPowerRP2040 lp;
+  CHECK(!lp.setSleepTime(0, time_unit_t::sec));
+  CHECK(!lp.sleep());
+
+  CHECK(lp.setSleepTime(5000, time_unit_t::sec));  // > 2^32 us
+  CHECK(lp.sleep());
+  CHECK_EQ(secondsOfDay(host::rtc.alarm), 5000);
+
+  CHECK(lp.setSleepTime(1, time_unit_t::us));
+  CHECK(lp.sleep());
+  CHECK_EQ(secondsOfDay(host::rtc.alarm), 5001);
+
+  // clear() drops the sleep time again
+  lp.clear();
+  CHECK(!lp.sleep());
+}
+
+// awake at a DVFS point below the SDK default (48 MHz / 0.90 V): the voltage
+// goes up before sleep_power_up() restarts the PLL at 125 MHz, and comes
+// down again only after the clock is back at 48 MHz
+TEST_CASE(low_awake_point_raises_the_voltage_for_power_up) {
+  for (bool pin : {true, false}) {
+    resetHost();
+    host::sysKhz = 48000;
+    vreg_set_voltage(VREG_VOLTAGE_0_90);
+    underVolted = false;
+    host::onSysClock = checkVoltage;
+
+    ArduinoLowPowerRP2040 lp;
+    if (pin)
+      lp.addWakeupPin(WAKE_PIN, pin_change_t::on_high);
+    else
+      lp.setSleepTime(1, time_unit_t::sec);
+    CHECK(lp.sleep());
+    CHECK_EQ(host::sleepState.dormants, pin ? 1 : 0);
+    CHECK_EQ(host::sleepState.powerUps, 1);
+    CHECK(host::sleepState.powerUpVoltage >= VREG_VOLTAGE_DEFAULT);
+    CHECK(!underVolted);
+    CHECK_EQ(host::sysKhz, 48000u);
+    CHECK_EQ(host::vregVoltage, VREG_VOLTAGE_0_90);
+  }
+}
@@ -0,0 +1,420 @@
+// QMI8658C host tests against a fake register map: Wake on Motion
+// programming (CAL1 encoding, CTRL9 handshake, pin routing) and its
+// behaviour when the bus or the device fails, batched register commits, the
+// power modes and the gyro turn-on time, and the level calibration.
+
+#include <Arduino.h>
+#include <I2Cdev.h>
+
+#include <memory>
+
+#include "check.hpp"
+#include "qmi8658c.hpp"
+
+namespace {
+
+constexpr uint8_t CTRL7_ACC = 1 << 0;
+constexpr uint8_t CTRL7_GYRO = 1 << 1;
+
+// the device executes every CTRL9 command at once and raises CmdDone until
+// the host acknowledges it
+void ctrl9Device(uint8_t reg, uint8_t value) {
+  if (reg != QMI8658C_REG_CTRL9)
+    return;
+  uint8_t& status = host::i2c.regs[QMI8658C_REG_STATUS_INT];
+  if (value == QMI8658C_CTRL9_CMD_ACK)
+    status &= ~QMI8658C_STATUS_INT_CMD_DONE;
+  else
+    status |= QMI8658C_STATUS_INT_CMD_DONE;
+}
+
+std::unique_ptr<QMI8658C> runningImu() {
+  host::i2c.reset();
+  host::i2c.regs[QMI8658C_REG_WHO_AM_I] = 0x05;
+  host::i2c.onWrite = ctrl9Device;
+
+  auto imu = std::make_unique<QMI8658C>();
+  CHECK(imu->begin(&Wire1, QMI8658C_I2C_ADDRESS_PULLUP));
+  imu->setPowerMode(QMI8658C::PowerMode::ACC_GYRO);
+  host::i2c.log.clear();
+  return imu;
+}
+
+// index of the first logged write to `reg` with `value` as its first byte
+int findWrite(uint8_t reg, int value = -1) {
+  const auto& log = host::i2c.log;
+  for (size_t i = 0; i < log.size(); i++)
+    if (log[i].reg == reg && (value < 0 || log[i].data[0] == value))
+      return int(i);
+  return -1;
+}
+
+uint8_t reg(uint8_t address) {
+  return host::i2c.regs[address];
+}
+
+// index of the first logged write that leaves `address` & `mask` == `value`
+int findValue(uint8_t address, uint8_t mask, uint8_t value) {
+  const auto& log = host::i2c.log;
+  for (size_t i = 0; i < log.size(); i++) {
+    const int at = address - log[i].reg;
+    if (at >= 0 && at < int(log[i].data.size()) &&
+        (log[i].data[at] & mask) == value)
+      return int(i);
+  }
+  return -1;
+}
+
+constexpr uint8_t accConfig(QMI8658C::AccScale scale, QMI8658C::AccODR odr) {
+  return uint8_t(uint8_t(scale) << 4 | uint8_t(odr));
+}
+
+constexpr uint8_t gyroConfig(QMI8658C::GyroScale scale,
+                             QMI8658C::GyroODR odr) {
+  return uint8_t(uint8_t(scale) << 4 | uint8_t(odr));
+}
+
+constexpr uint8_t ACC_ACTIVE = accConfig(QMI8658C::AccScale::ACC_SCALE_4G,
+                                         QMI8658C::AccODR::ACC_ODR_500HZ);
+constexpr uint8_t ACC_LP = accConfig(QMI8658C::AccScale::ACC_SCALE_4G,
+                                     QMI8658C::AccODR::ACC_ODR_LP_11HZ);
+constexpr uint8_t GYRO_ACTIVE = gyroConfig(
+    QMI8658C::GyroScale::GYRO_SCALE_256DPS, QMI8658C::GyroODR::GYRO_ODR_250HZ);
+
+// running at ±4 g / 500 Hz and ±256 dps / 250 Hz, past the gyro turn-on time
+std::unique_ptr<QMI8658C> configuredImu() {
+  auto imu = runningImu();
+  imu->configureAcc(QMI8658C::AccScale::ACC_SCALE_4G,
+                    QMI8658C::AccODR::ACC_ODR_500HZ);
+  imu->configureGyro(QMI8658C::GyroScale::GYRO_SCALE_256DPS,
+                     QMI8658C::GyroODR::GYRO_ODR_250HZ);
+  delay(QMI8658C_GYRO_STARTUP_MS);
+  host::i2c.log.clear();
+  return imu;
+}
+
+bool gyroReads(QMI8658C& imu) {
+  int16_t xyz[3];
+  return imu.readGyroscopeRaw(xyz);
+}
+
+// little-endian x, y, z sample at `base` (AX_L or GX_L)
+void setRaw(uint8_t base, int16_t x, int16_t y, int16_t z) {
+  const int16_t v[3] = {x, y, z};
+  for (int i = 0; i < 3; i++) {
+    host::i2c.regs[base + 2 * i] = uint16_t(v[i]) & 0xff;
+    host::i2c.regs[base + 2 * i + 1] = uint16_t(v[i]) >> 8;
+  }
+}
+
+}  // namespace
+
+// INT1, initially low: CAL1_H bits 7:6 = 0b10, blanking in bits 5:0
+TEST_CASE(wom_int1_initial_low_encoding) {
+  auto imu = runningImu();
+  CHECK(imu->enableWakeOnMotion(60));
+
+  CHECK_EQ(reg(QMI8658C_REG_CAL1_L), 60);
+  CHECK_EQ(reg(QMI8658C_REG_CAL1_H), 0b1000'0100);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL1) &
+               (QMI8658C_CTRL1_INT1_EN | QMI8658C_CTRL1_INT2_EN),
+           QMI8658C_CTRL1_INT1_EN);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL7) & (CTRL7_ACC | CTRL7_GYRO), CTRL7_ACC);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL2) & 0x0f,
+           uint8_t(QMI8658C::AccODR::ACC_ODR_LP_21HZ));
+  CHECK(imu->powerMode() == QMI8658C::PowerMode::WAKE_ON_MOTION);
+}
+
+TEST_CASE(wom_pin_and_level_are_encoded_separately) {
+  struct {
+    QMI8658C::WomPin pin;
+    QMI8658C::WomLevel level;
+    uint8_t bits;
+  } const cases[] = {
+      {QMI8658C::WomPin::WOM_INT1, QMI8658C::WomLevel::WOM_INITIAL_HIGH, 0b11},
+      {QMI8658C::WomPin::WOM_INT1, QMI8658C::WomLevel::WOM_INITIAL_LOW, 0b10},
+      {QMI8658C::WomPin::WOM_INT2, QMI8658C::WomLevel::WOM_INITIAL_HIGH, 0b01},
+      {QMI8658C::WomPin::WOM_INT2, QMI8658C::WomLevel::WOM_INITIAL_LOW, 0b00},
+  };
+  for (const auto& c : cases) {
+    auto imu = runningImu();
+    CHECK(imu->enableWakeOnMotion(
+        200, c.pin, c.level, QMI8658C::AccODR::ACC_ODR_LP_128HZ, 0x7f));
+    CHECK_EQ(reg(QMI8658C_REG_CAL1_H), uint8_t(c.bits << 6 | 0x3f));
+    const uint8_t int_en = c.pin == QMI8658C::WomPin::WOM_INT1
+                               ? QMI8658C_CTRL1_INT1_EN
+                               : QMI8658C_CTRL1_INT2_EN;
+    CHECK_EQ(reg(QMI8658C_REG_CTRL1) &
+                 (QMI8658C_CTRL1_INT1_EN | QMI8658C_CTRL1_INT2_EN),
+             int_en);
+  }
+}
+
+// sensors off -> CAL1 -> WRITE_WOM_SETTING -> ACK -> accelerometer on
+TEST_CASE(wom_programming_order) {
+  auto imu = runningImu();
+  CHECK(imu->enableWakeOnMotion(60));
+
+  const int off = findWrite(QMI8658C_REG_CTRL7, 0);
+  const int cal = findWrite(QMI8658C_REG_CAL1_L);
+  const int cmd =
+      findWrite(QMI8658C_REG_CTRL9, QMI8658C_CTRL9_CMD_WRITE_WOM_SETTING);
+  const int ack = findWrite(QMI8658C_REG_CTRL9, QMI8658C_CTRL9_CMD_ACK);
+  CHECK(off >= 0);
+  CHECK(off < cal);
+  CHECK(cal < cmd);
+  CHECK(cmd < ack);
+  CHECK_EQ(host::i2c.log[cal].data.size(), 2u);  // CAL1_L + CAL1_H in one go
+  CHECK_EQ(reg(QMI8658C_REG_STATUS_INT) & QMI8658C_STATUS_INT_CMD_DONE, 0);
+}
+
+TEST_CASE(wom_rejects_zero_threshold) {
+  auto imu = runningImu();
+  CHECK(!imu->enableWakeOnMotion(0));
+  CHECK(host::i2c.log.empty());
+}
+
+// no CmdDone within the timeout: not armed, pins stay unrouted
+TEST_CASE(wom_fails_without_acknowledge) {
+  auto imu = runningImu();
+  host::i2c.onWrite = nullptr;
+  CHECK(!imu->enableWakeOnMotion(60));
+  CHECK_EQ(reg(QMI8658C_REG_CTRL1) &
+               (QMI8658C_CTRL1_INT1_EN | QMI8658C_CTRL1_INT2_EN),
+           0);
+}
+
+// a failed CAL1 write must not be followed by the command that applies it
+TEST_CASE(wom_enable_fails_on_cal1_write_error) {
+  auto imu = runningImu();
+  host::i2c.failWrites = QMI8658C_REG_CAL1_H;
+  CHECK(!imu->enableWakeOnMotion(60));
+  CHECK_EQ(findWrite(QMI8658C_REG_CTRL9), -1);
+}
+
+TEST_CASE(wom_disable_clears_threshold_and_pins) {
+  auto imu = runningImu();
+  CHECK(imu->enableWakeOnMotion(60));
+  host::i2c.log.clear();
+
+  CHECK(imu->disableWakeOnMotion());
+  CHECK_EQ(reg(QMI8658C_REG_CAL1_L), 0);
+  CHECK_EQ(reg(QMI8658C_REG_CAL1_H), 0);
+  CHECK(findWrite(QMI8658C_REG_CAL1_L) <
+        findWrite(QMI8658C_REG_CTRL9, QMI8658C_CTRL9_CMD_WRITE_WOM_SETTING));
+  CHECK_EQ(reg(QMI8658C_REG_CTRL1) &
+               (QMI8658C_CTRL1_INT1_EN | QMI8658C_CTRL1_INT2_EN),
+           0);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL7) & (CTRL7_ACC | CTRL7_GYRO), 0);
+  CHECK(imu->powerMode() == QMI8658C::PowerMode::POWER_DOWN);
+}
+
+// the old threshold is still in CAL1: re-issuing the command would re-arm
+TEST_CASE(wom_disable_fails_on_cal1_write_error) {
+  auto imu = runningImu();
+  CHECK(imu->enableWakeOnMotion(60));
+  host::i2c.log.clear();
+  host::i2c.failWrites = QMI8658C_REG_CAL1_L;
+
+  CHECK(!imu->disableWakeOnMotion());
+  CHECK_EQ(findWrite(QMI8658C_REG_CTRL9), -1);
+}
+
+// ------------------ batched configuration ------------------
+
+// the wake-up reconfiguration of main.cpp: one burst after leaving WoM
+TEST_CASE(batched_wake_configuration_is_one_burst) {
+  auto imu = runningImu();
+  CHECK(imu->enableWakeOnMotion(60));
+  CHECK(imu->disableWakeOnMotion());
+  host::i2c.log.clear();
+
+  imu->beginBatch();
+  imu->configureAcc(QMI8658C::AccScale::ACC_SCALE_2G,
+                    QMI8658C::AccODR::ACC_ODR_250HZ);
+  imu->configureGyro(QMI8658C::GyroScale::GYRO_SCALE_256DPS,
+                     QMI8658C::GyroODR::GYRO_ODR_250HZ);
+  imu->setPowerMode(QMI8658C::PowerMode::ACC_GYRO);
+  imu->enableAttitudeEngine(QMI8658C::AeODR::AE_ODR_32HZ);
+  CHECK(host::i2c.log.empty());
+  CHECK(imu->commit());
+
+  CHECK_EQ(host::i2c.log.size(), 1u);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL7) & (CTRL7_ACC | CTRL7_GYRO),
+           CTRL7_ACC | CTRL7_GYRO);
+  CHECK(reg(QMI8658C_REG_CTRL7) & QMI8658C_CTRL7_AE_EN);
+
+  // the same configuration again: nothing to write
+  host::i2c.log.clear();
+  imu->beginBatch();
+  imu->configureGyro(QMI8658C::GyroScale::GYRO_SCALE_256DPS,
+                     QMI8658C::GyroODR::GYRO_ODR_250HZ);
+  imu->setPowerMode(QMI8658C::PowerMode::ACC_GYRO);
+  CHECK(imu->commit());
+  CHECK(host::i2c.log.empty());
+}
+
+// an AE increment is returned once: STATUS0 flags a new sample
+TEST_CASE(rotation_increment_needs_new_data) {
+  auto imu = runningImu();
+  imu->enableAttitudeEngine(QMI8658C::AeODR::AE_ODR_32HZ);
+  setRaw(QMI8658C_REG_DQW_L, 16384, 0, 0);
+  int16_t dq[4];
+  CHECK(!imu->readRotationIncrement(dq));
+
+  host::i2c.regs[QMI8658C_REG_STATUS0] = QMI8658C_STATUS0_AE_DA;
+  CHECK(imu->readRotationIncrement(dq));
+  CHECK_EQ(dq[0], 16384);
+
+  imu->disableAttitudeEngine();
+  CHECK(!imu->readRotationIncrement(dq));
+}
+
+// ------------------ power modes ------------------
+
+// an LP rate only exists without the gyro: asking for one switches it off,
+// and the gyro is never on while CTRL2 holds the LP rate
+TEST_CASE(lp_rate_turns_the_gyro_off) {
+  auto imu = configuredImu();
+  imu->configureAcc(QMI8658C::AccScale::ACC_SCALE_4G,
+                    QMI8658C::AccODR::ACC_ODR_LP_11HZ);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL2), ACC_LP);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL7) & (CTRL7_ACC | CTRL7_GYRO), CTRL7_ACC);
+  const int lp = findValue(QMI8658C_REG_CTRL2, 0xff, ACC_LP);
+  const int off = findValue(QMI8658C_REG_CTRL7, CTRL7_GYRO, 0);
+  CHECK(lp >= 0 && off >= 0 && off <= lp);
+  CHECK(!gyroReads(*imu));
+
+  // the LP rate is not the active configuration
+  CHECK(imu->setPowerMode(QMI8658C::PowerMode::ACC_ONLY));
+  CHECK_EQ(reg(QMI8658C_REG_CTRL2), ACC_ACTIVE);
+}
+
+// enable(true, …) puts the active rate back before the gyro comes up
+TEST_CASE(enable_restores_the_active_rate_first) {
+  auto imu = configuredImu();
+  CHECK(imu->setPowerMode(QMI8658C::PowerMode::ACC_LOW_POWER,
+                          QMI8658C::AccODR::ACC_ODR_LP_11HZ));
+  CHECK_EQ(reg(QMI8658C_REG_CTRL2), ACC_LP);
+  host::i2c.log.clear();
+
+  imu->enable(true, true);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL2), ACC_ACTIVE);
+  CHECK_EQ(reg(QMI8658C_REG_CTRL7) & (CTRL7_ACC | CTRL7_GYRO),
+           CTRL7_ACC | CTRL7_GYRO);
+  const int active = findValue(QMI8658C_REG_CTRL2, 0xff, ACC_ACTIVE);
+  const int on = findValue(QMI8658C_REG_CTRL7, CTRL7_GYRO, CTRL7_GYRO);
+  CHECK(active >= 0 && on >= 0 && active <= on);
+}
+
+// the registers each mode ends in, through every transition between them
+TEST_CASE(power_mode_registers) {
+  struct {
+    QMI8658C::PowerMode mode;
+    uint8_t ctrl2, ctrl7;
+  } const steps[] = {
+      {QMI8658C::PowerMode::POWER_DOWN, ACC_ACTIVE, 0},
+      {QMI8658C::PowerMode::ACC_LOW_POWER, ACC_LP, CTRL7_ACC},
+      {QMI8658C::PowerMode::ACC_ONLY, ACC_ACTIVE, CTRL7_ACC},
+      {QMI8658C::PowerMode::ACC_GYRO, ACC_ACTIVE, CTRL7_ACC | CTRL7_GYRO},
+      {QMI8658C::PowerMode::ACC_LOW_POWER, ACC_LP, CTRL7_ACC},
+      {QMI8658C::PowerMode::ACC_GYRO, ACC_ACTIVE, CTRL7_ACC | CTRL7_GYRO},
+      {QMI8658C::PowerMode::POWER_DOWN, ACC_ACTIVE, 0},
+  };
+  auto imu = configuredImu();
+  for (const auto& step : steps) {
+    CHECK(imu->setPowerMode(step.mode, QMI8658C::AccODR::ACC_ODR_LP_11HZ));
+    CHECK(imu->powerMode() == step.mode);
+    CHECK_EQ(reg(QMI8658C_REG_CTRL2), step.ctrl2);
+    CHECK_EQ(reg(QMI8658C_REG_CTRL3), GYRO_ACTIVE);
+    CHECK_EQ(reg(QMI8658C_REG_CTRL7) & (CTRL7_ACC | CTRL7_GYRO), step.ctrl7);
+  }
+
+  // not a low-power rate: refused, nothing written
+  host::i2c.log.clear();
+  CHECK(!imu->setPowerMode(QMI8658C::PowerMode::ACC_LOW_POWER,
+                           QMI8658C::AccODR::ACC_ODR_500HZ));
+  CHECK(host::i2c.log.empty());
+}
+
+// gyro reads fail for the turn-on time after the write that switches it on
+TEST_CASE(gyro_reads_wait_for_the_turn_on_time) {
+  auto imu = configuredImu();
+  CHECK(gyroReads(*imu));
+  CHECK(imu->setPowerMode(QMI8658C::PowerMode::ACC_ONLY));
+  CHECK(!gyroReads(*imu));
+
+  // pending inside a batch: still off on the device
+  imu->beginBatch();
+  CHECK(imu->setPowerMode(QMI8658C::PowerMode::ACC_GYRO));
+  delay(QMI8658C_GYRO_STARTUP_MS);
+  CHECK(!gyroReads(*imu));
+  CHECK(imu->commit());
+
+  CHECK(!gyroReads(*imu));
+  delay(QMI8658C_GYRO_STARTUP_MS - 1);
+  CHECK(!gyroReads(*imu));
+  delay(1);
+  CHECK(gyroReads(*imu));
+}
+
+// re-entering ACC_GYRO switches the gyro off and on only in the shadow; CTRL7
+// never changes, so the running gyro keeps its valid output
+TEST_CASE(reentering_acc_gyro_keeps_the_gyro_running) {
+  auto imu = configuredImu();
+  CHECK(gyroReads(*imu));
+  CHECK(imu->setPowerMode(QMI8658C::PowerMode::ACC_GYRO));
+  CHECK(gyroReads(*imu));
+
+  imu->beginBatch();
+  CHECK(imu->setPowerMode(QMI8658C::PowerMode::ACC_GYRO));
+  CHECK(imu->commit());
+  CHECK(host::i2c.log.empty());
+  CHECK(gyroReads(*imu));
+}
+
+// ------------------ calibration ------------------
+
+// level at ±2 g / ±256 dps: 1 g = 16384 LSB, 1 dps = 128 LSB
+TEST_CASE(calibration_removes_offsets_and_z_gain) {
+  auto imu = runningImu();
+  imu->configureAcc(QMI8658C::AccScale::ACC_SCALE_2G,
+                    QMI8658C::AccODR::ACC_ODR_250HZ);
+  imu->configureGyro(QMI8658C::GyroScale::GYRO_SCALE_256DPS,
+                     QMI8658C::GyroODR::GYRO_ODR_250HZ);
+  setRaw(QMI8658C_REG_AX_L, 200, -100, 15000);
+  setRaw(QMI8658C_REG_GX_L, 64, -32, 16);
+  CHECK(imu->calibrate(16));
+
+  int32_t a[3], g[3];
+  CHECK(imu->readAccelerometerQ16(&a[0], &a[1], &a[2]));
+  CHECK_NEAR(a[0], 0, 8);
+  CHECK_NEAR(a[1], 0, 8);
+  CHECK_NEAR(a[2], 65536, 16);  // 1 g
+  CHECK(imu->readGyroscopeQ16(&g[0], &g[1], &g[2]));
+  for (int i = 0; i < 3; i++)
+    CHECK_NEAR(g[i], 0, 16);
+
+  // calibration() round-trips through setCalibration()
+  const QMI8658C::Calibration saved = imu->calibration();
+  imu->clearCalibration();
+  imu->setCalibration(saved);
+  CHECK(imu->readAccelerometerQ16(&a[0], &a[1], &a[2]));
+  CHECK_NEAR(a[2], 65536, 16);
+}
+
+// not level: rejected, the previous calibration stays
+TEST_CASE(calibration_rejects_tilted_device) {
+  auto imu = runningImu();
+  imu->configureAcc(QMI8658C::AccScale::ACC_SCALE_2G,
+                    QMI8658C::AccODR::ACC_ODR_250HZ);
+  imu->configureGyro(QMI8658C::GyroScale::GYRO_SCALE_256DPS,
+                     QMI8658C::GyroODR::GYRO_ODR_250HZ);
+  setRaw(QMI8658C_REG_AX_L, 11585, 0, 4000);
+  setRaw(QMI8658C_REG_GX_L, 64, 0, 0);
+  CHECK(!imu->calibrate(16));
+  for (int i = 0; i < 3; i++) {
+    CHECK_EQ(imu->calibration().gyroOffset[i], 0);
+    CHECK_EQ(imu->calibration().accGain[i], QMI8658C_CAL_GAIN_ONE);
+  }
+}
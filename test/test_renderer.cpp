@@ -0,0 +1,260 @@
+// FluidRenderer 宿主机测试：金样帧 + 局部刷新 == 整屏重绘
+
+#include <memory>
+#include <vector>
+
+#include "FluidRenderer.hpp"
+#include "ParticleSimulation.hpp"
+#include "check.hpp"
+#include "fake_sim.hpp"
+#include "golden.hpp"
+#include "scene.hpp"
+
+using scene::Frame;
+
+static bool matchesGolden(const char* name, const Frame& frame) {
+  return golden::matches(name, SCREEN_WIDTH, SCREEN_HEIGHT, frame.buffer(),
+                         golden::SIM);
+}
+
+// 跑 frames 帧，每帧按 mode 渲染到同一帧缓冲
+static void run(FluidSimulation& sim, FluidRenderer& renderer,
+                FluidRenderer::Mode mode, int frames) {
+  for (int f = 0; f < frames; f++) {
+    scene::step(sim, f);
+    renderer.render(mode);
+  }
+}
+
+// ─── 金样帧 ───────────────────────────────────────
+TEST_CASE(golden_grid) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  run(sim, *renderer, FluidRenderer::GRID, 30);
+  CHECK(matchesGolden("grid_settled", frame));
+  run(sim, *renderer, FluidRenderer::GRID, 40);
+  CHECK(matchesGolden("grid_tilted", frame));
+}
+
+TEST_CASE(golden_balls) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  run(sim, *renderer, FluidRenderer::BALLS, 70);
+  CHECK(matchesGolden("balls_tilted", frame));
+}
+
+// ─── 局部刷新 == 整屏重绘 ─────────────────────────
+// 每一帧：PARTIAL_GRID 逐帧累积出的画面必须与全新渲染器的 renderGrid() 逐像素相同
+TEST_CASE(partial_grid_accumulates_to_full_redraw) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  int differing = 0;
+  for (int f = 0; f < 120; f++) {
+    scene::step(sim, f);
+    renderer->render(FluidRenderer::PARTIAL_GRID);
+    if (!(frame == *scene::fullRedraw(sim, FluidRenderer::GRID)))
+      differing++;
+  }
+  CHECK_EQ(differing, 0);
+  CHECK_EQ(renderer->verifyMismatches(), 0u);
+}
+
+// 同一渲染器在 GRID 与 PARTIAL_GRID 之间切换，画面仍与整屏重绘一致
+TEST_CASE(mode_switch_keeps_grid_consistent) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  int differing = 0;
+  for (int f = 0; f < 90; f++) {
+    scene::step(sim, f);
+    renderer->render(f % 20 < 10 ? FluidRenderer::PARTIAL_GRID
+                                 : FluidRenderer::GRID);
+    if (!(frame == *scene::fullRedraw(sim, FluidRenderer::GRID)))
+      differing++;
+  }
+  CHECK_EQ(differing, 0);
+}
+
+// 同种子、同输入 ⇒ 同一帧（金样帧可复现的前提）
+TEST_CASE(rendering_is_reproducible) {
+  ParticleSimulation a, b;
+  scene::begin(a);
+  scene::begin(b);
+  Frame fa, fb;
+  auto ra = std::make_unique<FluidRenderer>(&fa, &a);
+  auto rb = std::make_unique<FluidRenderer>(&fb, &b);
+  run(a, *ra, FluidRenderer::GRID, 45);
+  run(b, *rb, FluidRenderer::GRID, 45);
+  CHECK(fa == fb);
+}
+
+// ─── 元球 ─────────────────────────────────────────
+TEST_CASE(golden_metaballs) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  run(sim, *renderer, FluidRenderer::METABALLS, 70);
+  CHECK(matchesGolden("metaballs_tilted", frame));
+}
+
+TEST_CASE(metaballs_accumulate_to_full_redraw) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  int differing = 0;
+  for (int f = 0; f < 90; f++) {
+    scene::step(sim, f);
+    renderer->render(FluidRenderer::METABALLS);
+    if (!(frame == *scene::fullRedraw(sim, FluidRenderer::METABALLS)))
+      differing++;
+  }
+  CHECK_EQ(differing, 0);
+}
+
+// 单个粒子：中心满液体色，远处背景，之间是单调的软边（抗锯齿）
+TEST_CASE(metaball_edge_is_soft) {
+  FakeSimulation sim;
+  sim.addParticle(0.5f, 0.5f);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+  renderer->render(FluidRenderer::METABALLS);
+
+  constexpr int c = SCREEN_WIDTH / 2;
+  const uint16_t fluid = lgfx::color565(0, 240, 255);
+  CHECK_EQ(frame.pixel(c, c), fluid);
+  CHECK_EQ(frame.pixel(c + 30, c), TFT_BLACK);
+
+  int soft = 0, lastG = 0x3F;
+  for (int x = c; x < c + 30; ++x) {
+    const uint16_t p = frame.pixel(x, c);
+    const int g = (p >> 5) & 0x3F;
+    CHECK(g <= lastG);
+    lastG = g;
+    if (p != fluid && p != TFT_BLACK)
+      soft++;
+  }
+  CHECK(soft >= 2);
+}
+
+// ─── 明暗 + 抖动 ──────────────────────────────────
+TEST_CASE(golden_shaded) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  run(sim, *renderer, FluidRenderer::SHADED, 70);
+  CHECK(matchesGolden("shaded_tilted", frame));
+}
+
+// 屏幕中心 4×4 像素块中亮度较高的那一级的像素数；块内只许出现相邻两级
+static int upperLevelPixels(const Frame& frame, uint16_t* lower,
+                            uint16_t* upper) {
+  constexpr int c = SCREEN_WIDTH / 2;
+  uint16_t colors[2] = {frame.pixel(c, c), frame.pixel(c, c)};
+  int n[2] = {0, 0};
+  for (int y = c; y < c + 4; ++y)
+    for (int x = c; x < c + 4; ++x) {
+      const uint16_t p = frame.pixel(x, y);
+      if (p == colors[0]) {
+        n[0]++;
+      } else {
+        if (n[1] == 0)
+          colors[1] = p;
+        CHECK_EQ(p, colors[1]);
+        n[1]++;
+      }
+    }
+  // 亮度更高 = 绿通道更大（黑 → 液体色 → 泡沫色）
+  const bool swap = ((colors[0] >> 5) & 0x3F) > ((colors[1] >> 5) & 0x3F);
+  *lower = colors[swap];
+  *upper = colors[!swap];
+  return n[!swap];
+}
+
+// 亮度在两级之间 1/8 处：每个 4×4 块 2 个像素取上一级；时间抖动逐帧平移图样，
+// 4 帧一循环，且比例不变（1/4、1/2 处的图样平移 2 像素后不变，不能用来测）
+TEST_CASE(shaded_ordered_and_temporal_dither) {
+  // 占有量换成覆盖数 = 640（Q8）⇒ 覆盖度 160 ⇒ 亮度 800 = 3 级 + 32/256
+  FakeSimulation sim;
+  sim.fillStats(816, 0);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  std::vector<uint16_t> block[5];
+  uint16_t lower = 0, upper = 0;
+  for (int f = 0; f < 5; ++f) {
+    renderer->render(FluidRenderer::SHADED);
+    uint16_t lo, hi;
+    CHECK_EQ(upperLevelPixels(frame, &lo, &hi), 2);
+    CHECK(lo != hi);
+    if (f == 0) {
+      lower = lo;
+      upper = hi;
+    }
+    CHECK_EQ(lo, lower);
+    CHECK_EQ(hi, upper);
+    for (int y = 120; y < 124; ++y)
+      for (int x = 120; x < 124; ++x)
+        block[f].push_back(frame.pixel(x, y));
+  }
+  CHECK(block[0] != block[1]);
+  CHECK(block[0] == block[4]);
+}
+
+// ─── 模拟格统计 → 渲染格（双线性放大） ────────────
+// 下半圆一池液体：占有量随深度增加（整数，逐位可复现）
+static void poolStats(FakeSimulation& sim) {
+  constexpr int GS = FluidSimulation::GS;
+  CellStats& st = sim.stats();
+  st = CellStats{};
+  for (int gx = 0; gx < GS; ++gx)
+    for (int gy = 9; gy < GS; ++gy)
+      st.occ[gx * GS + gy] = (gy - 8) * 400;
+  st.speed[5 * GS + 9] = 6 * 256;  // 液面一格高速 → 泡沫
+}
+
+// 只由模拟端逐格统计分类：无粒子照样出液面，整帧逐位等于金样
+TEST_CASE(grid_from_sim_field_needs_no_particles) {
+  FakeSimulation sim;
+  poolStats(sim);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+  renderer->render(FluidRenderer::GRID);
+
+  CHECK_EQ(frame.pixel(120 + 2, 200 + 2), lgfx::color565(0, 240, 255));
+  CHECK_EQ(frame.pixel(120 + 2, 40 + 2), TFT_BLACK);
+  CHECK(golden::matches("grid_from_field", SCREEN_WIDTH, SCREEN_HEIGHT,
+                        frame.buffer(), golden::EXACT));
+}
+
+// 分类开销与粒子数无关，结果也与粒子无关：同一统计、不同粒子 ⇒ 同一帧
+TEST_CASE(grid_from_sim_field_ignores_particles) {
+  FakeSimulation empty, crowded;
+  poolStats(empty);
+  poolStats(crowded);
+  for (int i = 0; i < FluidSimulation::PC_MAX; ++i)
+    crowded.addParticle(0.3f + (i % 10) * 0.04f, 0.2f + (i / 10) * 0.03f);
+
+  Frame a, b;
+  auto ra = std::make_unique<FluidRenderer>(&a, &empty);
+  auto rb = std::make_unique<FluidRenderer>(&b, &crowded);
+  ra->render(FluidRenderer::GRID);
+  rb->render(FluidRenderer::GRID);
+  CHECK(a == b);
+}
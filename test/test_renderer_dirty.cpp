@@ -0,0 +1,221 @@
+// 脏瓦片、圆屏可见区裁剪、位平面变化检测
+
+#include <memory>
+
+#include "FluidRenderer.hpp"
+#include "ParticleSimulation.hpp"
+#include "check.hpp"
+#include "fake_sim.hpp"
+#include "scene.hpp"
+
+using scene::Frame;
+
+static const FluidRenderer::Mode ALL_MODES[] = {
+    FluidRenderer::BALLS, FluidRenderer::GRID, FluidRenderer::PARTIAL_GRID,
+    FluidRenderer::METABALLS, FluidRenderer::SHADED};
+
+// 静止的一团液体：粒子在下半圆排成方阵，统计按粒子重算
+static void restingBlob(FakeSimulation& sim) {
+  for (int i = 0; i < 10; ++i)
+    for (int j = 0; j < 10; ++j)
+      sim.addParticle(0.3f + i * 0.04f, 0.55f + j * 0.035f);
+  sim.refreshStats();
+}
+
+// ─── 脏瓦片 ───────────────────────────────────────
+// 画面不变 ⇒ 第二帧起一个像素都不推送（SHADED 见下）
+TEST_CASE(static_scene_pushes_nothing) {
+  for (FluidRenderer::Mode mode :
+       {FluidRenderer::BALLS, FluidRenderer::GRID, FluidRenderer::PARTIAL_GRID,
+        FluidRenderer::METABALLS}) {
+    FakeSimulation sim;
+    restingBlob(sim);
+    Frame frame;
+    auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+    renderer->render(mode);
+    CHECK(frame.pixelsPushed > 0);
+    frame.pixelsPushed = 0;
+    renderer->render(mode);
+    renderer->render(mode);
+    CHECK_EQ(frame.pixelsPushed, 0u);
+
+    // invalidate() 之后整屏重画
+    renderer->invalidate();
+    renderer->render(mode);
+    CHECK(frame.pixelsPushed > 0);
+  }
+}
+
+// SHADED 的时间抖动只重画亮度落在两级之间的格子；整级亮度的静止画面不推送
+TEST_CASE(static_shaded_on_whole_levels_pushes_nothing) {
+  FakeSimulation sim;
+  sim.fillStats(8 * 256, 0);  // 满覆盖、静止 ⇒ 整级亮度
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  renderer->render(FluidRenderer::SHADED);
+  frame.pixelsPushed = 0;
+  renderer->render(FluidRenderer::SHADED);
+  CHECK_EQ(frame.pixelsPushed, 0u);
+}
+
+// 局部刷新逐帧累积 == 全新渲染器整屏重绘（SHADED 的抖动相位依赖帧序，不比较）
+TEST_CASE(dirty_tiles_accumulate_to_full_redraw) {
+  for (FluidRenderer::Mode mode :
+       {FluidRenderer::BALLS, FluidRenderer::GRID, FluidRenderer::METABALLS}) {
+    ParticleSimulation sim;
+    scene::begin(sim);
+    Frame frame;
+    auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+    int differing = 0;
+    for (int f = 0; f < 90; f++) {
+      scene::step(sim, f);
+      renderer->render(mode);
+      if (!(frame == *scene::fullRedraw(sim, mode)))
+        differing++;
+    }
+    CHECK_EQ(differing, 0);
+  }
+}
+
+// SPI 流量随变化量缩放：液体沉底后，增量帧推送的像素远少于整屏重绘
+TEST_CASE(traffic_scales_with_motion) {
+  for (FluidRenderer::Mode mode : ALL_MODES) {
+    ParticleSimulation sim;
+    scene::begin(sim);
+    Frame frame;
+    auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+    for (int f = 0; f < 90; f++) {
+      scene::step(sim, f);
+      renderer->render(mode);
+    }
+    uint64_t incremental = 0, full = 0;
+    for (int f = 90; f < 120; f++) {
+      scene::step(sim, f);
+      frame.pixelsPushed = 0;
+      renderer->render(mode);
+      incremental += frame.pixelsPushed;
+      full += scene::fullRedraw(sim, mode)->pixelsPushed;
+    }
+    CHECK(incremental * 2 < full);
+  }
+}
+
+// ─── 圆屏可见区 ───────────────────────────────────
+static constexpr uint16_t CANARY = 0xF81F;
+
+// 像素中心到屏幕中心的距离²（像素²）
+static float dist2(int x, int y) {
+  const float dx = x + 0.5f - SCREEN_WIDTH * 0.5f;
+  const float dy = y + 0.5f - SCREEN_HEIGHT * 0.5f;
+  return dx * dx + dy * dy;
+}
+
+// 四角从不写入；圆盘内全部画到。逐像素只推一次的模式（METABALLS / SHADED）
+// 整屏重绘推送不到方屏的 85%（圆盘 ≈ 78.5%）
+TEST_CASE(full_redraw_stays_inside_the_disc) {
+  constexpr float R = SCREEN_WIDTH * 0.5f;
+  // 裁剪粒度（对齐带 / 整格）向外最多多出 (粒度 - 1)·√2 px
+  constexpr int GRAIN = max(RENDER_SPAN_ALIGN, RENDER_PIXEL_PER_CELL);
+  constexpr float OUTER = R + (GRAIN - 1) * 1.415f + 0.5f;
+  constexpr float INNER = R - 1.0f;
+
+  for (FluidRenderer::Mode mode : ALL_MODES) {
+    ParticleSimulation sim;
+    scene::begin(sim);
+    for (int f = 0; f < 40; f++)
+      scene::step(sim, f);
+
+    Frame frame;
+    frame.fillScreen(CANARY);
+    frame.pixelsPushed = 0;
+    auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+    renderer->render(mode);
+
+    if (mode == FluidRenderer::METABALLS || mode == FluidRenderer::SHADED)
+      CHECK(frame.pixelsPushed < 0.85 * SCREEN_WIDTH * SCREEN_HEIGHT);
+    int outside = 0, missing = 0;
+    for (int y = 0; y < SCREEN_HEIGHT; ++y)
+      for (int x = 0; x < SCREEN_WIDTH; ++x) {
+        const bool canary = frame.pixel(x, y) == CANARY;
+        if (!canary && dist2(x, y) > OUTER * OUTER)
+          outside++;
+        if (canary && dist2(x, y) < INNER * INNER)
+          missing++;
+      }
+    CHECK_EQ(outside, 0);
+    CHECK_EQ(missing, 0);
+  }
+}
+
+// 增量帧同样不碰四角
+TEST_CASE(incremental_frames_stay_inside_the_disc) {
+  for (FluidRenderer::Mode mode : ALL_MODES) {
+    ParticleSimulation sim;
+    scene::begin(sim);
+    Frame frame;
+    frame.fillScreen(CANARY);
+    auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+    for (int f = 0; f < 90; f++) {
+      scene::step(sim, f);
+      renderer->render(mode);
+    }
+    for (int y : {0, 1, 2, SCREEN_HEIGHT - 3, SCREEN_HEIGHT - 2,
+                  SCREEN_HEIGHT - 1})
+      for (int x : {0, 1, 2, SCREEN_WIDTH - 3, SCREEN_WIDTH - 2,
+                    SCREEN_WIDTH - 1})
+        CHECK_EQ(frame.pixel(x, y), CANARY);
+  }
+}
+
+// ─── 位平面变化检测 ───────────────────────────────
+// 带刚体的 FLIP：BODY(5) 与 LIQUID(1) 只差第 2 位平面，刚体扫过液体时
+// 只有该平面变化；逐帧累积仍须与整屏重绘一致
+TEST_CASE(partial_grid_tracks_rigid_body) {
+  ParticleSimulation sim;
+  scene::begin(sim);
+  CHECK(sim.addRigidBody(0.5f, 0.3f, 0.06f, 0.08f) >= 0);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  int differing = 0;
+  for (int f = 0; f < 120; f++) {
+    scene::step(sim, f);
+    renderer->render(FluidRenderer::PARTIAL_GRID);
+    if (!(frame == *scene::fullRedraw(sim, FluidRenderer::GRID)))
+      differing++;
+  }
+  CHECK_EQ(differing, 0);
+  CHECK_EQ(renderer->verifyMismatches(), 0u);
+}
+
+// 满液体中放入一个只盖住一格的刚体：只重画这一格附近，拿走后恢复原样
+TEST_CASE(single_cell_change_redraws_one_cell) {
+  constexpr int cs = RENDER_PIXEL_PER_CELL;
+  constexpr int g = RENDER_GRID_SIZE / 2;
+  constexpr float center = (g + 0.5f) * cs / SCREEN_WIDTH;
+  FakeSimulation sim;
+  sim.fillStats(8 * 256, 0);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+  renderer->render(FluidRenderer::PARTIAL_GRID);
+  const auto before = scene::fullRedraw(sim, FluidRenderer::GRID);
+
+  sim.addBody(center, center, 0.4f * cs / SCREEN_WIDTH);
+  frame.pixelsPushed = 0;
+  renderer->render(FluidRenderer::PARTIAL_GRID);
+  CHECK(frame.pixelsPushed > 0);
+  CHECK(frame.pixelsPushed <= 4u * cs * cs);
+  CHECK(frame == *scene::fullRedraw(sim, FluidRenderer::GRID));
+  CHECK(!(frame == *before));
+
+  sim.clearBodies();
+  frame.pixelsPushed = 0;
+  renderer->render(FluidRenderer::PARTIAL_GRID);
+  CHECK(frame.pixelsPushed <= 4u * cs * cs);
+  CHECK(frame == *before);
+  CHECK_EQ(renderer->verifyMismatches(), 0u);
+}
@@ -0,0 +1,79 @@
+// 预计算调色板：小球速度渐变表、格子类型配色表、整数混合
+
+#include <memory>
+
+#include "FluidRenderer.hpp"
+#include "check.hpp"
+#include "fake_sim.hpp"
+#include "scene.hpp"
+
+using scene::Frame;
+
+static constexpr uint16_t RED = lgfx::color565(255, 0, 0);
+static constexpr uint16_t GREEN = lgfx::color565(0, 255, 0);
+
+// 屏幕中心一个粒子，速度 v，BALLS 模式下球心像素的颜色
+static uint16_t ballColorAt(float v, uint16_t base = TFT_CYAN) {
+  FakeSimulation sim;
+  sim.addParticle(0.5f, 0.5f, v, 0.0f);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+  if (base != TFT_CYAN)
+    renderer->setBallBaseColor(base);
+  renderer->render(FluidRenderer::BALLS);
+  return frame.pixel(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2);
+}
+
+TEST_CASE(ball_gradient_endpoints) {
+  CHECK_EQ(ballColorAt(0.0f), TFT_CYAN);
+  CHECK_EQ(ballColorAt(RENDER_BALL_MAX_SPEED), TFT_WHITE);
+  CHECK_EQ(ballColorAt(3.0f * RENDER_BALL_MAX_SPEED), TFT_WHITE);  // 饱和
+  CHECK_EQ(ballColorAt(0.0f, RED), RED);
+}
+
+// 青 → 白：红通道随速度单调增加，绿、蓝保持满值
+TEST_CASE(ball_gradient_is_monotonic) {
+  int last = -1;
+  for (int i = 0; i <= 16; ++i) {
+    const uint16_t c = ballColorAt(RENDER_BALL_MAX_SPEED * i / 16);
+    const int r = c >> 11;
+    CHECK(r >= last);
+    CHECK_EQ((c >> 5) & 0x3F, 0x3F);
+    CHECK_EQ(c & 0x1F, 0x1F);
+    last = r;
+  }
+  CHECK_EQ(last, 0x1F);
+}
+
+// 满占有量 ⇒ 内部全是液体格；屏幕中心格子的填充色即液体色
+static uint16_t centerCell(const Frame& frame) {
+  constexpr int cs = RENDER_PIXEL_PER_CELL;
+  constexpr int c = RENDER_GRID_SIZE / 2 * cs + cs / 2;
+  return frame.pixel(c, c);
+}
+
+TEST_CASE(cell_palette_follows_setters) {
+  FakeSimulation sim;
+  sim.fillStats(8 * 256, 0);
+  Frame frame;
+  auto renderer = std::make_unique<FluidRenderer>(&frame, &sim);
+
+  renderer->render(FluidRenderer::GRID);
+  CHECK_EQ(centerCell(frame), lgfx::color565(0, 240, 255));
+  CHECK_EQ(frame.pixel(2, SCREEN_HEIGHT / 2 + 2), TFT_DARKGREY);  // 容器壁
+
+  // 改色后即使状态不变也要重画
+  renderer->setGridFluidColor(RED);
+  renderer->setGridSolidColor(GREEN);
+  frame.pixelsPushed = 0;
+  renderer->render(FluidRenderer::GRID);
+  CHECK(frame.pixelsPushed > 0);
+  CHECK_EQ(centerCell(frame), RED);
+  CHECK_EQ(frame.pixel(2, SCREEN_HEIGHT / 2 + 2), GREEN);
+
+  // 局部模式同样
+  renderer->render(FluidRenderer::PARTIAL_GRID);
+  renderer->setGridFluidColor(TFT_BLUE);
+  renderer->render(FluidRenderer::PARTIAL_GRID);
+  CHECK_EQ(centerCell(frame), TFT_BLUE);
+}
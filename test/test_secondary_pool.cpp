@@ -0,0 +1,163 @@
+// 次级粒子池：空闲链表分配 / 回收、容量上限、按占有量分类
+
+#include <memory>
+
+#include "SecondaryPool.hpp"
+#include "check.hpp"
+#include "fake_sim.hpp"
+
+static constexpr int GS = FluidSimulation::GS;
+static constexpr float DT = 1.0f / 30.0f;
+
+// 容器中央 4×4 格全是泡沫候选，占有量 occ（Q8），格速度为 0
+static void foamBlock(FakeSimulation& sim, uint16_t occ) {
+  sim.fillStats(occ, 0);
+  CellStats& st = sim.stats();
+  for (int gx = 6; gx < 10; ++gx)
+    st.foam[gx] = 0xF << 6;
+  st.foamCells = 16;
+}
+
+static void noFoam(FakeSimulation& sim) {
+  CellStats& st = sim.stats();
+  memset(st.foam, 0, sizeof(st.foam));
+  st.foamCells = 0;
+}
+
+static int liveCount(const SecondaryPool& pool) {
+  int n = 0;
+  pool.forEach([&](const SecondaryParticle&) { n++; });
+  return n;
+}
+
+// 每帧最多生成 SPAWN_MAX 个；池满后丢弃请求，活跃数与遍历数始终一致
+TEST_CASE(spawn_is_budgeted_and_capped) {
+  FakeSimulation sim;
+  sim.setGravity(0.0f, 0.0f);
+  foamBlock(sim, 256);
+  auto pool = std::make_unique<SecondaryPool>();
+
+  for (int f = 1; f <= 30; ++f) {
+    pool->update(sim, DT);
+    CHECK_EQ(pool->activeCount(),
+             min(f * SECONDARY_SPAWN_MAX, SecondaryPool::CAP));
+    CHECK_EQ(liveCount(*pool), pool->activeCount());
+  }
+}
+
+// 寿命耗尽全部回收；空闲链表完整，能再次填满整个池
+TEST_CASE(free_list_recycles_every_slot) {
+  FakeSimulation sim;
+  sim.setGravity(0.0f, 0.0f);
+  auto pool = std::make_unique<SecondaryPool>();
+
+  for (int round = 0; round < 3; ++round) {
+    foamBlock(sim, 256);
+    for (int f = 0; f < 20; ++f)
+      pool->update(sim, DT);
+    CHECK_EQ(pool->activeCount(), SecondaryPool::CAP);
+
+    noFoam(sim);
+    int maxLife = 0;
+    for (int f = 0; pool->activeCount() > 0 && f < 100; ++f) {
+      pool->update(sim, DT);
+      CHECK_EQ(liveCount(*pool), pool->activeCount());
+      maxLife = f + 1;
+    }
+    CHECK_EQ(pool->activeCount(), 0);
+    CHECK(maxLife <= SECONDARY_LIFE * 3 / 4 + SECONDARY_LIFE / 2 + 1);
+  }
+}
+
+// dt ≤ 0 不平流也不生成
+TEST_CASE(zero_dt_is_a_no_op) {
+  FakeSimulation sim;
+  foamBlock(sim, 256);
+  SecondaryPool pool;
+  pool.update(sim, 0.0f);
+  CHECK_EQ(pool.activeCount(), 0);
+}
+
+// 占有量低 ⇒ 飞沫，受重力落出容器即回收；高 ⇒ 气泡，逆重力上浮
+TEST_CASE(type_follows_cell_occupancy) {
+  FakeSimulation sim;
+  sim.setGravity(0.0f, 10.0f);
+  SecondaryPool spray;
+  foamBlock(sim, 0);
+  spray.update(sim, DT);
+  noFoam(sim);
+  spray.update(sim, DT);
+  spray.forEach([](const SecondaryParticle& s) {
+    CHECK_EQ(s.type, SECONDARY_SPRAY);
+    CHECK(s.vy > 0.0f);
+  });
+  for (int f = 0; f < 20; ++f)
+    spray.update(sim, DT);
+  CHECK_EQ(spray.activeCount(), 0);  // 远早于寿命
+
+  SecondaryPool bubble;
+  foamBlock(sim, 3 * 256);
+  bubble.update(sim, DT);
+  noFoam(sim);
+  bubble.update(sim, DT);
+  CHECK(bubble.activeCount() > 0);
+  bubble.forEach([](const SecondaryParticle& s) {
+    CHECK_EQ(s.type, SECONDARY_BUBBLE);
+    CHECK_NEAR(s.vy, -10.0f * SECONDARY_BUOYANCY, 1e-6f);
+  });
+}
+
+// clear() 重置 PRNG：同一输入、同一种子 ⇒ 同一批粒子，换种子则不同
+TEST_CASE(clear_makes_spawning_reproducible) {
+  FakeSimulation sim;
+  sim.setGravity(0.0f, 0.0f);
+  foamBlock(sim, 256);
+  SecondaryPool pool;
+  pool.update(sim, DT);
+  float first[SECONDARY_SPAWN_MAX][2];
+  int n = 0;
+  pool.forEach([&](const SecondaryParticle& s) {
+    first[n][0] = s.x;
+    first[n][1] = s.y;
+    n++;
+  });
+  CHECK_EQ(n, SECONDARY_SPAWN_MAX);
+
+  pool.clear();
+  CHECK_EQ(pool.activeCount(), 0);
+  pool.update(sim, DT);
+  n = 0;
+  pool.forEach([&](const SecondaryParticle& s) {
+    CHECK_EQ(s.x, first[n][0]);
+    CHECK_EQ(s.y, first[n][1]);
+    n++;
+  });
+}
+
+// 模拟的种子传给 clear()：与 setSeed() 一样决定生成序列
+TEST_CASE(clear_takes_the_simulation_seed) {
+  FakeSimulation sim;
+  sim.setGravity(0.0f, 0.0f);
+  sim.setSeed(12345);
+  CHECK_EQ(sim.seed(), 12345u);
+  foamBlock(sim, 256);
+
+  auto firstX = [&](uint32_t seed) {
+    SecondaryPool pool;
+    pool.clear(seed);
+    pool.update(sim, DT);
+    float x = -1.0f;
+    pool.forEach([&](const SecondaryParticle& s) {
+      if (x < 0.0f)
+        x = s.x;
+    });
+    return x;
+  };
+  CHECK_EQ(firstX(sim.seed()), firstX(12345));
+  CHECK(firstX(sim.seed()) != firstX(SIM_DEFAULT_SEED));
+
+  // 0 不是合法的 xorshift 状态，与 setSeed(0) 一样退回默认种子
+  sim.setSeed(0);
+  CHECK_EQ(sim.seed(), SIM_DEFAULT_SEED);
+  CHECK_EQ(firstX(0), firstX(SIM_DEFAULT_SEED));
+}